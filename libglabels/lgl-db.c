@@ -238,7 +238,7 @@ lgl_db_model_new (void)
  * Initialize all libglabels subsystems.  It is not necessary for an application to call
  * lgl_db_init(), because libglabels will initialize on demand.  An application programmer may
  * choose to call lgl_db_init() at startup to minimize the impact of the first libglabels call
- * on GUI response time.
+ * on GUI response time.  Calling lgl_db_init() again has no effect.
  *
  * This function initializes its paper definitions, category definitions, vendor definitions,
  * and its template database. It will search both system and user template directories to locate
@@ -253,6 +253,12 @@ lgl_db_init (void)
         GList       *page_sizes;
         GList       *p;
 
+        if (model)
+        {
+                /* Already initialized, e.g. on demand. */
+                return;
+        }
+
         model = lgl_db_model_new ();
 
         /*
@@ -22,6 +22,7 @@
 
 #include "bc-backends.h"
 
+#include <string.h>
 #include <glib.h>
 #include <glib/gi18n.h>
 
@@ -38,6 +39,9 @@
 /* Private macros and constants.                          */
 /*========================================================*/
 
+#define BARCODE_CACHE_MAX      4096
+#define BARCODE_KEY_BUF_SIZE   256
+
 
 /*========================================================*/
 /* Private types.                                         */
@@ -71,6 +75,11 @@ typedef struct {
         guint             prefered_n;
 } Style;
 
+struct _glBarcodeCache {
+        GMutex            mutex;
+        GHashTable       *barcodes;      /* Key string -> lglBarcode (or NULL). */
+};
+
 
 /*========================================================*/
 /* Private globals.                                       */
@@ -845,18 +854,153 @@ gl_barcode_backends_new_barcode (const gchar    *backend_id,
 
         i = style_id_to_index (backend_id, id);
 
+        GL_TRACE_BEGIN ("barcode encode");
         gbc = styles[i].new_barcode (styles[i].id,
                                      text_flag,
                                      checksum_flag,
                                      w,
                                      h,
                                      digits);
+        GL_TRACE_END ("barcode encode");
+
+        GL_TRACE_HISTOGRAM ("barcode digits", strlen (digits));
 
         return gbc;
 }
 
 
 
+/*****************************************************************************/
+/* Create a new, empty barcode cache.  A cache can be shared by the labels   */
+/* of a whole run, e.g. all jobs of a batch manifest.  Thread safe.          */
+/*****************************************************************************/
+glBarcodeCache *
+gl_barcode_backends_cache_new (void)
+{
+        glBarcodeCache *cache;
+
+        cache = g_new0 (glBarcodeCache, 1);
+        g_mutex_init (&cache->mutex);
+        cache->barcodes = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                 g_free,
+                                                 (GDestroyNotify)lgl_barcode_free);
+
+        return cache;
+}
+
+
+/*****************************************************************************/
+/* Free barcode cache and all barcodes in it.                                */
+/*****************************************************************************/
+void
+gl_barcode_backends_cache_free (glBarcodeCache *cache)
+{
+        if ( cache )
+        {
+                g_hash_table_destroy (cache->barcodes);
+                g_mutex_clear (&cache->mutex);
+                g_free (cache);
+        }
+}
+
+
+/*****************************************************************************/
+/* Render barcode to cairo, encoding it with the appropriate backend only if */
+/* it is not in the cache yet.  Cached barcodes are never evicted, so they   */
+/* can be rendered without holding the lock; once the cache is full, new     */
+/* barcodes are encoded for this call only.  Returns FALSE if the data could */
+/* not be encoded.                                                           */
+/*****************************************************************************/
+gboolean
+gl_barcode_backends_cache_render (glBarcodeCache *cache,
+                                  cairo_t        *cr,
+                                  const gchar    *backend_id,
+                                  const gchar    *id,
+                                  gboolean        text_flag,
+                                  gboolean        checksum_flag,
+                                  gdouble         w,
+                                  gdouble         h,
+                                  const gchar    *digits)
+{
+        gchar       buf[BARCODE_KEY_BUF_SIZE];
+        gchar      *key;
+        guint       len;
+        gpointer    cached_gbc;
+        lglBarcode *gbc;
+        gboolean    owned_flag = FALSE;
+
+        g_return_val_if_fail (cache!=NULL, FALSE);
+        g_return_val_if_fail (digits!=NULL, FALSE);
+
+        /* Only allocate the key for unusually long data, or when inserting. */
+        key = buf;
+        len = g_snprintf (buf, sizeof(buf), "%s:%s:%d:%d:%g:%g:%s",
+                          backend_id, id, text_flag, checksum_flag, w, h, digits);
+        if ( len >= sizeof(buf) )
+        {
+                key = g_strdup_printf ("%s:%s:%d:%d:%g:%g:%s",
+                                       backend_id, id, text_flag, checksum_flag, w, h, digits);
+        }
+
+        g_mutex_lock (&cache->mutex);
+        if ( g_hash_table_lookup_extended (cache->barcodes, key, NULL, &cached_gbc) )
+        {
+                g_mutex_unlock (&cache->mutex);
+
+                GL_TRACE_COUNT ("barcode cache hits", 1);
+                gbc = cached_gbc;
+        }
+        else
+        {
+                g_mutex_unlock (&cache->mutex);
+
+                /* Encode without holding the lock. */
+                gbc = gl_barcode_backends_new_barcode (backend_id, id,
+                                                       text_flag, checksum_flag,
+                                                       w, h, digits);
+
+                g_mutex_lock (&cache->mutex);
+                if ( g_hash_table_lookup_extended (cache->barcodes, key, NULL, &cached_gbc) )
+                {
+                        /* Another thread got there first. */
+                        lgl_barcode_free (gbc);
+                        gbc = cached_gbc;
+                }
+                else if ( g_hash_table_size (cache->barcodes) < BARCODE_CACHE_MAX )
+                {
+                        /* Failed encodings (NULL) are cached too. */
+                        g_hash_table_insert (cache->barcodes, g_strdup (key), gbc);
+                }
+                else
+                {
+                        owned_flag = TRUE;
+                }
+                g_mutex_unlock (&cache->mutex);
+
+                GL_TRACE_COUNT ("barcode cache misses", 1);
+        }
+
+        if ( key != buf )
+        {
+                g_free (key);
+        }
+
+        if ( gbc == NULL )
+        {
+                return FALSE;
+        }
+
+        lgl_barcode_render_to_cairo (gbc, cr);
+
+        if ( owned_flag )
+        {
+                lgl_barcode_free (gbc);
+        }
+
+        return TRUE;
+}
+
+
 /*
  * Local Variables:       -- emacs
  * mode: C                -- emacs
@@ -27,6 +27,9 @@
 G_BEGIN_DECLS
 
 
+typedef struct _glBarcodeCache glBarcodeCache;
+
+
 GList           *gl_barcode_backends_get_backend_list     (void);
 void             gl_barcode_backends_free_backend_list    (GList          *backend_list);
 
@@ -71,6 +74,19 @@ lglBarcode      *gl_barcode_backends_new_barcode          (const gchar    *backe
                                                            gdouble         h,
                                                            const gchar    *digits);
 
+glBarcodeCache  *gl_barcode_backends_cache_new            (void);
+void             gl_barcode_backends_cache_free           (glBarcodeCache *cache);
+
+gboolean         gl_barcode_backends_cache_render         (glBarcodeCache *cache,
+                                                           cairo_t        *cr,
+                                                           const gchar    *backend_id,
+                                                           const gchar    *id,
+                                                           gboolean        text_flag,
+                                                           gboolean        checksum_flag,
+                                                           gdouble         w,
+                                                           gdouble         h,
+                                                           const gchar    *digits);
+
 
 
 
@@ -24,6 +24,24 @@
 
 #include <string.h>
 
+#include "debug.h"
+
+
+/*========================================================*/
+/* Private macros and constants.                          */
+/*========================================================*/
+
+#define COLOR_CACHE_MAX 1024
+
+
+/*========================================================*/
+/* Private globals.                                       */
+/*========================================================*/
+
+/* Color strings (e.g. merge field values) already parsed, to packed color. */
+static GHashTable *color_cache = NULL;
+static GMutex      color_cache_mutex;
+
 
 /*****************************************************************************/
 /* Apply given opacity to given color.                                       */
@@ -177,10 +195,6 @@ guint
 gl_color_node_expand (glColorNode    *color_node,
                       glMergeRecord  *record)
 {
-        gchar    *text;
-        GdkColor *gdk_color;
-        guint     color;
-
         if (color_node->field_flag)
         {
                 if (record == NULL)
@@ -189,26 +203,7 @@ gl_color_node_expand (glColorNode    *color_node,
                 }
                 else
                 {
-                        text = gl_merge_eval_key (record, color_node->key);
-                        if (text != NULL)
-                        {
-                                gdk_color = g_new0 (GdkColor, 1);
-                                if (gdk_color_parse (text, gdk_color))
-                                {
-                                        color = gl_color_from_gdk_color (gdk_color);
-                                        g_free (gdk_color);
-                                        return color;
-                                }
-                                else
-                                {
-                                        g_free (gdk_color);
-                                        return GL_COLOR_NONE;
-                                }
-                        }
-                        else
-                        {
-                                return GL_COLOR_NONE;
-                        }
+                        return gl_color_parse (gl_merge_lookup_key (record, color_node->key));
                 }
         }
         else
@@ -218,6 +213,61 @@ gl_color_node_expand (glColorNode    *color_node,
 }
 
 
+/****************************************************************************/
+/* Parse color string, such as a merge field value.  Returns GL_COLOR_NONE  */
+/* if string is NULL or not a valid color.  Results are kept in a process   */
+/* wide cache, since merge sources tend to repeat a few color names.        */
+/* Thread safe.                                                             */
+/****************************************************************************/
+guint
+gl_color_parse (const gchar *string)
+{
+        gpointer  cached_color;
+        GdkColor  gdk_color;
+        guint     color;
+
+        if ( string == NULL )
+        {
+                return GL_COLOR_NONE;
+        }
+
+        g_mutex_lock (&color_cache_mutex);
+        if ( color_cache == NULL )
+        {
+                color_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                     g_free, NULL);
+        }
+        if ( g_hash_table_lookup_extended (color_cache, string, NULL, &cached_color) )
+        {
+                g_mutex_unlock (&color_cache_mutex);
+
+                GL_TRACE_COUNT ("color cache hits", 1);
+                return GPOINTER_TO_UINT (cached_color);
+        }
+        g_mutex_unlock (&color_cache_mutex);
+
+        if ( gdk_color_parse (string, &gdk_color) )
+        {
+                color = gl_color_from_gdk_color (&gdk_color);
+        }
+        else
+        {
+                color = GL_COLOR_NONE;
+        }
+
+        g_mutex_lock (&color_cache_mutex);
+        if ( g_hash_table_size (color_cache) < COLOR_CACHE_MAX )
+        {
+                /* Invalid colors are cached too. */
+                g_hash_table_replace (color_cache, g_strdup (string), GUINT_TO_POINTER (color));
+        }
+        g_mutex_unlock (&color_cache_mutex);
+
+        GL_TRACE_COUNT ("color cache misses", 1);
+        return color;
+}
+
+
 /****************************************************************************/
 /* Free a single color node.                                                */
 /****************************************************************************/
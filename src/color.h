@@ -111,6 +111,7 @@ gboolean     gl_color_node_equal          (glColorNode     *color_node1,
                                            glColorNode     *color_node2);
 guint        gl_color_node_expand         (glColorNode     *color_node,
                                            glMergeRecord   *record);
+guint        gl_color_parse               (const gchar     *string);
 void         gl_color_node_free           (glColorNode    **color_node);
 
 
@@ -26,13 +26,77 @@
  *
  */
 
+#include <config.h>
+
 #include "debug.h"
 
+#include <stdio.h>
 #include <glib.h>
+#ifdef G_OS_UNIX
+#include <sys/resource.h>
+#endif
 
 
 glDebugSection debug_flags = GLABELS_DEBUG_NONE;
 
+#ifdef ENABLE_TRACE
+
+/*========================================================*/
+/* Hot-path instrumentation (configure --enable-trace).   */
+/*========================================================*/
+
+#define TRACE_MAX_EVENTS   (1 << 20)
+#define TRACE_N_BUCKETS    64
+
+typedef struct {
+        const gchar *name;
+        gchar        phase;      /* 'X' complete (timer) or 'C' counter. */
+        gint         tid;
+        gint64       ts;         /* Microseconds since gl_debug_init(). */
+        gint64       value;      /* Duration or counter value. */
+} TraceEvent;
+
+/* Timers (in microseconds) and histograms. */
+typedef struct {
+        gint64       n;
+        gint64       total;
+        gint64       max;
+        gint64       buckets[TRACE_N_BUCKETS];   /* By power of 2. */
+} TraceStat;
+
+typedef struct {
+        gint         tid;
+        GArray      *stack;      /* Start times of open timers. */
+} TraceThread;
+
+gboolean            gl_trace_flag = FALSE;
+
+static GMutex       trace_mutex;
+static gint64       trace_t0;
+static GArray      *trace_events;
+static guint        trace_n_dropped;
+static GHashTable  *trace_timers;        /* Since last summary. */
+static GHashTable  *trace_histograms;    /* Since last summary. */
+static GHashTable  *trace_counters;      /* Monotonic. */
+static gint         trace_n_threads;
+
+static void         trace_init          (void);
+
+static void         trace_thread_free   (TraceThread *thread);
+
+static GPrivate     trace_thread_key = G_PRIVATE_INIT ((GDestroyNotify)trace_thread_free);
+
+static TraceThread *trace_get_thread    (void);
+
+static void         trace_stat_add      (GHashTable  *stats,
+                                         const gchar *name,
+                                         gint64       value);
+
+static void         trace_print_stats   (const gchar *kind,
+                                         GHashTable  *stats);
+
+#endif
+
 
 /****************************************************************************/
 /* Initialize debug flags, based on environmental variables.                */
@@ -40,6 +104,11 @@ glDebugSection debug_flags = GLABELS_DEBUG_NONE;
 void
 gl_debug_init (void)
 {
+#ifdef ENABLE_TRACE
+	if (g_getenv ("GLABELS_TRACE") != NULL)
+		trace_init ();
+#endif
+
 	if (g_getenv ("GLABELS_DEBUG") != NULL)
 	{
 		/* enable all debugging */
@@ -130,6 +199,320 @@ gl_debug (glDebugSection  section,
 }
 
 
+/****************************************************************************/
+/* Peak resident set size of process (kB), 0 if unknown.  GLib can no       */
+/* longer count allocations, so this is used as the measure of memory use.  */
+/****************************************************************************/
+glong
+gl_debug_get_max_rss_kb (void)
+{
+#ifdef G_OS_UNIX
+	struct rusage usage;
+
+	if ( getrusage (RUSAGE_SELF, &usage) == 0 )
+	{
+		return usage.ru_maxrss;
+	}
+#endif
+
+	return 0;
+}
+
+
+#ifdef ENABLE_TRACE
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Start collecting trace data.                                    */
+/*---------------------------------------------------------------------------*/
+static void
+trace_init (void)
+{
+        trace_t0         = g_get_monotonic_time ();
+        trace_events     = g_array_new (FALSE, FALSE, sizeof (TraceEvent));
+        trace_timers     = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+        trace_histograms = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+        trace_counters   = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+
+        gl_trace_flag = TRUE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Per thread trace state.                                         */
+/*---------------------------------------------------------------------------*/
+static TraceThread *
+trace_get_thread (void)
+{
+        TraceThread *thread;
+
+        thread = g_private_get (&trace_thread_key);
+        if ( !thread )
+        {
+                thread = g_new0 (TraceThread, 1);
+                thread->tid   = g_atomic_int_add (&trace_n_threads, 1) + 1;
+                thread->stack = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+                g_private_set (&trace_thread_key, thread);
+        }
+
+        return thread;
+}
+
+
+static void
+trace_thread_free (TraceThread *thread)
+{
+        g_array_free (thread->stack, TRUE);
+        g_free (thread);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Add value to timer or histogram (trace_mutex held).             */
+/*---------------------------------------------------------------------------*/
+static void
+trace_stat_add (GHashTable  *stats,
+                const gchar *name,
+                gint64       value)
+{
+        TraceStat *stat;
+
+        stat = g_hash_table_lookup (stats, name);
+        if ( !stat )
+        {
+                stat = g_new0 (TraceStat, 1);
+                g_hash_table_insert (stats, (gpointer)name, stat);
+        }
+
+        stat->n++;
+        stat->total += value;
+        stat->max    = MAX (stat->max, value);
+        stat->buckets[MIN (g_bit_storage (MAX (value, 0)), TRACE_N_BUCKETS - 1)]++;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Print timers or histograms (trace_mutex held).                  */
+/*---------------------------------------------------------------------------*/
+static void
+trace_print_stats (const gchar *kind,
+                   GHashTable  *stats)
+{
+        GHashTableIter  iter;
+        const gchar    *name;
+        TraceStat      *stat;
+        GString        *buckets;
+        gint            i;
+
+        g_hash_table_iter_init (&iter, stats);
+        while ( g_hash_table_iter_next (&iter, (gpointer *)&name, (gpointer *)&stat) )
+        {
+                buckets = g_string_new (NULL);
+                for ( i = 0; i < TRACE_N_BUCKETS; i++ )
+                {
+                        if ( stat->buckets[i] )
+                        {
+                                g_string_append_printf (buckets, " <2^%d:%" G_GINT64_FORMAT,
+                                                        i, stat->buckets[i]);
+                        }
+                }
+
+                g_printerr ("  %-9s %-32s n=%-8" G_GINT64_FORMAT " total=%-10" G_GINT64_FORMAT
+                            " mean=%-8.1f max=%-8" G_GINT64_FORMAT "%s\n",
+                            kind, name, stat->n, stat->total,
+                            (gdouble)stat->total / stat->n, stat->max, buckets->str);
+
+                g_string_free (buckets, TRUE);
+        }
+}
+
+
+/****************************************************************************/
+/* Begin timed scope.                                                       */
+/****************************************************************************/
+void
+gl_trace_begin (const gchar *name)
+{
+        TraceThread *thread = trace_get_thread ();
+        gint64       t      = g_get_monotonic_time ();
+
+        g_array_append_val (thread->stack, t);
+}
+
+
+/****************************************************************************/
+/* End timed scope, record it as trace event and in timer.                  */
+/****************************************************************************/
+void
+gl_trace_end (const gchar *name)
+{
+        TraceThread *thread = trace_get_thread ();
+        TraceEvent   event;
+        gint64       t0;
+
+        g_return_if_fail (thread->stack->len > 0);
+
+        t0 = g_array_index (thread->stack, gint64, thread->stack->len - 1);
+        g_array_set_size (thread->stack, thread->stack->len - 1);
+
+        event.name  = name;
+        event.phase = 'X';
+        event.tid   = thread->tid;
+        event.ts    = t0 - trace_t0;
+        event.value = g_get_monotonic_time () - t0;
+
+        g_mutex_lock (&trace_mutex);
+
+        if ( trace_events->len < TRACE_MAX_EVENTS )
+        {
+                g_array_append_val (trace_events, event);
+        }
+        else
+        {
+                trace_n_dropped++;
+        }
+        trace_stat_add (trace_timers, name, event.value);
+
+        g_mutex_unlock (&trace_mutex);
+}
+
+
+/****************************************************************************/
+/* Add to monotonic counter.                                                */
+/****************************************************************************/
+void
+gl_trace_count (const gchar *name,
+                gint64       n)
+{
+        gint64 *counter;
+
+        g_mutex_lock (&trace_mutex);
+
+        counter = g_hash_table_lookup (trace_counters, name);
+        if ( !counter )
+        {
+                counter = g_new0 (gint64, 1);
+                g_hash_table_insert (trace_counters, (gpointer)name, counter);
+        }
+        *counter += n;
+
+        g_mutex_unlock (&trace_mutex);
+}
+
+
+/****************************************************************************/
+/* Add value to histogram.                                                  */
+/****************************************************************************/
+void
+gl_trace_histogram (const gchar *name,
+                    gint64       value)
+{
+        g_mutex_lock (&trace_mutex);
+
+        trace_stat_add (trace_histograms, name, value);
+
+        g_mutex_unlock (&trace_mutex);
+}
+
+
+/****************************************************************************/
+/* Print summary of job: timers and histograms since the last summary, and  */
+/* counters.  Counter values are also recorded as trace events.             */
+/****************************************************************************/
+void
+gl_trace_summary (const gchar *job)
+{
+        GHashTableIter  iter;
+        const gchar    *name;
+        gint64         *counter;
+        TraceEvent      event;
+
+        g_mutex_lock (&trace_mutex);
+
+        g_printerr ("glabels trace summary: %s (times in microseconds)\n", job);
+
+        trace_print_stats ("timer", trace_timers);
+        trace_print_stats ("histogram", trace_histograms);
+
+        event.phase = 'C';
+        event.tid   = 0;
+        event.ts    = g_get_monotonic_time () - trace_t0;
+
+        g_hash_table_iter_init (&iter, trace_counters);
+        while ( g_hash_table_iter_next (&iter, (gpointer *)&name, (gpointer *)&counter) )
+        {
+                g_printerr ("  %-9s %-32s %" G_GINT64_FORMAT "\n", "counter", name, *counter);
+
+                event.name  = name;
+                event.value = *counter;
+                g_array_append_val (trace_events, event);
+        }
+
+        g_hash_table_remove_all (trace_timers);
+        g_hash_table_remove_all (trace_histograms);
+
+        g_mutex_unlock (&trace_mutex);
+}
+
+
+/****************************************************************************/
+/* Write Chrome trace-event JSON file.                                      */
+/****************************************************************************/
+void
+gl_trace_write (void)
+{
+        const gchar *filename;
+        FILE        *fp;
+        TraceEvent  *event;
+        guint        i;
+
+        filename = g_getenv ("GLABELS_TRACE");
+
+        g_mutex_lock (&trace_mutex);
+
+        fp = fopen (filename, "w");
+        if ( !fp )
+        {
+                g_message ("Cannot write trace file \"%s\"", filename);
+                g_mutex_unlock (&trace_mutex);
+                return;
+        }
+
+        fprintf (fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        for ( i = 0; i < trace_events->len; i++ )
+        {
+                event = &g_array_index (trace_events, TraceEvent, i);
+
+                if ( event->phase == 'X' )
+                {
+                        fprintf (fp, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                                 "\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT "}",
+                                 event->name, event->tid, event->ts, event->value);
+                }
+                else
+                {
+                        fprintf (fp, "{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,"
+                                 "\"ts\":%" G_GINT64_FORMAT ",\"args\":{\"value\":%" G_GINT64_FORMAT "}}",
+                                 event->name, event->ts, event->value);
+                }
+                fprintf (fp, "%s\n", (i < trace_events->len - 1) ? "," : "");
+        }
+        fprintf (fp, "]}\n");
+
+        fclose (fp);
+
+        if ( trace_n_dropped )
+        {
+                g_message ("Trace event limit reached, %u events dropped", trace_n_dropped);
+        }
+
+        g_mutex_unlock (&trace_mutex);
+}
+
+#endif /* ENABLE_TRACE */
+
+
+
 
 /*
  * Local Variables:       -- emacs
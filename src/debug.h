@@ -107,6 +107,64 @@ void gl_debug      (glDebugSection  section,
 		    const gchar    *format,
 		    ...);
 
+glong gl_debug_get_max_rss_kb (void);
+
+
+/*
+ * Hot-path instrumentation: scoped timers, monotonic counters and
+ * histograms.  Only built with "configure --enable-trace", otherwise all
+ * of these compile to nothing.
+ *
+ * At run time, set GLABELS_TRACE to a file name to turn them on.  A summary
+ * is printed at the end of each job (GL_TRACE_SUMMARY), and all timed
+ * scopes are written to that file as Chrome trace-event JSON on exit
+ * (GL_TRACE_WRITE), for chrome://tracing or Perfetto.
+ *
+ * Names must be static strings.  Timers nest per thread, each
+ * GL_TRACE_BEGIN must be matched by a GL_TRACE_END in the same scope.
+ */
+#ifdef ENABLE_TRACE
+
+extern gboolean gl_trace_flag;
+
+#define GL_TRACE_BEGIN(name) \
+        G_STMT_START { if (gl_trace_flag) gl_trace_begin (name); } G_STMT_END
+#define GL_TRACE_END(name) \
+        G_STMT_START { if (gl_trace_flag) gl_trace_end (name); } G_STMT_END
+#define GL_TRACE_COUNT(name, n) \
+        G_STMT_START { if (gl_trace_flag) gl_trace_count (name, n); } G_STMT_END
+#define GL_TRACE_HISTOGRAM(name, value) \
+        G_STMT_START { if (gl_trace_flag) gl_trace_histogram (name, value); } G_STMT_END
+#define GL_TRACE_SUMMARY(job) \
+        G_STMT_START { if (gl_trace_flag) gl_trace_summary (job); } G_STMT_END
+#define GL_TRACE_WRITE() \
+        G_STMT_START { if (gl_trace_flag) gl_trace_write (); } G_STMT_END
+
+void gl_trace_begin     (const gchar    *name);
+
+void gl_trace_end       (const gchar    *name);
+
+void gl_trace_count     (const gchar    *name,
+                         gint64          n);
+
+void gl_trace_histogram (const gchar    *name,
+                         gint64          value);
+
+void gl_trace_summary   (const gchar    *job);
+
+void gl_trace_write     (void);
+
+#else
+
+#define GL_TRACE_BEGIN(name)             G_STMT_START { } G_STMT_END
+#define GL_TRACE_END(name)               G_STMT_START { } G_STMT_END
+#define GL_TRACE_COUNT(name, n)          G_STMT_START { } G_STMT_END
+#define GL_TRACE_HISTOGRAM(name, value)  G_STMT_START { } G_STMT_END
+#define GL_TRACE_SUMMARY(job)            G_STMT_START { } G_STMT_END
+#define GL_TRACE_WRITE()                 G_STMT_START { } G_STMT_END
+
+#endif
+
 G_END_DECLS
 
 #endif /* __DEBUG_H__ */
@@ -0,0 +1,771 @@
+/*
+ *  display-list.c
+ *  Copyright (C) 2026  gLabels contributors.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "display-list.h"
+
+#include <string.h>
+
+#include "label-object.h"
+#include "label-box.h"
+#include "label-ellipse.h"
+#include "label-line.h"
+#include "label-barcode.h"
+#include "text-node.h"
+#include "color.h"
+#include "bc-backends.h"
+#include "cairo-ellipse-path.h"
+
+#include "debug.h"
+
+
+/*========================================================*/
+/* Private macros and constants.                          */
+/*========================================================*/
+
+#define DISPLAY_LIST_KEY  "gl-display-list"
+#define BARCODE_CACHE_KEY "gl-display-list-barcode-cache"
+
+
+/*========================================================*/
+/* Private types.                                         */
+/*========================================================*/
+
+typedef void (*DrawFunc) (glLabelObject *object,
+                          cairo_t       *cr,
+                          gboolean       screen_flag,
+                          glMergeRecord *record);
+
+typedef enum {
+        DISPLAY_OP_NONE,
+        DISPLAY_OP_OBJECT,          /* Fall back to object's draw method.     */
+        DISPLAY_OP_FILL,            /* Fill path.                             */
+        DISPLAY_OP_STROKE,          /* Stroke path.                           */
+        DISPLAY_OP_FILL_STROKE,     /* Fill, then stroke path (box, ellipse). */
+        DISPLAY_OP_BARCODE          /* Barcode with merge field data.         */
+} DisplayOpType;
+
+typedef struct {
+        guint            color;          /* Constant color, if key is NULL.    */
+        const gchar     *key;            /* Merge field containing color.      */
+        gdouble          opacity;        /* Replaces alpha of field, if >= 0.  */
+
+        const guint     *column;         /* Parsed field, by record index.     */
+        gint             n_values;
+} DisplayColor;
+
+typedef struct {
+        DisplayOpType    type;
+        cairo_matrix_t   matrix;         /* Object to label coordinates.       */
+
+        glLabelObject   *object;
+        DrawFunc         draw;
+
+        cairo_path_t    *path;
+        DisplayColor     fill_color;
+        DisplayColor     line_color;
+        gdouble          line_width;
+
+        const gchar     *bc_key;
+        const gchar     *bc_backend_id;
+        const gchar     *bc_id;
+        gboolean         bc_text_flag;
+        gboolean         bc_checksum_flag;
+        gdouble          bc_w, bc_h;
+} DisplayOp;
+
+struct _glDisplayList {
+        DisplayOp       *ops;
+        guint            n_ops;
+
+        GStringChunk    *strings;        /* Field keys and barcode ids.        */
+
+        glBarcodeCache  *barcodes;       /* Merge barcodes.                    */
+        gboolean         barcodes_owned; /* Cache is freed with list.          */
+
+        glMerge         *merge;          /* Keeps color columns alive.         */
+};
+
+
+/*========================================================*/
+/* Private globals.                                       */
+/*========================================================*/
+
+
+/*========================================================*/
+/* Private function prototypes.                           */
+/*========================================================*/
+
+static glDisplayList *compile             (glLabel             *label);
+
+static void           compile_object      (glDisplayList       *display_list,
+                                           GArray              *ops,
+                                           cairo_t             *scratch_cr,
+                                           glLabelObject       *object);
+
+static void           compile_shadow      (glDisplayList       *display_list,
+                                           DisplayOp           *op,
+                                           cairo_t             *scratch_cr);
+
+static void           compile_draw        (glDisplayList       *display_list,
+                                           DisplayOp           *op,
+                                           cairo_t             *scratch_cr);
+
+static void           compile_color       (glDisplayList       *display_list,
+                                           DisplayColor        *color,
+                                           glColorNode         *color_node,
+                                           gdouble              opacity);
+
+static void           shape_path          (cairo_t             *cr,
+                                           glLabelObject       *object,
+                                           gdouble              x,
+                                           gdouble              y,
+                                           gdouble              w,
+                                           gdouble              h);
+
+static void           resolve_colors      (glDisplayList       *display_list);
+
+static guint          expand_color        (const DisplayColor  *color,
+                                           glMergeRecord       *record);
+
+static void           draw_barcode        (const glDisplayList *display_list,
+                                           const DisplayOp     *op,
+                                           cairo_t             *cr,
+                                           glMergeRecord       *record);
+
+static void           display_list_free   (glDisplayList       *display_list);
+
+static void           label_changed_cb    (glLabel             *label,
+                                           gpointer             data);
+
+
+/****************************************************************************/
+/* Get display list of label, compiling it if needed.  The display list is  */
+/* owned by the label and is discarded on its next "changed" or             */
+/* "merge_changed" signal.                                                  */
+/****************************************************************************/
+const glDisplayList *
+gl_display_list_get (glLabel *label)
+{
+        glDisplayList *display_list;
+
+        g_return_val_if_fail (label && GL_IS_LABEL (label), NULL);
+
+        display_list = g_object_get_data (G_OBJECT (label), DISPLAY_LIST_KEY);
+        if ( display_list == NULL )
+        {
+                GL_TRACE_BEGIN ("display list compile");
+                display_list = compile (label);
+                GL_TRACE_END ("display list compile");
+
+                g_object_set_data_full (G_OBJECT (label), DISPLAY_LIST_KEY,
+                                        display_list,
+                                        (GDestroyNotify)display_list_free);
+                g_signal_connect (G_OBJECT (label), "changed",
+                                  G_CALLBACK (label_changed_cb), NULL);
+                g_signal_connect (G_OBJECT (label), "merge_changed",
+                                  G_CALLBACK (label_changed_cb), NULL);
+        }
+
+        return display_list;
+}
+
+
+/****************************************************************************/
+/* Share barcode cache between display lists of label, e.g. with the other  */
+/* jobs of a batch run.  The cache is not owned and must outlive the label. */
+/* Without a shared cache, each display list has a cache of its own.        */
+/****************************************************************************/
+void
+gl_display_list_set_barcode_cache (glLabel        *label,
+                                   glBarcodeCache *cache)
+{
+        g_return_if_fail (label && GL_IS_LABEL (label));
+
+        g_object_set_data (G_OBJECT (label), BARCODE_CACHE_KEY, cache);
+
+        /* Recompile with the new cache. */
+        label_changed_cb (label, NULL);
+}
+
+
+/****************************************************************************/
+/* Draw display list for given merge record (print rendering).              */
+/****************************************************************************/
+void
+gl_display_list_draw (const glDisplayList *display_list,
+                      cairo_t             *cr,
+                      glMergeRecord       *record)
+{
+        const DisplayOp *op;
+        guint            i;
+        guint            color;
+
+        g_return_if_fail (display_list);
+
+        GL_TRACE_BEGIN ("gl_display_list_draw");
+
+        for ( i = 0; i < display_list->n_ops; i++ )
+        {
+                op = &display_list->ops[i];
+
+                cairo_save (cr);
+                cairo_transform (cr, &op->matrix);
+
+                switch (op->type)
+                {
+
+                case DISPLAY_OP_OBJECT:
+                        /* Timed per object class, e.g. "glLabelText". */
+                        GL_TRACE_BEGIN (G_OBJECT_TYPE_NAME (op->object));
+                        op->draw (op->object, cr, FALSE, record);
+                        GL_TRACE_END (G_OBJECT_TYPE_NAME (op->object));
+                        break;
+
+                case DISPLAY_OP_FILL:
+                        color = expand_color (&op->fill_color, record);
+                        cairo_append_path (cr, op->path);
+                        cairo_set_source_rgba (cr, GL_COLOR_RGBA_ARGS (color));
+                        cairo_fill (cr);
+                        break;
+
+                case DISPLAY_OP_STROKE:
+                        color = expand_color (&op->line_color, record);
+                        cairo_append_path (cr, op->path);
+                        cairo_set_source_rgba (cr, GL_COLOR_RGBA_ARGS (color));
+                        cairo_set_line_width (cr, op->line_width);
+                        cairo_stroke (cr);
+                        break;
+
+                case DISPLAY_OP_FILL_STROKE:
+                        color = expand_color (&op->fill_color, record);
+                        cairo_append_path (cr, op->path);
+                        cairo_set_source_rgba (cr, GL_COLOR_RGBA_ARGS (color));
+                        cairo_fill_preserve (cr);
+
+                        color = expand_color (&op->line_color, record);
+                        cairo_set_source_rgba (cr, GL_COLOR_RGBA_ARGS (color));
+                        cairo_set_line_width (cr, op->line_width);
+                        cairo_stroke (cr);
+                        break;
+
+                case DISPLAY_OP_BARCODE:
+                        draw_barcode (display_list, op, cr, record);
+                        break;
+
+                default:
+                        break;
+
+                }
+
+                cairo_restore (cr);
+        }
+
+        GL_TRACE_END ("gl_display_list_draw");
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Compile display list of label's objects, back to front.  Each   */
+/* object contributes a shadow op (if any) followed by its draw op.          */
+/*---------------------------------------------------------------------------*/
+static glDisplayList *
+compile (glLabel *label)
+{
+        glDisplayList   *display_list;
+        GArray          *ops;
+        cairo_surface_t *scratch_surface;
+        cairo_t         *scratch_cr;
+        const GList     *p;
+
+        gl_debug (DEBUG_PRINT, "START");
+
+        display_list = g_new0 (glDisplayList, 1);
+        display_list->strings = g_string_chunk_new (256);
+        display_list->barcodes = g_object_get_data (G_OBJECT (label), BARCODE_CACHE_KEY);
+        if ( display_list->barcodes == NULL )
+        {
+                display_list->barcodes       = gl_barcode_backends_cache_new ();
+                display_list->barcodes_owned = TRUE;
+        }
+
+        ops = g_array_new (FALSE, TRUE, sizeof (DisplayOp));
+
+        /* Paths are built once here and replayed on whatever the target is. */
+        scratch_surface = cairo_image_surface_create (CAIRO_FORMAT_A8, 1, 1);
+        scratch_cr      = cairo_create (scratch_surface);
+
+        for ( p = gl_label_get_object_list (label); p != NULL; p = p->next )
+        {
+                compile_object (display_list, ops, scratch_cr, GL_LABEL_OBJECT (p->data));
+        }
+
+        cairo_destroy (scratch_cr);
+        cairo_surface_destroy (scratch_surface);
+
+        display_list->n_ops = ops->len;
+        display_list->ops   = (DisplayOp *)g_array_free (ops, FALSE);
+
+        display_list->merge = gl_label_get_merge (label);
+        if ( display_list->merge != NULL )
+        {
+                resolve_colors (display_list);
+        }
+
+        gl_debug (DEBUG_PRINT, "END %d ops", display_list->n_ops);
+
+        return display_list;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Compile ops of a single object, with the same transformations   */
+/* as gl_label_object_draw().                                                */
+/*---------------------------------------------------------------------------*/
+static void
+compile_object (glDisplayList *display_list,
+                GArray        *ops,
+                cairo_t       *scratch_cr,
+                glLabelObject *object)
+{
+        glLabelObjectClass *class = GL_LABEL_OBJECT_GET_CLASS (object);
+        gdouble             x0, y0;
+        gdouble             shadow_x, shadow_y;
+        cairo_matrix_t      matrix;
+        cairo_matrix_t      translation;
+        DisplayOp           op;
+
+        gl_label_object_get_position (object, &x0, &y0);
+        gl_label_object_get_matrix (object, &matrix);
+
+        if ( (class->draw_shadow != NULL) && gl_label_object_get_shadow_state (object) )
+        {
+                gl_label_object_get_shadow_offset (object, &shadow_x, &shadow_y);
+
+                memset (&op, 0, sizeof (DisplayOp));
+                op.object = object;
+                op.draw   = class->draw_shadow;
+                cairo_matrix_init_translate (&translation, x0 + shadow_x, y0 + shadow_y);
+                cairo_matrix_multiply (&op.matrix, &matrix, &translation);
+
+                compile_shadow (display_list, &op, scratch_cr);
+
+                if ( op.type != DISPLAY_OP_NONE )
+                {
+                        g_array_append_val (ops, op);
+                }
+        }
+
+        if ( class->draw_object != NULL )
+        {
+                memset (&op, 0, sizeof (DisplayOp));
+                op.object = object;
+                op.draw   = class->draw_object;
+                cairo_matrix_init_translate (&translation, x0, y0);
+                cairo_matrix_multiply (&op.matrix, &matrix, &translation);
+
+                compile_draw (display_list, &op, scratch_cr);
+
+                g_array_append_val (ops, op);
+        }
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Compile shadow op.  Mirrors draw_shadow() of box, ellipse and   */
+/* line objects; box and ellipse shadows depend on whether fill and line     */
+/* colors are transparent, so with merge field colors they are left to the   */
+/* object.                                                                   */
+/*---------------------------------------------------------------------------*/
+static void
+compile_shadow (glDisplayList *display_list,
+                DisplayOp     *op,
+                cairo_t       *scratch_cr)
+{
+        glLabelObject *object = op->object;
+        gdouble        w, h;
+        gdouble        line_width;
+        glColorNode   *line_color_node;
+        glColorNode   *fill_color_node;
+        glColorNode   *shadow_color_node;
+        gdouble        shadow_opacity;
+        DisplayColor   shadow_color;
+
+        op->type = DISPLAY_OP_OBJECT;
+
+        if ( !GL_IS_LABEL_BOX (object) && !GL_IS_LABEL_ELLIPSE (object) && !GL_IS_LABEL_LINE (object) )
+        {
+                return;
+        }
+
+        gl_label_object_get_size (object, &w, &h);
+        line_width = gl_label_object_get_line_width (object);
+
+        shadow_color_node = gl_label_object_get_shadow_color (object);
+        shadow_opacity    = gl_label_object_get_shadow_opacity (object);
+        compile_color (display_list, &shadow_color, shadow_color_node, shadow_opacity);
+        gl_color_node_free (&shadow_color_node);
+
+        if ( GL_IS_LABEL_LINE (object) )
+        {
+                shape_path (scratch_cr, object, 0.0, 0.0, w, h);
+
+                op->type       = DISPLAY_OP_STROKE;
+                op->path       = cairo_copy_path (scratch_cr);
+                op->line_color = shadow_color;
+                op->line_width = line_width;
+
+                return;
+        }
+
+        line_color_node = gl_label_object_get_line_color (object);
+        fill_color_node = gl_label_object_get_fill_color (object);
+
+        if ( !line_color_node->field_flag && !fill_color_node->field_flag )
+        {
+                if ( GL_COLOR_F_ALPHA (fill_color_node->color) )
+                {
+                        if ( GL_COLOR_F_ALPHA (line_color_node->color) )
+                        {
+                                /* Has FILL and OUTLINE: adjust size to account for line width. */
+                                shape_path (scratch_cr, object,
+                                            -line_width/2, -line_width/2,
+                                            w+line_width, h+line_width);
+                        }
+                        else
+                        {
+                                /* Has FILL but no OUTLINE. */
+                                shape_path (scratch_cr, object, 0.0, 0.0, w, h);
+                        }
+
+                        op->type       = DISPLAY_OP_FILL;
+                        op->fill_color = shadow_color;
+                }
+                else if ( GL_COLOR_F_ALPHA (line_color_node->color) )
+                {
+                        /* Has only OUTLINE. */
+                        shape_path (scratch_cr, object, 0.0, 0.0, w, h);
+
+                        op->type       = DISPLAY_OP_STROKE;
+                        op->line_color = shadow_color;
+                        op->line_width = line_width;
+                }
+                else
+                {
+                        /* Nothing to cast a shadow. */
+                        op->type = DISPLAY_OP_NONE;
+                }
+        }
+
+        if ( (op->type == DISPLAY_OP_FILL) || (op->type == DISPLAY_OP_STROKE) )
+        {
+                op->path = cairo_copy_path (scratch_cr);
+        }
+
+        gl_color_node_free (&line_color_node);
+        gl_color_node_free (&fill_color_node);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Compile draw op.  Mirrors draw_object() of box, ellipse, line   */
+/* and merged barcode objects, everything else is left to the object.        */
+/*---------------------------------------------------------------------------*/
+static void
+compile_draw (glDisplayList *display_list,
+              DisplayOp     *op,
+              cairo_t       *scratch_cr)
+{
+        glLabelObject       *object = op->object;
+        gdouble              w, h;
+        glColorNode         *line_color_node;
+        glColorNode         *fill_color_node;
+        glTextNode          *text_node;
+        glLabelBarcodeStyle *style;
+
+        op->type = DISPLAY_OP_OBJECT;
+
+        if ( GL_IS_LABEL_BOX (object) || GL_IS_LABEL_ELLIPSE (object) || GL_IS_LABEL_LINE (object) )
+        {
+                gl_label_object_get_size (object, &w, &h);
+                shape_path (scratch_cr, object, 0.0, 0.0, w, h);
+
+                op->type       = GL_IS_LABEL_LINE (object) ? DISPLAY_OP_STROKE : DISPLAY_OP_FILL_STROKE;
+                op->path       = cairo_copy_path (scratch_cr);
+                op->line_width = gl_label_object_get_line_width (object);
+
+                line_color_node = gl_label_object_get_line_color (object);
+                compile_color (display_list, &op->line_color, line_color_node, -1.0);
+                gl_color_node_free (&line_color_node);
+
+                if ( op->type == DISPLAY_OP_FILL_STROKE )
+                {
+                        fill_color_node = gl_label_object_get_fill_color (object);
+                        compile_color (display_list, &op->fill_color, fill_color_node, -1.0);
+                        gl_color_node_free (&fill_color_node);
+                }
+        }
+        else if ( GL_IS_LABEL_BARCODE (object) )
+        {
+                text_node = gl_label_barcode_get_data (GL_LABEL_BARCODE (object));
+
+                if ( text_node->field_flag )
+                {
+                        style = gl_label_barcode_get_style (GL_LABEL_BARCODE (object));
+
+                        op->type             = DISPLAY_OP_BARCODE;
+                        op->bc_key           = g_string_chunk_insert_const (display_list->strings,
+                                                                            text_node->data);
+                        op->bc_backend_id    = g_string_chunk_insert_const (display_list->strings,
+                                                                            style->backend_id);
+                        op->bc_id            = g_string_chunk_insert_const (display_list->strings,
+                                                                            style->id);
+                        op->bc_text_flag     = style->text_flag;
+                        op->bc_checksum_flag = style->checksum_flag;
+                        gl_label_object_get_raw_size (object, &op->bc_w, &op->bc_h);
+
+                        line_color_node = gl_label_object_get_line_color (object);
+                        compile_color (display_list, &op->line_color, line_color_node, -1.0);
+                        gl_color_node_free (&line_color_node);
+
+                        gl_label_barcode_style_free (style);
+                }
+
+                gl_text_node_free (&text_node);
+        }
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Compile color node.  A constant color is resolved now, a merge  */
+/* field is only looked up per record.                                       */
+/*---------------------------------------------------------------------------*/
+static void
+compile_color (glDisplayList *display_list,
+               DisplayColor  *color,
+               glColorNode   *color_node,
+               gdouble        opacity)
+{
+        color->opacity = opacity;
+
+        if ( color_node->field_flag )
+        {
+                color->color = GL_COLOR_NONE;
+                color->key   = g_string_chunk_insert_const (display_list->strings,
+                                                            color_node->key);
+        }
+        else
+        {
+                color->color = color_node->color;
+                color->key   = NULL;
+
+                if ( opacity >= 0.0 )
+                {
+                        color->color = gl_color_set_opacity (color->color, opacity);
+                }
+        }
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Create path of box, ellipse or line object.                     */
+/*---------------------------------------------------------------------------*/
+static void
+shape_path (cairo_t       *cr,
+            glLabelObject *object,
+            gdouble        x,
+            gdouble        y,
+            gdouble        w,
+            gdouble        h)
+{
+        cairo_new_path (cr);
+
+        if ( GL_IS_LABEL_ELLIPSE (object) )
+        {
+                /* The path is kept across the restore, with the translation applied. */
+                cairo_save (cr);
+                cairo_translate (cr, x, y);
+                gl_cairo_ellipse_path (cr, w/2, h/2);
+                cairo_restore (cr);
+        }
+        else if ( GL_IS_LABEL_LINE (object) )
+        {
+                cairo_move_to (cr, x, y);
+                cairo_line_to (cr, x + w, y + h);
+        }
+        else
+        {
+                cairo_rectangle (cr, x, y, w, h);
+        }
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Look up merge fields used as colors, parsed once per set of     */
+/* merge records, so that expanding them per record is an array lookup.      */
+/*---------------------------------------------------------------------------*/
+static void
+resolve_colors (glDisplayList *display_list)
+{
+        DisplayColor *color;
+        guint         i;
+
+        for ( i = 0; i < display_list->n_ops; i++ )
+        {
+                color = &display_list->ops[i].fill_color;
+                if ( color->key )
+                {
+                        color->column = gl_merge_get_color_column (display_list->merge,
+                                                                   color->key,
+                                                                   &color->n_values);
+                }
+
+                color = &display_list->ops[i].line_color;
+                if ( color->key )
+                {
+                        color->column = gl_merge_get_color_column (display_list->merge,
+                                                                   color->key,
+                                                                   &color->n_values);
+                }
+        }
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Expand color for given merge record, like                       */
+/* gl_color_node_expand(), without allocating.                               */
+/*---------------------------------------------------------------------------*/
+static guint
+expand_color (const DisplayColor *color,
+              glMergeRecord      *record)
+{
+        guint value;
+
+        if ( color->key == NULL )
+        {
+                return color->color;
+        }
+
+        if ( color->column && record && (record->index >= 0) && (record->index < color->n_values) )
+        {
+                value = color->column[record->index];
+        }
+        else
+        {
+                value = gl_color_parse (gl_merge_lookup_key (record, color->key));
+        }
+
+        if ( color->opacity >= 0.0 )
+        {
+                value = gl_color_set_opacity (value, color->opacity);
+        }
+
+        return value;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Draw barcode with merge field data.                             */
+/*---------------------------------------------------------------------------*/
+static void
+draw_barcode (const glDisplayList *display_list,
+              const DisplayOp     *op,
+              cairo_t             *cr,
+              glMergeRecord       *record)
+{
+        const gchar      *text;
+        guint             color;
+
+        if ( record == NULL )
+        {
+                /* Without a record the field reference itself is encoded. */
+                op->draw (op->object, cr, FALSE, record);
+                return;
+        }
+
+        text = gl_merge_lookup_key (record, op->bc_key);
+
+        color = expand_color (&op->line_color, record);
+        cairo_set_source_rgba (cr, GL_COLOR_RGBA_ARGS (color));
+
+        gl_barcode_backends_cache_render (display_list->barcodes, cr,
+                                          op->bc_backend_id, op->bc_id,
+                                          op->bc_text_flag, op->bc_checksum_flag,
+                                          op->bc_w, op->bc_h,
+                                          text ? text : "");
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Free display list.                                              */
+/*---------------------------------------------------------------------------*/
+static void
+display_list_free (glDisplayList *display_list)
+{
+        guint i;
+
+        for ( i = 0; i < display_list->n_ops; i++ )
+        {
+                if ( display_list->ops[i].path )
+                {
+                        cairo_path_destroy (display_list->ops[i].path);
+                }
+        }
+
+        g_free (display_list->ops);
+        g_string_chunk_free (display_list->strings);
+        if ( display_list->barcodes_owned )
+        {
+                gl_barcode_backends_cache_free (display_list->barcodes);
+        }
+        if ( display_list->merge )
+        {
+                g_object_unref (display_list->merge);
+        }
+        g_free (display_list);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Label "changed" or "merge_changed" callback: discard list.      */
+/*---------------------------------------------------------------------------*/
+static void
+label_changed_cb (glLabel  *label,
+                  gpointer  data)
+{
+        g_signal_handlers_disconnect_by_func (G_OBJECT (label),
+                                              G_CALLBACK (label_changed_cb),
+                                              data);
+
+        g_object_set_data (G_OBJECT (label), DISPLAY_LIST_KEY, NULL);
+}
+
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
@@ -0,0 +1,60 @@
+/*
+ *  display-list.h
+ *  Copyright (C) 2026  gLabels contributors.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __DISPLAY_LIST_H__
+#define __DISPLAY_LIST_H__
+
+#include <cairo.h>
+
+#include "label.h"
+#include "merge.h"
+#include "bc-backends.h"
+
+G_BEGIN_DECLS
+
+
+typedef struct _glDisplayList glDisplayList;
+
+
+const glDisplayList *gl_display_list_get               (glLabel             *label);
+
+void                 gl_display_list_set_barcode_cache (glLabel             *label,
+                                                        glBarcodeCache      *cache);
+
+void                 gl_display_list_draw              (const glDisplayList *display_list,
+                                                        cairo_t             *cr,
+                                                        glMergeRecord       *record);
+
+
+G_END_DECLS
+
+#endif /* __DISPLAY_LIST_H__ */
+
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
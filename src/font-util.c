@@ -25,105 +25,276 @@
 #include <glib.h>
 #include <pango/pango.h>
 #include <pango/pangocairo.h>
+#include <gtk/gtk.h>
 
 #include <libglabels.h>
 
 
+/*========================================================*/
+/* Private macros and constants.                          */
+/*========================================================*/
+
+/* Measured sizes kept per thread before the cache is flushed. */
+#define MEASURE_CACHE_MAX 1024
+
+/* Resolved families kept before the cache is flushed. */
+#define FALLBACK_CACHE_MAX 256
+
+
+/*========================================================*/
+/* Private types.                                         */
+/*========================================================*/
+
+typedef struct {
+        PangoFontMap *fontmap;
+        PangoContext *context;
+        GHashTable   *size_cache;
+} MeasureData;
+
+typedef struct {
+        GList        *all_families;           /* Sorted, owns names.         */
+        GList        *proportional_families;  /* Sorted.                     */
+        GList        *fixed_width_families;   /* Sorted.                     */
+        GHashTable   *index;                  /* Collate key to family name. */
+        GHashTable   *fallbacks;              /* Requested to valid family.  */
+} FontRegistry;
+
+
+/*========================================================*/
+/* Private function prototypes.                           */
+/*========================================================*/
+
+static FontRegistry *get_registry          (void);
+static gboolean      lookup_family         (FontRegistry *reg,
+                                            const gchar  *family);
+static void          fontconfig_changed_cb (GtkSettings  *settings,
+                                            GParamSpec   *pspec,
+                                            gpointer      data);
+
+static MeasureData *get_measure_data  (void);
+static void         measure_data_free (MeasureData *data);
+
+
+/*========================================================*/
+/* Private globals.                                       */
+/*========================================================*/
+
+static FontRegistry *registry = NULL;
+static GMutex        registry_mutex;
+static gboolean      fontconfig_handler_flag = FALSE;
+
+static GPrivate measure_data_key = G_PRIVATE_INIT ((GDestroyNotify)measure_data_free);
+
+
 /****************************************************************************/
-/* Get list of all available font families.                                 */
+/* Get list of all available font families.  Lists are owned by the font    */
+/* registry and remain valid until the font configuration changes.          */
 /****************************************************************************/
 const GList  *
 gl_font_util_get_all_families (void)
 {
-	static GList         *list = NULL;
-	PangoFontMap         *fontmap;
-	PangoContext         *context;
-	PangoFontFamily     **families;
-	gint                  n;
-	gint                  i;
-	gchar                *name;
+        const GList *list;
 
-        if ( !list )
-        {
-                fontmap = pango_cairo_font_map_new ();
-                context = pango_font_map_create_context (PANGO_FONT_MAP (fontmap));
+        g_mutex_lock (&registry_mutex);
+        list = get_registry ()->all_families;
+        g_mutex_unlock (&registry_mutex);
 
-                pango_context_list_families (context, &families, &n);
+	return list;
+}
 
-                for ( i=0; i<n; i++ )
-                {
-                        name = g_strdup (pango_font_family_get_name (families[i]));
-                        list = g_list_insert_sorted (list, name,
-                                                     (GCompareFunc)lgl_str_utf8_casecmp);
-                }
 
-                g_free (families);
+/****************************************************************************/
+/* Get list of all available proportional font families.                    */
+/****************************************************************************/
+const GList  *
+gl_font_util_get_proportional_families (void)
+{
+        const GList *list;
 
-                g_object_unref (context);
-                g_object_unref (fontmap);
-        }
+        g_mutex_lock (&registry_mutex);
+        list = get_registry ()->proportional_families;
+        g_mutex_unlock (&registry_mutex);
 
 	return list;
 }
 
 
 /****************************************************************************/
-/* Get list of all available proportional font families.                    */
+/* Get list of all available fixed-width font families.                     */
 /****************************************************************************/
 const GList  *
-gl_font_util_get_proportional_families (void)
+gl_font_util_get_fixed_width_families (void)
 {
-	static GList         *list = NULL;
-	PangoFontMap         *fontmap;
-	PangoContext         *context;
-	PangoFontFamily     **families;
-	gint                  n;
-	gint                  i;
-	gchar                *name;
+        const GList *list;
 
-        if ( !list )
-        {
-                fontmap = pango_cairo_font_map_new ();
-                context = pango_font_map_create_context (PANGO_FONT_MAP (fontmap));
+        g_mutex_lock (&registry_mutex);
+        list = get_registry ()->fixed_width_families;
+        g_mutex_unlock (&registry_mutex);
 
-                pango_context_list_families (context, &families, &n);
+	return list;
+}
 
-                for ( i=0; i<n; i++ )
+
+/****************************************************************************/
+/* Make sure we have a valid font.  If not provide a good default.          */
+/****************************************************************************/
+gchar *
+gl_font_util_validate_family (const gchar *family)
+{
+        FontRegistry *reg;
+        const gchar  *good_family;
+        gchar        *result;
+
+        g_return_val_if_fail (family, NULL);
+
+        g_mutex_lock (&registry_mutex);
+
+        reg = get_registry ();
+
+        if ( !g_hash_table_lookup_extended (reg->fallbacks, family,
+                                            NULL, (gpointer *)&good_family) )
+        {
+                if ( lookup_family (reg, family) )
                 {
-                        if ( !pango_font_family_is_monospace (families[i]) )
-                        {
-                                name = g_strdup (pango_font_family_get_name (families[i]));
-                                list = g_list_insert_sorted (list, name,
-                                                             (GCompareFunc)lgl_str_utf8_casecmp);
-                        }
+                        good_family = family;
+                }
+                else if ( lookup_family (reg, "Sans") )
+                {
+                        good_family = "Sans";
+                }
+                else if ( reg->all_families != NULL )
+                {
+                        good_family = reg->all_families->data; /* 1st entry */
+                }
+                else
+                {
+                        good_family = NULL;
                 }
 
-                g_free (families);
-
-                g_object_unref (context);
-                g_object_unref (fontmap);
+                if ( g_hash_table_size (reg->fallbacks) >= FALLBACK_CACHE_MAX )
+                {
+                        g_hash_table_remove_all (reg->fallbacks);
+                }
+                g_hash_table_insert (reg->fallbacks,
+                                     g_strdup (family), g_strdup (good_family));
         }
 
-	return list;
+        /* good_family may point into the registry, copy before unlocking. */
+        result = g_strdup (good_family);
+
+        g_mutex_unlock (&registry_mutex);
+
+        return result;
 }
 
 
 /****************************************************************************/
-/* Get list of all available fixed-width font families.                     */
+/* Test if font is installed.                                               */
 /****************************************************************************/
-const GList  *
-gl_font_util_get_fixed_width_families (void)
+gboolean
+gl_font_util_is_family_installed (const gchar *family)
+{
+        gboolean installed_flag;
+
+        g_return_val_if_fail (family, FALSE);
+
+        g_mutex_lock (&registry_mutex);
+        installed_flag = lookup_family (get_registry (), family);
+        g_mutex_unlock (&registry_mutex);
+
+        return installed_flag;
+}
+
+
+
+/****************************************************************************/
+/* Get shared context for measuring text, independent of any display.       */
+/* One font map and context is created per thread and reused, so fonts are */
+/* only loaded from fontconfig once.                                        */
+/****************************************************************************/
+PangoContext *
+gl_font_util_get_measure_context (void)
+{
+        return get_measure_data ()->context;
+}
+
+
+/****************************************************************************/
+/* Measure size of text laid out with given font, in pango units.           */
+/****************************************************************************/
+void
+gl_font_util_measure_text (const PangoFontDescription *desc,
+                           gint                        spacing,
+                           const gchar                *text,
+                           gint                       *iw,
+                           gint                       *ih)
+{
+        MeasureData  *data;
+        gchar        *desc_string;
+        gchar        *key;
+        gint         *size;
+        PangoLayout  *layout;
+
+        data = get_measure_data ();
+
+        desc_string = pango_font_description_to_string (desc);
+        key = g_strdup_printf ("%s\x1f%d\x1f%s", desc_string, spacing, text);
+        g_free (desc_string);
+
+        size = g_hash_table_lookup (data->size_cache, key);
+        if ( size == NULL )
+        {
+                layout = pango_layout_new (data->context);
+                pango_layout_set_font_description (layout, desc);
+                pango_layout_set_spacing (layout, spacing);
+                pango_layout_set_text (layout, text, -1);
+
+                size = g_new (gint, 2);
+                pango_layout_get_size (layout, &size[0], &size[1]);
+
+                g_object_unref (layout);
+
+                if ( g_hash_table_size (data->size_cache) >= MEASURE_CACHE_MAX )
+                {
+                        g_hash_table_remove_all (data->size_cache);
+                }
+                g_hash_table_insert (data->size_cache, key, size);
+        }
+        else
+        {
+                g_free (key);
+        }
+
+        *iw = size[0];
+        *ih = size[1];
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  Get font registry, enumerating installed families if needed.   */
+/* Families are enumerated once, from a single font map, until fontconfig   */
+/* reports a change.  Must be called with registry_mutex held.              */
+/*--------------------------------------------------------------------------*/
+static FontRegistry *
+get_registry (void)
 {
-	static GList         *list = NULL;
 	PangoFontMap         *fontmap;
 	PangoContext         *context;
 	PangoFontFamily     **families;
 	gint                  n;
 	gint                  i;
 	gchar                *name;
+        GtkSettings          *settings;
 
-        if ( !list )
+        if ( registry == NULL )
         {
+                registry = g_new0 (FontRegistry, 1);
+
+                registry->index     = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                             g_free, NULL);
+                registry->fallbacks = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                             g_free, g_free);
+
                 fontmap = pango_cairo_font_map_new ();
                 context = pango_font_map_create_context (PANGO_FONT_MAP (fontmap));
 
@@ -131,76 +302,136 @@ gl_font_util_get_fixed_width_families (void)
 
                 for ( i=0; i<n; i++ )
                 {
+                        name = g_strdup (pango_font_family_get_name (families[i]));
+
+                        /* Lists share names, which are owned by all_families. */
+                        registry->all_families = g_list_prepend (registry->all_families, name);
                         if ( pango_font_family_is_monospace (families[i]) )
                         {
-                                name = g_strdup (pango_font_family_get_name (families[i]));
-                                list = g_list_insert_sorted (list, name,
-                                                             (GCompareFunc)lgl_str_utf8_casecmp);
+                                registry->fixed_width_families =
+                                        g_list_prepend (registry->fixed_width_families, name);
                         }
+                        else
+                        {
+                                registry->proportional_families =
+                                        g_list_prepend (registry->proportional_families, name);
+                        }
+
+                        /* Keyed like g_utf8_collate() compares, name is the value. */
+                        g_hash_table_insert (registry->index,
+                                             g_utf8_collate_key (name, -1), name);
                 }
 
+                registry->all_families =
+                        g_list_sort (registry->all_families, (GCompareFunc)lgl_str_utf8_casecmp);
+                registry->proportional_families =
+                        g_list_sort (registry->proportional_families, (GCompareFunc)lgl_str_utf8_casecmp);
+                registry->fixed_width_families =
+                        g_list_sort (registry->fixed_width_families, (GCompareFunc)lgl_str_utf8_casecmp);
+
                 g_free (families);
 
                 g_object_unref (context);
                 g_object_unref (fontmap);
+
+                /* No settings without a display, e.g. glabels-batch. */
+                settings = gtk_settings_get_default ();
+                if ( settings && !fontconfig_handler_flag )
+                {
+                        g_signal_connect (G_OBJECT (settings), "notify::gtk-fontconfig-timestamp",
+                                          G_CALLBACK (fontconfig_changed_cb), NULL);
+                        fontconfig_handler_flag = TRUE;
+                }
         }
 
-	return list;
+        return registry;
 }
 
 
-/****************************************************************************/
-/* Make sure we have a valid font.  If not provide a good default.          */
-/****************************************************************************/
-gchar *
-gl_font_util_validate_family (const gchar *family)
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  Is family installed?  Must be called with registry_mutex held. */
+/*--------------------------------------------------------------------------*/
+static gboolean
+lookup_family (FontRegistry *reg,
+               const gchar  *family)
 {
-        const GList *installed_families;
-        gchar       *good_family;
+        gchar    *key;
+        gboolean  found_flag;
 
-        installed_families = gl_font_util_get_all_families ();
+        key = g_utf8_collate_key (family, -1);
+        found_flag = g_hash_table_contains (reg->index, key);
+        g_free (key);
 
-        if (g_list_find_custom ((GList *)installed_families,
-                                family,
-                                (GCompareFunc)g_utf8_collate))
-        {
-                good_family = g_strdup (family);
-        }
-        else if (g_list_find_custom ((GList *)installed_families,
-                                     "Sans",
-                                     (GCompareFunc)g_utf8_collate))
-        {
-                good_family = g_strdup ("Sans");
-        }
-        else if (installed_families != NULL)
-        {
-                good_family = g_strdup (installed_families->data); /* 1st entry */
-        }
-        else
+        return found_flag;
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  Fontconfig configuration changed (fonts were installed or      */
+/* removed): drop registry, it is enumerated again when next needed.        */
+/*--------------------------------------------------------------------------*/
+static void
+fontconfig_changed_cb (GtkSettings *settings,
+                       GParamSpec  *pspec,
+                       gpointer     data)
+{
+        g_mutex_lock (&registry_mutex);
+        if ( registry )
         {
-                good_family = NULL;
+                g_list_free (registry->proportional_families);
+                g_list_free (registry->fixed_width_families);
+                g_list_free_full (registry->all_families, g_free);
+                g_hash_table_destroy (registry->index);
+                g_hash_table_destroy (registry->fallbacks);
+                g_free (registry);
+                registry = NULL;
         }
-
-        return good_family;
+        g_mutex_unlock (&registry_mutex);
 }
 
 
-/****************************************************************************/
-/* Test if font is installed.                                               */
-/****************************************************************************/
-gboolean
-gl_font_util_is_family_installed (const gchar *family)
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  Get measurement data for current thread, creating if needed.   */
+/*--------------------------------------------------------------------------*/
+static MeasureData *
+get_measure_data (void)
 {
-        const GList *installed_families;
-        GList       *p;
+        MeasureData          *data;
+	cairo_font_options_t *options;
+
+        data = g_private_get (&measure_data_key);
+        if ( data == NULL )
+        {
+                data = g_new0 (MeasureData, 1);
+
+                data->fontmap = pango_cairo_font_map_new ();
+                data->context = pango_font_map_create_context (data->fontmap);
+
+                options = cairo_font_options_create ();
+                cairo_font_options_set_hint_style (options, CAIRO_HINT_STYLE_NONE);
+                cairo_font_options_set_hint_metrics (options, CAIRO_HINT_METRICS_OFF);
+                pango_cairo_context_set_font_options (data->context, options);
+                cairo_font_options_destroy (options);
 
-        installed_families = gl_font_util_get_all_families ();
+                data->size_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 
-        p = g_list_find_custom ((GList *)installed_families,
-                                family,
-                                (GCompareFunc)g_utf8_collate);
+                g_private_set (&measure_data_key, data);
+        }
+
+        return data;
+}
 
-        return (p != NULL);
+
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  Free measurement data of exiting thread.                       */
+/*--------------------------------------------------------------------------*/
+static void
+measure_data_free (MeasureData *data)
+{
+        g_hash_table_destroy (data->size_cache);
+        g_object_unref (data->context);
+        g_object_unref (data->fontmap);
+        g_free (data);
 }
 
 
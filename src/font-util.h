@@ -22,6 +22,7 @@
 #define __FONT_UTIL_H__
 
 #include <glib.h>
+#include <pango/pango.h>
 
 G_BEGIN_DECLS
 
@@ -32,6 +33,14 @@ const GList *gl_font_util_get_fixed_width_families  (void);
 gchar       *gl_font_util_validate_family           (const gchar *family);
 gboolean     gl_font_util_is_family_installed       (const gchar *family);
 
+PangoContext *gl_font_util_get_measure_context      (void);
+
+void          gl_font_util_measure_text             (const PangoFontDescription *desc,
+                                                     gint                        spacing,
+                                                     const gchar                *text,
+                                                     gint                       *iw,
+                                                     gint                       *ih);
+
 G_END_DECLS
 
 #endif /* __FONT_UTIL_H__ */
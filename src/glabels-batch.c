@@ -21,8 +21,10 @@
 #include <config.h>
 
 #include <glib/gi18n.h>
+#include <cairo-pdf.h>
 
 #include <math.h>
+#include <string.h>
 
 #include <libglabels.h>
 #include "merge-init.h"
@@ -31,10 +33,47 @@
 #include "xml-label.h"
 #include "print.h"
 #include "print-op.h"
+#include "display-list.h"
 #include "file-util.h"
 #include "prefs.h"
 #include "debug.h"
 
+/*============================================*/
+/* Private types                              */
+/*============================================*/
+
+/* One manifest entry. */
+typedef struct {
+        gint             line;
+        gchar           *document;
+        gchar           *output;
+        gchar           *input;
+        gint             n_copies;
+        gint             n_sheets;
+        gint             first;
+        gint             last;
+        gboolean         outline_flag;
+        gboolean         reverse_flag;
+        gboolean         crop_marks_flag;
+
+        glLabel         *label;
+        gboolean         merge_flag;
+        gboolean         ok_flag;
+} Job;
+
+/* State shared by all jobs of a manifest. */
+typedef struct {
+        GHashTable      *documents;   /* absolute filename -> glLabel */
+        GHashTable      *merges;      /* merge name + src -> glMerge  */
+        glBarcodeCache  *barcodes;    /* encoded merge barcodes       */
+        GThreadPool     *pool;
+        GAsyncQueue     *done_queue;
+        gint             n_pending;
+        gint             n_printed;
+        gint             n_failed;
+} Manifest;
+
+
 /*============================================*/
 /* Private globals                            */
 /*============================================*/
@@ -46,6 +85,8 @@ static gboolean outline_flag     = FALSE;
 static gboolean reverse_flag     = FALSE;
 static gboolean crop_marks_flag  = FALSE;
 static gchar    *input           = NULL;
+static gchar    *manifest        = NULL;
+static gint     n_jobs           = 0;
 static gchar    **remaining_args = NULL;
 
 static GOptionEntry option_entries[] = {
@@ -65,12 +106,44 @@ static GOptionEntry option_entries[] = {
          N_("print crop marks"), NULL},
         {"input", 'i', 0, G_OPTION_ARG_STRING, &input,
          N_("input file for merging"), N_("filename")},
+        {"manifest", 'm', 0, G_OPTION_ARG_FILENAME, &manifest,
+         N_("read jobs, one per line, from manifest file (\"-\" for standard input)"), N_("filename")},
+        {"jobs", 'j', 0, G_OPTION_ARG_INT, &n_jobs,
+         N_("number of manifest jobs to print in parallel (default=number of processors)"), N_("jobs")},
         { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY,
           &remaining_args, NULL, N_("[FILE...]") },
         { NULL }
 };
 
 
+/*============================================*/
+/* Local function prototypes                  */
+/*============================================*/
+
+static gint      run_manifest    (const gchar      *filename);
+
+static Job      *parse_job       (const gchar      *line,
+                                  gint              line_no);
+
+static gboolean  prepare_job     (Manifest         *m,
+                                  Job              *job);
+
+static glLabel  *get_document    (Manifest         *m,
+                                  const gchar      *filename);
+
+static glMerge  *get_merge       (Manifest         *m,
+                                  glLabel          *label,
+                                  const gchar      *src);
+
+static void      render_job      (Job              *job,
+                                  GAsyncQueue      *done_queue);
+
+static void      finish_job      (Manifest         *m,
+                                  Job              *job);
+
+static void      free_job        (Job              *job);
+
+
 
 /*****************************************************************************/
 /* Main                                                                      */
@@ -88,6 +161,7 @@ main (int argc, char **argv)
         glXMLLabelStatus   status;
         glPrintOp         *print_op;
 	gchar	          *utf8_filename;
+        gint               status_code = 0;
         GError            *error = NULL;
 
         bindtextdomain (GETTEXT_PACKAGE, GLABELS_LOCALE_DIR);
@@ -133,6 +207,13 @@ main (int argc, char **argv)
 	gl_template_history_init_null ();
 	gl_font_history_init_null ();
 
+        /* print manifest jobs, if any */
+        if (manifest != NULL) {
+                if ( run_manifest (manifest) != 0 ) {
+                        status_code = 1;
+                }
+        }
+
         /* now print the files */
         for (p = file_list; p; p = p->next) {
                 g_print ("LABEL FILE = %s\n", (gchar *) p->data);
@@ -190,7 +271,411 @@ main (int argc, char **argv)
 
         g_list_free (file_list);
 
-        return 0;
+        GL_TRACE_WRITE ();
+
+        return status_code;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Run all jobs of manifest.  Documents, merge sources, the        */
+/* template database and barcode encodings are shared by all jobs, and       */
+/* labels are rendered by a pool of worker threads.  Returns number of       */
+/* failed jobs.                                                              */
+/*---------------------------------------------------------------------------*/
+static gint
+run_manifest (const gchar *filename)
+{
+        Manifest    m;
+        GIOChannel *channel;
+        gchar      *line;
+        gint        line_no = 0;
+        Job        *job;
+        GError     *error = NULL;
+
+        gl_debug (DEBUG_PRINT, "START");
+
+        if ( strcmp (filename, "-") == 0 ) {
+                channel = g_io_channel_unix_new (0);
+        } else {
+                channel = g_io_channel_new_file (filename, "r", &error);
+                if ( channel == NULL ) {
+                        fprintf (stderr, _("cannot open manifest %s: %s\n"),
+                                 filename, error->message);
+                        g_error_free (error);
+                        return 1;
+                }
+        }
+
+        if ( n_jobs < 1 ) {
+                n_jobs = g_get_num_processors ();
+        }
+
+        m.documents  = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                              g_free, g_object_unref);
+        m.merges     = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                              g_free, g_object_unref);
+        m.barcodes   = gl_barcode_backends_cache_new ();
+        m.done_queue = g_async_queue_new ();
+        m.n_pending  = 0;
+        m.n_printed  = 0;
+        m.n_failed   = 0;
+
+        /* Exclusive threads are kept for the whole run, along with their font maps. */
+        m.pool = g_thread_pool_new ((GFunc)render_job, m.done_queue,
+                                    n_jobs, TRUE, NULL);
+
+        while ( g_io_channel_read_line (channel, &line, NULL, NULL, &error) == G_IO_STATUS_NORMAL ) {
+                line_no++;
+
+                g_strstrip (line);
+                if ( (*line == '\0') || (*line == '#') ) {
+                        g_free (line);
+                        continue;
+                }
+
+                job = parse_job (line, line_no);
+                g_free (line);
+
+                if ( (job == NULL) || !prepare_job (&m, job) ) {
+                        free_job (job);
+                        m.n_failed++;
+                        continue;
+                }
+
+                /* Bound the number of labels in memory. */
+                while ( m.n_pending >= 2*n_jobs ) {
+                        finish_job (&m, g_async_queue_pop (m.done_queue));
+                }
+
+                m.n_pending++;
+                g_thread_pool_push (m.pool, job, NULL);
+        }
+        if ( error != NULL ) {
+                fprintf (stderr, _("error reading manifest %s: %s\n"),
+                         filename, error->message);
+                g_error_free (error);
+                m.n_failed++;
+        }
+
+        while ( m.n_pending > 0 ) {
+                finish_job (&m, g_async_queue_pop (m.done_queue));
+        }
+
+        g_thread_pool_free (m.pool, FALSE, TRUE);
+        g_async_queue_unref (m.done_queue);
+        g_hash_table_destroy (m.merges);
+        g_hash_table_destroy (m.documents);
+        gl_barcode_backends_cache_free (m.barcodes);
+        g_io_channel_unref (channel);
+
+        g_print ("%d jobs printed, %d failed\n", m.n_printed, m.n_failed);
+
+        gl_debug (DEBUG_PRINT, "END");
+
+        return m.n_failed;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Parse manifest line.  A line has the same syntax as the         */
+/* command line, naming exactly one document.  Options not given on the      */
+/* line default to the ones given on the command line.                       */
+/*---------------------------------------------------------------------------*/
+static Job *
+parse_job (const gchar *line,
+           gint         line_no)
+{
+        Job             *job = g_new0 (Job, 1);
+        gchar          **remaining = NULL;
+        GOptionEntry     entries[] = {
+                {"output", 'o', 0, G_OPTION_ARG_STRING, &job->output, NULL, NULL},
+                {"sheets", 's', 0, G_OPTION_ARG_INT, &job->n_sheets, NULL, NULL},
+                {"copies", 'c', 0, G_OPTION_ARG_INT, &job->n_copies, NULL, NULL},
+                {"first", 'f', 0, G_OPTION_ARG_INT, &job->first, NULL, NULL},
+                {"outline", 'l', 0, G_OPTION_ARG_NONE, &job->outline_flag, NULL, NULL},
+                {"reverse", 'r', 0, G_OPTION_ARG_NONE, &job->reverse_flag, NULL, NULL},
+                {"cropmarks", 'C', 0, G_OPTION_ARG_NONE, &job->crop_marks_flag, NULL, NULL},
+                {"input", 'i', 0, G_OPTION_ARG_STRING, &job->input, NULL, NULL},
+                { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY,
+                  &remaining, NULL, NULL },
+                { NULL }
+        };
+        GOptionContext  *context;
+        gchar          **argv, **job_argv;
+        gint             argc, i;
+        gchar           *base;
+        gboolean         ok_flag;
+        GError          *error = NULL;
+
+        job->line            = line_no;
+        job->n_copies        = n_copies;
+        job->n_sheets        = n_sheets;
+        job->first           = first;
+        job->outline_flag    = outline_flag;
+        job->reverse_flag    = reverse_flag;
+        job->crop_marks_flag = crop_marks_flag;
+
+        if ( !g_shell_parse_argv (line, &argc, &argv, &error) ) {
+                fprintf (stderr, _("manifest line %d: %s\n"), line_no, error->message);
+                g_error_free (error);
+                free_job (job);
+                return NULL;
+        }
+
+        /* Option parser expects program name first.  Strings stay owned by argv. */
+        job_argv = g_new0 (gchar *, argc + 2);
+        job_argv[0] = (gchar *)g_get_prgname ();
+        for ( i = 0; i < argc; i++ ) {
+                job_argv[i+1] = argv[i];
+        }
+        argc++;
+
+        context = g_option_context_new (NULL);
+        g_option_context_set_help_enabled (context, FALSE);
+        g_option_context_add_main_entries (context, entries, NULL);
+        ok_flag = g_option_context_parse (context, &argc, &job_argv, &error);
+        g_option_context_free (context);
+        g_free (job_argv);
+        g_strfreev (argv);
+
+        if ( !ok_flag ) {
+                fprintf (stderr, _("manifest line %d: %s\n"), line_no, error->message);
+                g_error_free (error);
+                g_strfreev (remaining);
+                free_job (job);
+                return NULL;
+        }
+
+        if ( (remaining == NULL) || (g_strv_length (remaining) != 1) ) {
+                fprintf (stderr, _("manifest line %d: exactly one glabels file is required\n"), line_no);
+                g_strfreev (remaining);
+                free_job (job);
+                return NULL;
+        }
+        job->document = gl_file_util_make_absolute (remaining[0]);
+        g_strfreev (remaining);
+
+        if ( job->input == NULL ) {
+                job->input = g_strdup (input);
+        }
+
+        /* Without explicit output, print next to document, not to a shared file. */
+        if ( job->output == NULL ) {
+                base = gl_file_util_remove_extension (job->document);
+                job->output = g_strdup_printf ("%s.pdf", base);
+                g_free (base);
+        } else {
+                base = job->output;
+                job->output = gl_file_util_make_absolute (base);
+                g_free (base);
+        }
+
+        return job;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Prepare job's private copy of its document (main thread).       */
+/*---------------------------------------------------------------------------*/
+static gboolean
+prepare_job (Manifest *m,
+             Job      *job)
+{
+        glLabel           *label;
+        glMerge           *merge;
+        const lglTemplate *template;
+        lglTemplateFrame  *frame;
+        gint               n_labels;
+
+        label = get_document (m, job->document);
+        if ( label == NULL ) {
+                fprintf (stderr, _("cannot open glabels file %s\n"), job->document);
+                return FALSE;
+        }
+
+        if ( job->input != NULL ) {
+                merge = get_merge (m, label, job->input);
+                if ( merge == NULL ) {
+                        fprintf ( stderr,
+                                  _("cannot perform document merge with glabels file %s\n"),
+                                  job->document );
+                        return FALSE;
+                }
+                job->label = gl_label_dup (label);
+                gl_label_set_merge (job->label, merge, FALSE);
+        } else {
+                job->label = gl_label_dup (label);
+        }
+
+        gl_display_list_set_barcode_cache (job->label, m->barcodes);
+
+        template = gl_label_get_template (job->label);
+        frame    = (lglTemplateFrame *)template->frames->data;
+        n_labels = lgl_template_frame_get_n_labels (frame);
+
+        merge = gl_label_get_merge (job->label);
+        if ( merge != NULL ) {
+                job->merge_flag = TRUE;
+                job->n_sheets   = ceil ((double)(job->first-1 + job->n_copies * gl_merge_get_record_count (merge))
+                                        / n_labels);
+                g_object_unref (merge);
+        } else {
+                job->last = n_labels;
+        }
+
+        return TRUE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Get document, opening it only the first time it is used.        */
+/*---------------------------------------------------------------------------*/
+static glLabel *
+get_document (Manifest    *m,
+              const gchar *filename)
+{
+        glLabel          *label;
+        glXMLLabelStatus  status;
+
+        label = g_hash_table_lookup (m->documents, filename);
+        if ( label == NULL ) {
+                g_print ("LABEL FILE = %s\n", filename);
+
+                label = gl_xml_label_open (filename, &status);
+                if ( status != XML_LABEL_OK ) {
+                        return NULL;
+                }
+                g_hash_table_insert (m->documents, g_strdup (filename), label);
+        }
+
+        return label;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Get merge of document's type reading src, reading each source   */
+/* only the first time it is used.  Copies share the parsed records.         */
+/*---------------------------------------------------------------------------*/
+static glMerge *
+get_merge (Manifest    *m,
+           glLabel     *label,
+           const gchar *src)
+{
+        glMerge *merge;
+        gchar   *name, *key;
+
+        merge = gl_label_get_merge (label);
+        if ( merge == NULL ) {
+                return NULL;
+        }
+
+        name = gl_merge_get_name (merge);
+        key  = g_strdup_printf ("%s\n%s", name, src);
+        g_free (name);
+
+        if ( g_hash_table_lookup (m->merges, key) == NULL ) {
+                gl_merge_set_src (merge, src);
+                g_hash_table_insert (m->merges, key, merge);
+        } else {
+                g_object_unref (merge);
+                merge = g_hash_table_lookup (m->merges, key);
+                g_free (key);
+        }
+
+        return merge;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Render job to PDF (worker thread).                              */
+/*---------------------------------------------------------------------------*/
+static void
+render_job (Job         *job,
+            GAsyncQueue *done_queue)
+{
+        const lglTemplate *template;
+        cairo_surface_t   *surface;
+        cairo_t           *cr;
+        glPrintState       state;
+        gint               i;
+
+        template = gl_label_get_template (job->label);
+
+        surface = cairo_pdf_surface_create (job->output,
+                                            template->page_width,
+                                            template->page_height);
+        cr = cairo_create (surface);
+
+        for ( i = 0; i < job->n_sheets; i++ ) {
+                if ( job->merge_flag ) {
+                        gl_print_uncollated_merge_sheet (job->label, cr, i,
+                                                         job->n_copies,
+                                                         job->first,
+                                                         job->outline_flag,
+                                                         job->reverse_flag,
+                                                         job->crop_marks_flag,
+                                                         &state);
+                } else {
+                        gl_print_simple_sheet (job->label, cr, i,
+                                               job->n_sheets,
+                                               job->first,
+                                               job->last,
+                                               job->outline_flag,
+                                               job->reverse_flag,
+                                               job->crop_marks_flag);
+                }
+                cairo_show_page (cr);
+        }
+
+        cairo_destroy (cr);
+        cairo_surface_finish (surface);
+        job->ok_flag = (cairo_surface_status (surface) == CAIRO_STATUS_SUCCESS);
+        cairo_surface_destroy (surface);
+
+        g_async_queue_push (done_queue, job);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Report and free finished job (main thread).                     */
+/*---------------------------------------------------------------------------*/
+static void
+finish_job (Manifest *m,
+            Job      *job)
+{
+        m->n_pending--;
+
+        if ( job->ok_flag ) {
+                g_print ("OUTPUT = %s\n", job->output);
+                m->n_printed++;
+        } else {
+                fprintf (stderr, _("manifest line %d: cannot write %s\n"),
+                         job->line, job->output);
+                m->n_failed++;
+        }
+
+        free_job (job);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Free job.  NULL safe.                                           */
+/*---------------------------------------------------------------------------*/
+static void
+free_job (Job *job)
+{
+        if ( job == NULL ) {
+                return;
+        }
+
+        if ( job->label != NULL ) {
+                g_object_unref (job->label);
+        }
+        g_free (job->document);
+        g_free (job->output);
+        g_free (job->input);
+        g_free (job);
 }
 
 
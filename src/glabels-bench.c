@@ -0,0 +1,948 @@
+/*
+ *  glabels-bench.c
+ *  Copyright (C) 2026  gLabels contributors.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <cairo-pdf.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <libglabels.h>
+#include "merge-init.h"
+#include "template-history.h"
+#include "font-history.h"
+#include "xml-label.h"
+#include "print.h"
+#include "label-text.h"
+#include "label-box.h"
+#include "label-ellipse.h"
+#include "label-image.h"
+#include "label-barcode.h"
+#include "bc-backends.h"
+#include "prefs.h"
+#include "debug.h"
+
+
+/*========================================================*/
+/* Private macros and constants.                          */
+/*========================================================*/
+#define BENCH_MERGE_TYPE   "Text/Comma/Line1Keys"
+#define PNG_RESOLUTION_DPI 150.0
+#define IMAGE_SIZE_PIXELS  256
+
+
+/*========================================================*/
+/* Private types.                                         */
+/*========================================================*/
+typedef struct {
+        const gchar  *name;
+        void        (*build) (glLabel     *label,
+                              const gchar *dir);
+} BenchDoc;
+
+typedef struct {
+        gint64        start;
+        GString      *json;
+        gboolean      first_flag;
+} Phases;
+
+
+/*============================================*/
+/* Private globals                            */
+/*============================================*/
+static gint     n_rows           = 1000;
+static gchar    *template_name   = "Avery 5160";
+static gchar    *dir             = NULL;
+static gchar    *output          = NULL;
+static gchar    *only            = NULL;
+
+static GOptionEntry option_entries[] = {
+        {"rows", 'n', 0, G_OPTION_ARG_INT, &n_rows,
+         N_("number of merge records (default=1000)"), N_("rows")},
+        {"template", 't', 0, G_OPTION_ARG_STRING, &template_name,
+         N_("template name (default=\"Avery 5160\")"), N_("name")},
+        {"dir", 'd', 0, G_OPTION_ARG_FILENAME, &dir,
+         N_("directory for generated documents and output (default=temporary)"), N_("directory")},
+        {"output", 'o', 0, G_OPTION_ARG_FILENAME, &output,
+         N_("write JSON report to file (default=stdout)"), N_("filename")},
+        {"only", 'O', 0, G_OPTION_ARG_STRING, &only,
+         N_("only run named document"), N_("name")},
+        { NULL }
+};
+
+static const gchar *first_names[] = {
+        "Ada", "Bjorn", "Chidi", "Dolores", "Emeka", "Francoise", "Gunther",
+        "Hiroko", "Ines", "Jaroslav", "Kalani", "Ludmila", "Mateus", "Nkechi"
+};
+
+static const gchar *last_names[] = {
+        "Abernathy-Whitfield", "Bauer", "Castellanos", "Dubois", "Eriksson",
+        "Fitzgerald", "Gonzalez de la Vega", "Hakobyan", "Ivanova", "Jovanovic"
+};
+
+static const gchar *streets[] = {
+        "Main Street", "Oak Avenue", "Industrial Parkway", "Rue de la Paix",
+        "Elm Court", "Martin Luther King Jr. Boulevard", "Harbour Road"
+};
+
+static const gchar *cities[] = {
+        "Springfield", "Riverside", "Fairview", "Greenville", "Bristol",
+        "Clinton", "Madison", "Georgetown"
+};
+
+
+/*========================================================*/
+/* Private function prototypes.                           */
+/*========================================================*/
+
+static void     build_address  (glLabel       *label,
+                                const gchar   *dir);
+static void     build_barcode  (glLabel       *label,
+                                const gchar   *dir);
+static void     build_2d       (glLabel       *label,
+                                const gchar   *dir);
+static void     build_image    (glLabel       *label,
+                                const gchar   *dir);
+static void     build_svg      (glLabel       *label,
+                                const gchar   *dir);
+static void     build_logo     (glLabel       *label,
+                                const gchar   *dir);
+static void     build_shadow   (glLabel       *label,
+                                const gchar   *dir);
+static void     build_shrink   (glLabel       *label,
+                                const gchar   *dir);
+
+static void     add_text       (glLabel       *label,
+                                const gchar   *text,
+                                gdouble        x,
+                                gdouble        y,
+                                gdouble        w,
+                                gdouble        h,
+                                gdouble        font_size);
+
+static glLabelObject *add_svg   (glLabel       *label,
+                                const gchar   *dir,
+                                gdouble        x,
+                                gdouble        y,
+                                gdouble        w,
+                                gdouble        h);
+
+static void     add_barcode    (glLabel       *label,
+                                const gchar   *backend_id,
+                                const gchar   *id,
+                                const gchar   *data,
+                                gdouble        x,
+                                gdouble        y,
+                                gdouble        w,
+                                gdouble        h);
+
+static gboolean write_csv      (const gchar   *filename,
+                                gint           n);
+
+static void     run_doc        (const BenchDoc *doc,
+                                const gchar   *csv_filename,
+                                GString       *json);
+
+static void     render_pdf     (glLabel       *label,
+                                const gchar   *filename,
+                                gint           n_sheets);
+
+static void     render_png     (glLabel       *label,
+                                gint           n_sheets,
+                                gsize         *n_bytes);
+
+static void     render_recording (glLabel     *label,
+                                  gint         n_sheets);
+
+static cairo_status_t count_bytes (gsize               *n_bytes,
+                                   const unsigned char *data,
+                                   unsigned int         length);
+
+static void     phase_begin    (Phases        *phases);
+static gdouble  phase_end      (Phases        *phases,
+                                const gchar   *name);
+
+
+/*========================================================*/
+/* Private data.                                          */
+/*========================================================*/
+static const BenchDoc docs[] = {
+        { "address", build_address },
+        { "barcode", build_barcode },
+        { "2d",      build_2d },
+        { "image",   build_image },
+        { "svg",     build_svg },
+        { "logo",    build_logo },
+        { "shadow",  build_shadow },
+        { "shrink",  build_shrink },
+};
+
+
+
+/*****************************************************************************/
+/* Main                                                                      */
+/*****************************************************************************/
+int
+main (int argc, char **argv)
+{
+	GOptionContext    *option_context;
+        gchar             *csv_filename;
+        GString           *json;
+        gint64             start;
+        guint              i;
+        GError            *error = NULL;
+
+        bindtextdomain (GETTEXT_PACKAGE, GLABELS_LOCALE_DIR);
+	bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
+        textdomain (GETTEXT_PACKAGE);
+
+	option_context = g_option_context_new (NULL);
+        g_option_context_set_summary (option_context,
+                                      _("Render a generated corpus of gLabels documents and report timings."));
+	g_option_context_add_main_entries (option_context, option_entries, GETTEXT_PACKAGE);
+
+
+        /* Initialize minimal gtk program */
+        gtk_parse_args (&argc, &argv);
+        if (!g_option_context_parse (option_context, &argc, &argv, &error))
+	{
+	        g_print(_("%s\nRun '%s --help' to see a full list of available command line options.\n"),
+			error->message, argv[0]);
+		g_error_free (error);
+		return 1;
+	}
+        if ( n_rows < 1 )
+        {
+                fprintf (stderr, "rows must be at least 1\n");
+                return 1;
+        }
+
+        if ( dir == NULL )
+        {
+                dir = g_dir_make_tmp ("glabels-bench-XXXXXX", &error);
+                if ( dir == NULL )
+                {
+                        fprintf (stderr, "%s\n", error->message);
+                        g_error_free (error);
+                        return 1;
+                }
+        }
+        else if ( g_mkdir_with_parents (dir, 0755) != 0 )
+        {
+                fprintf (stderr, "cannot create directory %s\n", dir);
+                return 1;
+        }
+
+        /* initialize components */
+        start = g_get_monotonic_time ();
+        gl_debug_init ();
+        gl_merge_init ();
+        lgl_db_init ();
+        gl_prefs_init_null ();
+	gl_template_history_init_null ();
+	gl_font_history_init_null ();
+
+        if ( !lgl_db_does_template_name_exist (template_name) )
+        {
+                fprintf (stderr, "unknown template \"%s\"\n", template_name);
+                return 1;
+        }
+
+        json = g_string_new ("{\n");
+        g_string_append_printf (json, "  \"rows\": %d,\n", n_rows);
+        g_string_append_printf (json, "  \"template\": \"%s\",\n", template_name);
+        g_string_append_printf (json, "  \"init_ms\": %.3f,\n",
+                                (g_get_monotonic_time () - start) / 1000.0);
+
+        /* One merge source is shared by all documents. */
+        csv_filename = g_build_filename (dir, "bench.csv", NULL);
+        start = g_get_monotonic_time ();
+        if ( !write_csv (csv_filename, n_rows) )
+        {
+                fprintf (stderr, "cannot write %s\n", csv_filename);
+                return 1;
+        }
+        g_string_append_printf (json, "  \"csv_ms\": %.3f,\n",
+                                (g_get_monotonic_time () - start) / 1000.0);
+
+        g_string_append (json, "  \"documents\": [");
+        for ( i = 0; i < G_N_ELEMENTS (docs); i++ )
+        {
+                if ( only && strcmp (only, docs[i].name) )
+                {
+                        continue;
+                }
+                run_doc (&docs[i], csv_filename, json);
+        }
+        if ( json->str[json->len - 1] == ',' )
+        {
+                g_string_truncate (json, json->len - 1);
+        }
+        g_string_append (json, "\n  ],\n");
+
+        g_string_append_printf (json, "  \"peak_rss_kb\": %ld\n}\n", gl_debug_get_max_rss_kb ());
+
+        if ( output )
+        {
+                if ( !g_file_set_contents (output, json->str, json->len, &error) )
+                {
+                        fprintf (stderr, "%s\n", error->message);
+                        g_error_free (error);
+                        return 1;
+                }
+        }
+        else
+        {
+                fputs (json->str, stdout);
+        }
+
+        g_string_free (json, TRUE);
+        g_free (csv_filename);
+
+        GL_TRACE_WRITE ();
+
+        return 0;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Generate, save, reopen, merge and render one document.  Each    */
+/* step is reported as a phase of the document's JSON object.               */
+/*---------------------------------------------------------------------------*/
+static void
+run_doc (const BenchDoc *doc,
+         const gchar    *csv_filename,
+         GString        *json)
+{
+        Phases             phases;
+        gchar             *basename, *filename;
+        glLabel           *label;
+        lglTemplate       *template;
+        const lglTemplate *label_template;
+        lglTemplateFrame  *frame;
+        glMerge           *merge;
+        glXMLLabelStatus   status;
+        gint               n_per_sheet, n_sheets;
+        gsize              n_png_bytes = 0;
+        gdouble            pdf_ms, png_ms, recording_ms;
+
+        gl_debug (DEBUG_PRINT, "START %s", doc->name);
+
+        g_string_append_printf (json, "\n    {\n      \"name\": \"%s\",\n", doc->name);
+        g_string_append (json, "      \"phases\": {");
+
+        phases.json       = json;
+        phases.first_flag = TRUE;
+
+        basename = g_strdup_printf ("%s.glabels", doc->name);
+        filename = g_build_filename (dir, basename, NULL);
+        g_free (basename);
+
+        /* Generate document.  It is saved without merge properties, so that
+         * reading the merge source is timed as a phase of its own. */
+        phase_begin (&phases);
+        template = lgl_db_lookup_template_from_name (template_name);
+        label = GL_LABEL (gl_label_new ());
+        gl_label_set_template (label, template, FALSE);
+        lgl_template_free (template);
+        doc->build (label, dir);
+        gl_xml_label_save (label, filename, &status);
+        g_object_unref (label);
+        phase_end (&phases, "generate");
+
+        if ( status != XML_LABEL_OK )
+        {
+                fprintf (stderr, "cannot save %s\n", filename);
+                g_string_append (json, "\n      }\n    },");
+                g_free (filename);
+                return;
+        }
+
+        phase_begin (&phases);
+        label = gl_xml_label_open (filename, &status);
+        phase_end (&phases, "open");
+
+        if ( status != XML_LABEL_OK )
+        {
+                fprintf (stderr, "cannot open %s\n", filename);
+                g_string_append (json, "\n      }\n    },");
+                g_free (filename);
+                return;
+        }
+
+        phase_begin (&phases);
+        merge = gl_merge_new (BENCH_MERGE_TYPE);
+        gl_merge_set_src (merge, csv_filename);
+        gl_label_set_merge (label, merge, FALSE);
+        g_object_unref (merge);
+        phase_end (&phases, "merge");
+
+        label_template = gl_label_get_template (label);
+        frame          = (lglTemplateFrame *)label_template->frames->data;
+        n_per_sheet    = lgl_template_frame_get_n_labels (frame);
+        n_sheets       = (n_rows + n_per_sheet - 1) / n_per_sheet;
+
+        g_free (filename);
+        basename = g_strdup_printf ("%s.pdf", doc->name);
+        filename = g_build_filename (dir, basename, NULL);
+        g_free (basename);
+
+        phase_begin (&phases);
+        render_pdf (label, filename, n_sheets);
+        pdf_ms = phase_end (&phases, "pdf");
+
+        phase_begin (&phases);
+        render_png (label, n_sheets, &n_png_bytes);
+        png_ms = phase_end (&phases, "png");
+
+        phase_begin (&phases);
+        render_recording (label, n_sheets);
+        recording_ms = phase_end (&phases, "recording");
+
+        g_string_append (json, "\n      },\n      \"labels_per_sec\": {");
+        g_string_append_printf (json, "\n        \"pdf\": %.1f,",
+                                n_rows * 1000.0 / MAX (pdf_ms, 0.001));
+        g_string_append_printf (json, "\n        \"png\": %.1f,",
+                                n_rows * 1000.0 / MAX (png_ms, 0.001));
+        g_string_append_printf (json, "\n        \"recording\": %.1f\n      },",
+                                n_rows * 1000.0 / MAX (recording_ms, 0.001));
+        g_string_append_printf (json, "\n      \"sheets\": %d,", n_sheets);
+        g_string_append_printf (json, "\n      \"png_bytes\": %" G_GSIZE_FORMAT ",", n_png_bytes);
+        g_string_append_printf (json, "\n      \"peak_rss_kb\": %ld\n    },", gl_debug_get_max_rss_kb ());
+
+        g_object_unref (label);
+        g_free (filename);
+
+        gl_debug (DEBUG_PRINT, "END");
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Render all merge sheets of label to PDF file through print.c.   */
+/*---------------------------------------------------------------------------*/
+static void
+render_pdf (glLabel     *label,
+            const gchar *filename,
+            gint         n_sheets)
+{
+        const lglTemplate *template;
+        cairo_surface_t   *surface;
+        cairo_t           *cr;
+        glPrintState       state;
+        gint               i;
+
+        template = gl_label_get_template (label);
+
+        surface = cairo_pdf_surface_create (filename,
+                                            template->page_width,
+                                            template->page_height);
+        cr = cairo_create (surface);
+
+        for ( i = 0; i < n_sheets; i++ )
+        {
+                /* State is initialized by print.c for sheet 0. */
+                gl_print_collated_merge_sheet (label, cr, i, 1, 1,
+                                               FALSE, FALSE, FALSE, &state);
+                cairo_show_page (cr);
+        }
+
+        cairo_destroy (cr);
+        cairo_surface_finish (surface);
+        cairo_surface_destroy (surface);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Rasterize each sheet and encode it as PNG.  Encoded data is     */
+/* only counted, so that the phase does not depend on disk speed.           */
+/*---------------------------------------------------------------------------*/
+static void
+render_png (glLabel *label,
+            gint     n_sheets,
+            gsize   *n_bytes)
+{
+        const lglTemplate *template;
+        gdouble            scale;
+        cairo_surface_t   *surface;
+        cairo_t           *cr;
+        glPrintState       state;
+        gint               i;
+
+        template = gl_label_get_template (label);
+        scale    = PNG_RESOLUTION_DPI / 72.0;
+
+        surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                              ceil (template->page_width * scale),
+                                              ceil (template->page_height * scale));
+        cr = cairo_create (surface);
+        cairo_scale (cr, scale, scale);
+
+        for ( i = 0; i < n_sheets; i++ )
+        {
+                cairo_save (cr);
+                cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
+                cairo_paint (cr);
+                cairo_restore (cr);
+
+                gl_print_collated_merge_sheet (label, cr, i, 1, 1,
+                                               FALSE, FALSE, FALSE, &state);
+
+                cairo_surface_flush (surface);
+                cairo_surface_write_to_png_stream (surface,
+                                                   (cairo_write_func_t)count_bytes,
+                                                   n_bytes);
+        }
+
+        cairo_destroy (cr);
+        cairo_surface_destroy (surface);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Record each sheet, as the print preview and view do.            */
+/*---------------------------------------------------------------------------*/
+static void
+render_recording (glLabel *label,
+                  gint     n_sheets)
+{
+        cairo_surface_t   *surface;
+        cairo_t           *cr;
+        glPrintState       state;
+        gint               i;
+
+        for ( i = 0; i < n_sheets; i++ )
+        {
+                surface = cairo_recording_surface_create (CAIRO_CONTENT_COLOR_ALPHA, NULL);
+                cr = cairo_create (surface);
+
+                gl_print_collated_merge_sheet (label, cr, i, 1, 1,
+                                               FALSE, FALSE, FALSE, &state);
+
+                cairo_destroy (cr);
+                cairo_surface_destroy (surface);
+        }
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  PNG stream writer that only counts bytes.                       */
+/*---------------------------------------------------------------------------*/
+static cairo_status_t
+count_bytes (gsize               *n_bytes,
+             const unsigned char *data,
+             unsigned int         length)
+{
+        *n_bytes += length;
+
+        return CAIRO_STATUS_SUCCESS;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Address label: several lines of merged text.                    */
+/*---------------------------------------------------------------------------*/
+static void
+build_address (glLabel     *label,
+               const gchar *dir)
+{
+        add_text (label, "${Name}\n${Company}\n${Street}\n${City}, ${State} ${Zip}",
+                  6, 4, 180, 60, 9);
+        add_text (label, "${Code}", 6, 62, 180, 10, 6);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Linear barcode of a merge field.                                */
+/*---------------------------------------------------------------------------*/
+static void
+build_barcode (glLabel     *label,
+               const gchar *dir)
+{
+        add_text (label, "${Name}", 6, 4, 180, 14, 9);
+        add_barcode (label, "built-in", "Code39", "${Code}", 6, 20, 170, 48);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  2D barcodes, from whichever backends are available.             */
+/*---------------------------------------------------------------------------*/
+static void
+build_2d (glLabel     *label,
+          const gchar *dir)
+{
+        if ( gl_barcode_backends_is_backend_id_valid ("libqrencode") )
+        {
+                add_barcode (label, "libqrencode", "IEC18004", "${Name} ${Code}", 6, 6, 60, 60);
+        }
+        else if ( gl_barcode_backends_is_backend_id_valid ("zint") )
+        {
+                add_barcode (label, "zint", "QR", "${Name} ${Code}", 6, 6, 60, 60);
+        }
+
+        if ( gl_barcode_backends_is_backend_id_valid ("libiec16022") )
+        {
+                add_barcode (label, "libiec16022", "IEC16022", "${Code}", 80, 6, 60, 60);
+        }
+        else if ( gl_barcode_backends_is_backend_id_valid ("zint") )
+        {
+                add_barcode (label, "zint", "DMTX", "${Code}", 80, 6, 60, 60);
+        }
+
+        add_text (label, "${Zip}", 150, 30, 40, 12, 8);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Embedded photographic image.                                    */
+/*---------------------------------------------------------------------------*/
+static void
+build_image (glLabel     *label,
+             const gchar *dir)
+{
+        GdkPixbuf    *pixbuf;
+        guchar       *pixels, *p;
+        gint          rowstride, x, y;
+        GRand        *rand;
+        glLabelImage *limage;
+
+        /* Smooth gradient with some noise, so that it does not compress away. */
+        pixbuf    = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8,
+                                    IMAGE_SIZE_PIXELS, IMAGE_SIZE_PIXELS);
+        pixels    = gdk_pixbuf_get_pixels (pixbuf);
+        rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+        rand      = g_rand_new_with_seed (1);
+        for ( y = 0; y < IMAGE_SIZE_PIXELS; y++ )
+        {
+                for ( x = 0; x < IMAGE_SIZE_PIXELS; x++ )
+                {
+                        p = pixels + y*rowstride + 3*x;
+                        p[0] = x ^ g_rand_int_range (rand, 0, 16);
+                        p[1] = y ^ g_rand_int_range (rand, 0, 16);
+                        p[2] = (x + y) / 2;
+                }
+        }
+        g_rand_free (rand);
+
+        limage = GL_LABEL_IMAGE (gl_label_image_new (label, FALSE));
+        gl_label_image_set_pixbuf (limage, pixbuf, FALSE);
+        gl_label_object_set_position (GL_LABEL_OBJECT (limage), 4, 4, FALSE);
+        gl_label_object_set_size (GL_LABEL_OBJECT (limage), 64, 64, FALSE);
+        g_object_unref (pixbuf);
+
+        add_text (label, "${Name}\n${City}", 72, 10, 110, 40, 9);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  External SVG image.                                             */
+/*---------------------------------------------------------------------------*/
+static void
+build_svg (glLabel     *label,
+           const gchar *dir)
+{
+        add_svg (label, dir, 4, 4, 64, 64);
+
+        add_text (label, "${Name}\n${City}", 72, 10, 110, 40, 9);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Shadowed logos: a translucent image and an SVG.                 */
+/*---------------------------------------------------------------------------*/
+static void
+build_logo (glLabel     *label,
+            const gchar *dir)
+{
+        GdkPixbuf     *pixbuf;
+        guchar        *pixels, *p;
+        gint           rowstride, x, y;
+        gdouble        r;
+        glLabelImage  *limage;
+        glLabelObject *object;
+
+        /* Disc with soft edge on transparent background. */
+        pixbuf    = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8,
+                                    IMAGE_SIZE_PIXELS, IMAGE_SIZE_PIXELS);
+        pixels    = gdk_pixbuf_get_pixels (pixbuf);
+        rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+        for ( y = 0; y < IMAGE_SIZE_PIXELS; y++ )
+        {
+                for ( x = 0; x < IMAGE_SIZE_PIXELS; x++ )
+                {
+                        r = hypot (x - IMAGE_SIZE_PIXELS/2, y - IMAGE_SIZE_PIXELS/2);
+                        p = pixels + y*rowstride + 4*x;
+                        p[0] = 0x20;
+                        p[1] = x;
+                        p[2] = y;
+                        p[3] = CLAMP ((IMAGE_SIZE_PIXELS/2 - r) * 16, 0, 255);
+                }
+        }
+
+        limage = GL_LABEL_IMAGE (gl_label_image_new (label, FALSE));
+        gl_label_image_set_pixbuf (limage, pixbuf, FALSE);
+        gl_label_object_set_position (GL_LABEL_OBJECT (limage), 4, 4, FALSE);
+        gl_label_object_set_size (GL_LABEL_OBJECT (limage), 48, 48, FALSE);
+        gl_label_object_set_shadow_state (GL_LABEL_OBJECT (limage), TRUE, FALSE);
+        g_object_unref (pixbuf);
+
+        object = add_svg (label, dir, 130, 4, 48, 48);
+        gl_label_object_set_shadow_state (object, TRUE, FALSE);
+
+        add_text (label, "${Name}", 56, 20, 70, 16, 9);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Add external SVG image, writing the SVG file if needed.         */
+/*---------------------------------------------------------------------------*/
+static glLabelObject *
+add_svg (glLabel     *label,
+         const gchar *dir,
+         gdouble      x,
+         gdouble      y,
+         gdouble      w,
+         gdouble      h)
+{
+        GString      *svg;
+        gchar        *filename;
+        glTextNode   *text_node;
+        glLabelImage *limage;
+        gint          i;
+
+        filename = g_build_filename (dir, "bench.svg", NULL);
+
+        if ( !g_file_test (filename, G_FILE_TEST_EXISTS) )
+        {
+                svg = g_string_new ("<svg xmlns=\"http://www.w3.org/2000/svg\" "
+                                    "width=\"200\" height=\"200\" viewBox=\"0 0 200 200\">\n");
+                for ( i = 0; i < 40; i++ )
+                {
+                        g_string_append_printf (svg,
+                                                "<circle cx=\"%d\" cy=\"%d\" r=\"%d\" "
+                                                "fill=\"#%02x%02x80\" fill-opacity=\"0.5\"/>\n",
+                                                (i * 37) % 200, (i * 53) % 200, 10 + i % 30,
+                                                (i * 6) & 0xff, (i * 11) & 0xff);
+                }
+                g_string_append (svg, "<text x=\"10\" y=\"190\" font-size=\"20\">gLabels</text>\n</svg>\n");
+
+                g_file_set_contents (filename, svg->str, svg->len, NULL);
+                g_string_free (svg, TRUE);
+        }
+
+        text_node = gl_text_node_new_from_text (filename);
+        limage = GL_LABEL_IMAGE (gl_label_image_new (label, FALSE));
+        gl_label_image_set_filename (limage, text_node, FALSE);
+        gl_label_object_set_position (GL_LABEL_OBJECT (limage), x, y, FALSE);
+        gl_label_object_set_size (GL_LABEL_OBJECT (limage), w, h, FALSE);
+        gl_text_node_free (&text_node);
+        g_free (filename);
+
+        return GL_LABEL_OBJECT (limage);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Shapes and text with shadows.                                   */
+/*---------------------------------------------------------------------------*/
+static void
+build_shadow (glLabel     *label,
+              const gchar *dir)
+{
+        GObject *object;
+
+        object = gl_label_box_new (label, FALSE);
+        gl_label_object_set_position (GL_LABEL_OBJECT (object), 4, 4, FALSE);
+        gl_label_object_set_size (GL_LABEL_OBJECT (object), 120, 40, FALSE);
+        gl_label_object_set_shadow_state (GL_LABEL_OBJECT (object), TRUE, FALSE);
+        gl_label_object_set_shadow_offset (GL_LABEL_OBJECT (object), 2, 2, FALSE);
+
+        object = gl_label_ellipse_new (label, FALSE);
+        gl_label_object_set_position (GL_LABEL_OBJECT (object), 130, 4, FALSE);
+        gl_label_object_set_size (GL_LABEL_OBJECT (object), 50, 40, FALSE);
+        gl_label_object_set_shadow_state (GL_LABEL_OBJECT (object), TRUE, FALSE);
+        gl_label_object_set_shadow_offset (GL_LABEL_OBJECT (object), 2, 2, FALSE);
+
+        add_text (label, "${Name}", 8, 50, 170, 16, 10);
+        object = G_OBJECT (g_list_last ((GList *)gl_label_get_object_list (label))->data);
+        gl_label_object_set_shadow_state (GL_LABEL_OBJECT (object), TRUE, FALSE);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Auto-shrink text, most names do not fit at the nominal size.    */
+/* Run with "--rows 100000 --only shrink" to measure text fitting over a     */
+/* large address file; name lines repeat, street lines are mostly unique.    */
+/*---------------------------------------------------------------------------*/
+static void
+build_shrink (glLabel     *label,
+              const gchar *dir)
+{
+        GObject *object;
+
+        add_text (label, "${Name}, ${Company}", 6, 6, 90, 20, 18);
+        object = G_OBJECT (g_list_last ((GList *)gl_label_get_object_list (label))->data);
+        gl_label_text_set_auto_shrink (GL_LABEL_TEXT (object), TRUE, FALSE);
+
+        add_text (label, "${Street}\n${City}, ${State} ${Zip}", 6, 30, 90, 30, 14);
+        object = G_OBJECT (g_list_last ((GList *)gl_label_get_object_list (label))->data);
+        gl_label_text_set_auto_shrink (GL_LABEL_TEXT (object), TRUE, FALSE);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Add text object.                                                */
+/*---------------------------------------------------------------------------*/
+static void
+add_text (glLabel     *label,
+          const gchar *text,
+          gdouble      x,
+          gdouble      y,
+          gdouble      w,
+          gdouble      h,
+          gdouble      font_size)
+{
+        glLabelText *ltext;
+
+        ltext = GL_LABEL_TEXT (gl_label_text_new (label, FALSE));
+        gl_label_text_set_text (ltext, text, FALSE);
+        gl_label_object_set_position (GL_LABEL_OBJECT (ltext), x, y, FALSE);
+        gl_label_object_set_size (GL_LABEL_OBJECT (ltext), w, h, FALSE);
+        gl_label_object_set_font_size (GL_LABEL_OBJECT (ltext), font_size, FALSE);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Add barcode object.                                             */
+/*---------------------------------------------------------------------------*/
+static void
+add_barcode (glLabel     *label,
+             const gchar *backend_id,
+             const gchar *id,
+             const gchar *data,
+             gdouble      x,
+             gdouble      y,
+             gdouble      w,
+             gdouble      h)
+{
+        glLabelBarcode      *lbc;
+        glLabelBarcodeStyle *style;
+        glTextNode          *text_node;
+
+        lbc = GL_LABEL_BARCODE (gl_label_barcode_new (label, FALSE));
+
+        style = gl_label_barcode_style_new ();
+        gl_label_barcode_style_set_backend_id (style, backend_id);
+        gl_label_barcode_style_set_style_id (style, id);
+        style->text_flag     = TRUE;
+        style->checksum_flag = TRUE;
+        gl_label_barcode_set_style (lbc, style, FALSE);
+        gl_label_barcode_style_free (style);
+
+        text_node = gl_text_node_new_from_text (data);
+        gl_label_barcode_set_data (lbc, text_node, FALSE);
+        gl_text_node_free (&text_node);
+
+        gl_label_object_set_position (GL_LABEL_OBJECT (lbc), x, y, FALSE);
+        gl_label_object_set_size (GL_LABEL_OBJECT (lbc), w, h, FALSE);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Write synthetic CSV merge source with keys on line 1.           */
+/*---------------------------------------------------------------------------*/
+static gboolean
+write_csv (const gchar *filename,
+           gint         n)
+{
+        FILE  *fp;
+        GRand *rand;
+        gint   i;
+
+        fp = g_fopen (filename, "w");
+        if ( !fp )
+        {
+                return FALSE;
+        }
+
+        rand = g_rand_new_with_seed (42);
+
+        fprintf (fp, "Name,Company,Street,City,State,Zip,Code\n");
+        for ( i = 0; i < n; i++ )
+        {
+                fprintf (fp, "%s %s,\"%s, %s & Sons\",%d %s,%s,%c%c,%05d,%08d\n",
+                         first_names[g_rand_int_range (rand, 0, G_N_ELEMENTS (first_names))],
+                         last_names[g_rand_int_range (rand, 0, G_N_ELEMENTS (last_names))],
+                         last_names[g_rand_int_range (rand, 0, G_N_ELEMENTS (last_names))],
+                         last_names[g_rand_int_range (rand, 0, G_N_ELEMENTS (last_names))],
+                         g_rand_int_range (rand, 1, 20000),
+                         streets[g_rand_int_range (rand, 0, G_N_ELEMENTS (streets))],
+                         cities[g_rand_int_range (rand, 0, G_N_ELEMENTS (cities))],
+                         'A' + g_rand_int_range (rand, 0, 26),
+                         'A' + g_rand_int_range (rand, 0, 26),
+                         g_rand_int_range (rand, 0, 100000),
+                         i);
+        }
+
+        g_rand_free (rand);
+
+        return (fclose (fp) == 0);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Phase timing.                                                   */
+/*---------------------------------------------------------------------------*/
+static void
+phase_begin (Phases *phases)
+{
+        phases->start = g_get_monotonic_time ();
+}
+
+
+static gdouble
+phase_end (Phases      *phases,
+           const gchar *name)
+{
+        gdouble ms;
+
+        ms = (g_get_monotonic_time () - phases->start) / 1000.0;
+
+        g_string_append_printf (phases->json, "%s\n        \"%s_ms\": %.3f",
+                                phases->first_flag ? "" : ",", name, ms);
+        phases->first_flag = FALSE;
+
+        return ms;
+}
+
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
@@ -20,7 +20,9 @@
 
 #include <config.h>
 
+#include <string.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 
 #include <libglabels.h>
 #include "warning-handler.h"
@@ -40,16 +42,50 @@
 /* Private macros and constants.                          */
 /*========================================================*/
 
+/* If set, startup timeline is written to this file. */
+#define STARTUP_TIMELINE_ENV    "GLABELS_STARTUP_TIMELINE"
+
+/* Time to first window drawn, that the timeline is checked against. */
+#define FIRST_WINDOW_TARGET_MS  500
+
+
+/*========================================================*/
+/* Private types                                          */
+/*========================================================*/
+
+typedef struct {
+        const gchar *name;
+        gint64       start;      /* Microseconds since process start. */
+        gint64       duration;   /* Microseconds. */
+        glong        rss_kb;     /* Growth of peak resident set size. */
+} TimelineEntry;
+
 
 /*========================================================*/
 /* Private globals                                        */
 /*========================================================*/
 
+static GArray *timeline    = NULL;
+static gint64  timeline_t0 = 0;
+
 
 /*========================================================*/
 /* Local function prototypes                              */
 /*========================================================*/
 
+static void     timeline_run      (const gchar *name,
+                                   void       (*init_func) (void));
+
+static void     timeline_mark     (const gchar *name);
+
+static gboolean first_draw_cb     (GtkWidget   *widget,
+                                   cairo_t     *cr,
+                                   gpointer     user_data);
+
+static gboolean deferred_init_cb  (gpointer     user_data);
+
+static void     timeline_write    (void);
+
 
 /****************************************************************************/
 /* main program                                                             */
@@ -70,6 +106,9 @@ main (int argc, char **argv)
 	gchar	       *utf8_filename;
         GError         *error = NULL;
 
+        timeline_t0 = g_get_monotonic_time ();
+        timeline = g_array_new (FALSE, FALSE, sizeof (TimelineEntry));
+
 	bindtextdomain (GETTEXT_PACKAGE, GLABELS_LOCALE_DIR);
 	bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
 	textdomain (GETTEXT_PACKAGE);
@@ -81,7 +120,9 @@ main (int argc, char **argv)
 
 
 	/* Initialize program */
+        timeline_mark ("main");
         gtk_init( &argc, &argv );
+        timeline_mark ("gtk_init");
         if (!g_option_context_parse (option_context, &argc, &argv, &error))
 	{
 	        g_print(_("%s\nRun '%s --help' to see a full list of available command line options.\n"),
@@ -102,15 +143,15 @@ main (int argc, char **argv)
 	/* Set default icon */
         gtk_window_set_default_icon_name (GLABELS_ICON_NAME);
 	
-	/* Initialize subsystems */
+	/* Initialize subsystems.  The template database is loaded on demand, or */
+	/* once the first window has been drawn (see deferred_init_cb()).         */
 	gl_debug_init ();
-	lgl_db_init ();
-	gl_prefs_init ();
-	gl_mini_preview_pixbuf_cache_init ();
-	gl_merge_init ();
-	gl_recent_init ();
-        gl_template_history_init ();
-        gl_font_history_init ();
+	timeline_run ("gl_prefs_init", gl_prefs_init);
+	timeline_run ("gl_mini_preview_pixbuf_cache_init", gl_mini_preview_pixbuf_cache_init);
+	timeline_run ("gl_merge_init", gl_merge_init);
+	timeline_run ("gl_recent_init", gl_recent_init);
+        timeline_run ("gl_template_history_init", gl_template_history_init);
+        timeline_run ("gl_font_history_init", gl_font_history_init);
 	
 
 	/* Parse args and build the list of files to be loaded at startup */
@@ -139,15 +180,140 @@ main (int argc, char **argv)
 		gtk_widget_show_all (win);
 	}
 	g_list_free (file_list);
+        timeline_mark ("windows created");
+
+        g_signal_connect_after (G_OBJECT (gl_window_get_window_list ()->data), "draw",
+                                G_CALLBACK (first_draw_cb), NULL);
 
 	
 	/* Begin main loop */
 	gtk_main();
 
+        GL_TRACE_WRITE ();
+
 	return 0;
 }
 
 
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Run subsystem initialization, recording it in the timeline.     */
+/*---------------------------------------------------------------------------*/
+static void
+timeline_run (const gchar  *name,
+              void        (*init_func) (void))
+{
+        TimelineEntry entry;
+        glong         rss_kb;
+
+        rss_kb = gl_debug_get_max_rss_kb ();
+
+        entry.name  = name;
+        entry.start = g_get_monotonic_time () - timeline_t0;
+
+        init_func ();
+
+        entry.duration = g_get_monotonic_time () - timeline_t0 - entry.start;
+        entry.rss_kb   = gl_debug_get_max_rss_kb () - rss_kb;
+
+        g_array_append_val (timeline, entry);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Record point in time in the timeline.                           */
+/*---------------------------------------------------------------------------*/
+static void
+timeline_mark (const gchar *name)
+{
+        TimelineEntry entry;
+
+        entry.name     = name;
+        entry.start    = g_get_monotonic_time () - timeline_t0;
+        entry.duration = 0;
+        entry.rss_kb   = 0;
+
+        g_array_append_val (timeline, entry);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  First window drawn, schedule deferred initialization.           */
+/*---------------------------------------------------------------------------*/
+static gboolean
+first_draw_cb (GtkWidget *widget,
+               cairo_t   *cr,
+               gpointer   user_data)
+{
+        timeline_mark ("first window drawn");
+
+        g_signal_handlers_disconnect_by_func (G_OBJECT (widget), first_draw_cb, user_data);
+
+        g_idle_add_full (G_PRIORITY_LOW, deferred_init_cb, NULL, NULL);
+
+        return FALSE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Deferred initialization, once the first window is up.  Loading  */
+/* the template database is only needed by the media selector and when      */
+/* opening files, which also load it on demand.                              */
+/*---------------------------------------------------------------------------*/
+static gboolean
+deferred_init_cb (gpointer user_data)
+{
+        timeline_run ("lgl_db_init (deferred)", lgl_db_init);
+
+        timeline_write ();
+
+        return FALSE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Write timeline, if requested by environment variable.           */
+/*---------------------------------------------------------------------------*/
+static void
+timeline_write (void)
+{
+        const gchar   *filename;
+        FILE          *fp;
+        TimelineEntry *entry;
+        gint64         first_window = -1;
+        guint          i;
+
+        filename = g_getenv (STARTUP_TIMELINE_ENV);
+        if ( filename && (fp = g_fopen (filename, "w")) )
+        {
+                fprintf (fp, "# %-38s %10s %10s %8s\n", "step", "start_ms", "time_ms", "rss_kb");
+                for ( i = 0; i < timeline->len; i++ )
+                {
+                        entry = &g_array_index (timeline, TimelineEntry, i);
+
+                        fprintf (fp, "%-40s %10.1f %10.1f %8ld\n",
+                                 entry->name,
+                                 entry->start / 1000.0,
+                                 entry->duration / 1000.0,
+                                 entry->rss_kb);
+
+                        if ( strcmp (entry->name, "first window drawn") == 0 )
+                        {
+                                first_window = entry->start;
+                        }
+                }
+
+                fprintf (fp, "# first window drawn after %.1f ms, target %d ms: %s\n",
+                         first_window / 1000.0, FIRST_WINDOW_TARGET_MS,
+                         (first_window <= FIRST_WINDOW_TARGET_MS * 1000) ? "OK" : "EXCEEDED");
+
+                fclose (fp);
+        }
+
+        g_array_free (timeline, TRUE);
+        timeline = NULL;
+}
+
+
 
 /*
  * Local Variables:       -- emacs
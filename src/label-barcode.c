@@ -492,8 +492,6 @@ draw_object (glLabelObject *object,
              glMergeRecord *record)
 {
         glLabelBarcode       *lbc     = (glLabelBarcode *)object;
-        gdouble               x0, y0;
-        cairo_matrix_t        matrix;
         lglBarcode           *gbc;
         gchar                *text;
         glTextNode           *text_node;
@@ -504,11 +502,9 @@ draw_object (glLabelObject *object,
 
         gl_debug (DEBUG_LABEL, "START");
 
-        gl_label_object_get_position (object, &x0, &y0);
-        gl_label_object_get_matrix (object, &matrix);
-
-        text_node = gl_label_barcode_get_data (GL_LABEL_BARCODE (object));
-        style = gl_label_barcode_get_style (GL_LABEL_BARCODE (object));
+        /* Used read-only, no need to copy. */
+        text_node = lbc->priv->text_node;
+        style     = lbc->priv->style;
 
         color_node = gl_label_object_get_line_color (object);
         color = gl_color_node_expand (color_node, record);
@@ -549,8 +545,6 @@ draw_object (glLabelObject *object,
 
         }
 
-        gl_text_node_free (&text_node);
-        gl_label_barcode_style_free (style);
         gl_color_node_free (&color_node);
 
         gl_debug (DEBUG_LABEL, "END");
@@ -36,6 +36,8 @@
 
 #define MIN_IMAGE_SIZE 1.0
 
+#define SVG_MASK_KEY   "gl-svg-mask"
+
 
 /*========================================================*/
 /* Private types.                                         */
@@ -63,7 +65,8 @@ struct _glLabelImagePrivate {
 /* Private globals.                                       */
 /*========================================================*/
 
-static GdkPixbuf *default_pixbuf = NULL;
+static GdkPixbuf       *default_pixbuf  = NULL;
+static cairo_surface_t *default_surface = NULL;
 
 
 /*========================================================*/
@@ -95,6 +98,10 @@ static gboolean object_at                (glLabelObject     *object,
                                           gdouble            x_pixels,
                                           gdouble            y_pixels);
 
+static cairo_surface_t *get_surface      (glLabelImage      *this);
+
+static cairo_surface_t *get_svg_mask     (RsvgHandle        *svg_handle);
+
 
 /*****************************************************************************/
 /* Boilerplate object stuff.                                                 */
@@ -124,6 +131,8 @@ gl_label_image_class_init (glLabelImageClass *class)
                 default_pixbuf =
                         gdk_pixbuf_scale_simple (pixbuf, 128, 128, GDK_INTERP_NEAREST);
                 g_object_unref (pixbuf);
+
+                default_surface = gdk_cairo_surface_create_from_pixbuf (default_pixbuf, 1, NULL);
         }
 }
 
@@ -218,6 +227,8 @@ copy (glLabelObject *dst_object,
         glLabelImage     *new_limage = (glLabelImage *)dst_object;
         glTextNode       *filename;
         GdkPixbuf        *pixbuf;
+        GBytes           *data;
+        const gchar      *format;
         gchar            *contents;
         glLabel          *src_label, *dst_label;
         GHashTable       *cache;
@@ -243,6 +254,13 @@ copy (glLabelObject *dst_object,
                         if ( pixbuf != NULL ) {
                                 cache = gl_label_get_pixbuf_cache (dst_label);
                                 gl_pixbuf_cache_add_pixbuf (cache, filename->data, pixbuf);
+
+                                /* Carry encoded data along, so saving does not re-encode. */
+                                data = gl_pixbuf_cache_get_data (gl_label_get_pixbuf_cache (src_label),
+                                                                 filename->data, &format);
+                                if ( data != NULL ) {
+                                        gl_pixbuf_cache_add_data (cache, filename->data, data, format);
+                                }
                         }
                         break;
 
@@ -686,6 +704,7 @@ draw_object (glLabelObject *object,
         glLabelImage      *this = GL_LABEL_IMAGE (object);
         gdouble            w, h;
         gdouble            image_w, image_h;
+        cairo_surface_t   *surface;
         GdkPixbuf         *pixbuf;
         RsvgHandle        *svg_handle;
         RsvgDimensionData  svg_dim;
@@ -700,6 +719,19 @@ draw_object (glLabelObject *object,
         {
 
         case FILE_TYPE_PIXBUF:
+                surface = get_surface (this);
+                if ( surface )
+                {
+                        image_w = cairo_image_surface_get_width (surface);
+                        image_h = cairo_image_surface_get_height (surface);
+                        cairo_rectangle (cr, 0.0, 0.0, w, h);
+                        cairo_scale (cr, w/image_w, h/image_h);
+                        cairo_set_source_surface (cr, surface, 0, 0);
+                        cairo_fill (cr);
+                        break;
+                }
+
+                /* Merged image, loaded for this record only. */
                 pixbuf = gl_label_image_get_pixbuf (this, record);
                 if ( pixbuf )
                 {
@@ -725,10 +757,10 @@ draw_object (glLabelObject *object,
 
         default:
                 cairo_rectangle (cr, 0.0, 0.0, w, h);
-                image_w = gdk_pixbuf_get_width (default_pixbuf);
-                image_h = gdk_pixbuf_get_height (default_pixbuf);
+                image_w = cairo_image_surface_get_width (default_surface);
+                image_h = cairo_image_surface_get_height (default_surface);
                 cairo_scale (cr, w/image_w, h/image_h);
-                gdk_cairo_set_source_pixbuf (cr, default_pixbuf, 0, 0);
+                cairo_set_source_surface (cr, default_surface, 0, 0);
                 cairo_fill (cr);
                 break;
 
@@ -749,14 +781,16 @@ draw_shadow (glLabelObject *object,
              gboolean       screen_flag,
              glMergeRecord *record)
 {
-        glLabelImage    *this = GL_LABEL_IMAGE (object);
-        gdouble          w, h;
-        GdkPixbuf       *pixbuf;
-        GdkPixbuf       *shadow_pixbuf;
-        gdouble          image_w, image_h;
-        glColorNode     *shadow_color_node;
-        guint            shadow_color;
-        gdouble          shadow_opacity;
+        glLabelImage      *this = GL_LABEL_IMAGE (object);
+        gdouble            w, h;
+        GdkPixbuf         *pixbuf;
+        cairo_surface_t   *mask;
+        RsvgHandle        *svg_handle;
+        RsvgDimensionData  svg_dim;
+        gdouble            image_w, image_h;
+        glColorNode       *shadow_color_node;
+        guint              shadow_color;
+        gdouble            shadow_opacity;
 
         gl_debug (DEBUG_LABEL, "START");
 
@@ -769,9 +803,13 @@ draw_shadow (glLabelObject *object,
                 shadow_color = GL_COLOR_SHADOW_MERGE_DEFAULT;
         }
         shadow_opacity = gl_label_object_get_shadow_opacity (object);
+        shadow_color = gl_color_set_opacity (shadow_color, shadow_opacity);
 
         cairo_save (cr);
 
+        cairo_set_source_rgba (cr, GL_COLOR_RGBA_ARGS (shadow_color));
+
+        /* Shadow color is masked through image's (cached) alpha. */
         switch (get_type (this, record))
         {
 
@@ -779,30 +817,38 @@ draw_shadow (glLabelObject *object,
                 pixbuf = gl_label_image_get_pixbuf (this, record);
                 if ( pixbuf )
                 {
-                        image_w = gdk_pixbuf_get_width (pixbuf);
-                        image_h = gdk_pixbuf_get_height (pixbuf);
-
-                        shadow_pixbuf = gl_pixbuf_util_create_shadow_pixbuf (pixbuf,
-                                                                             shadow_color, shadow_opacity);
-                        cairo_rectangle (cr, 0.0, 0.0, w, h);
-                        cairo_scale (cr, w/image_w, h/image_h);
-                        gdk_cairo_set_source_pixbuf (cr, (GdkPixbuf *)shadow_pixbuf, 0, 0);
-                        cairo_fill (cr);
+                        mask = gl_pixbuf_util_get_alpha_mask (pixbuf);
+                        if ( mask )
+                        {
+                                image_w = gdk_pixbuf_get_width (pixbuf);
+                                image_h = gdk_pixbuf_get_height (pixbuf);
+                                cairo_scale (cr, w/image_w, h/image_h);
+                                cairo_mask_surface (cr, mask, 0, 0);
+                        }
+                        else
+                        {
+                                cairo_rectangle (cr, 0.0, 0.0, w, h);
+                                cairo_fill (cr);
+                        }
 
-                        g_object_unref (G_OBJECT (shadow_pixbuf));
                         g_object_unref (G_OBJECT (pixbuf));
                 }
                 break;
 
         case FILE_TYPE_SVG:
-                /* FIXME: no shadow support, yet. */
+                svg_handle = gl_label_image_get_svg_handle (this, record);
+                if ( svg_handle )
+                {
+                        rsvg_handle_get_dimensions (svg_handle, &svg_dim);
+                        cairo_scale (cr, w/svg_dim.width, h/svg_dim.height);
+                        cairo_mask_surface (cr, get_svg_mask (svg_handle), 0, 0);
+
+                        g_object_unref (G_OBJECT (svg_handle));
+                }
                 break;
 
         default:
-                shadow_color = gl_color_set_opacity (shadow_color, shadow_opacity);
-
                 cairo_rectangle (cr, 0.0, 0.0, w, h);
-                cairo_set_source_rgba (cr, GL_COLOR_RGBA_ARGS (shadow_color));
                 cairo_fill (cr);
                 break;
         }
@@ -813,6 +859,69 @@ draw_shadow (glLabelObject *object,
 }
 
 
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Get surface of image from label's pixbuf cache, or NULL if      */
+/* image is merged from a different file for each record.                    */
+/*---------------------------------------------------------------------------*/
+static cairo_surface_t *
+get_surface (glLabelImage  *this)
+{
+        glLabel *label;
+
+        if ( this->priv->filename->field_flag || (this->priv->type != FILE_TYPE_PIXBUF) )
+        {
+                return NULL;
+        }
+
+        label = gl_label_object_get_parent (GL_LABEL_OBJECT (this));
+        if ( label == NULL )
+        {
+                return NULL;
+        }
+
+        return gl_pixbuf_cache_get_surface (gl_label_get_pixbuf_cache (label),
+                                            this->priv->filename->data);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Get recording of SVG image, to mask shadow color through.  It   */
+/* is recorded once and is owned by the (cached) handle.                     */
+/*---------------------------------------------------------------------------*/
+static cairo_surface_t *
+get_svg_mask (RsvgHandle *svg_handle)
+{
+        cairo_surface_t   *mask;
+        RsvgDimensionData  svg_dim;
+        cairo_rectangle_t  extents;
+        cairo_t           *cr;
+
+        mask = g_object_get_data (G_OBJECT (svg_handle), SVG_MASK_KEY);
+        if ( mask == NULL )
+        {
+                rsvg_handle_get_dimensions (svg_handle, &svg_dim);
+                extents.x      = 0;
+                extents.y      = 0;
+                extents.width  = svg_dim.width;
+                extents.height = svg_dim.height;
+
+                mask = cairo_recording_surface_create (CAIRO_CONTENT_ALPHA, &extents);
+                cr = cairo_create (mask);
+                rsvg_handle_render_cairo (svg_handle, cr);
+                cairo_destroy (cr);
+
+                /*
+                 * Handles are not shared between threads: every label copy
+                 * (gl_label_dup) parses its own, so each worker has its own.
+                 */
+                g_object_set_data_full (G_OBJECT (svg_handle), SVG_MASK_KEY,
+                                        mask, (GDestroyNotify)cairo_surface_destroy);
+        }
+
+        return mask;
+}
+
+
 /*****************************************************************************/
 /* Is object at coordinates?                                                 */
 /*****************************************************************************/
@@ -69,6 +69,10 @@ struct _glLabelObjectPrivate {
 	gdouble            shadow_y;
 	glColorNode       *shadow_color_node;
 	gdouble            shadow_opacity;
+
+        /* Unmodified copy of this object, shared by undo states.  Dropped
+         * whenever the object changes. */
+        glLabelObject     *snapshot;
 };
 
 enum {
@@ -98,6 +102,9 @@ static void     set_size                  (glLabelObject      *object,
 					   gdouble             h,
                                            gboolean            checkpoint);
 
+static void     invalidate_snapshot       (glLabelObject      *object);
+static void     emit_moved                (glLabelObject      *object);
+
 
 /*****************************************************************************/
 /* Boilerplate object stuff.                                                 */
@@ -175,6 +182,8 @@ gl_label_object_finalize (GObject *object)
 
 	g_return_if_fail (object && GL_IS_LABEL_OBJECT (object));
 
+        invalidate_snapshot (label_object);
+
 	g_free (label_object->priv->name);
 	g_free (label_object->priv);
 
@@ -258,6 +267,61 @@ gl_label_object_dup (glLabelObject *src_object,
 }
 
 
+/*****************************************************************************/
+/* Get snapshot of object.                                                   */
+/*                                                                           */
+/* Returns a new reference to an immutable copy of the object in its current */
+/* state.  The copy is only made once and is shared until the object is      */
+/* modified, so repeated checkpoints of an unchanged object are free.        */
+/*****************************************************************************/
+glLabelObject *
+gl_label_object_get_snapshot (glLabelObject *object)
+{
+	gl_debug (DEBUG_LABEL, "START");
+
+	g_return_val_if_fail (object && GL_IS_LABEL_OBJECT (object), NULL);
+
+        if ( object->priv->snapshot == NULL )
+        {
+                object->priv->snapshot = gl_label_object_dup (object, object->priv->parent);
+        }
+
+	gl_debug (DEBUG_LABEL, "END");
+
+        return g_object_ref (object->priv->snapshot);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Emit "moved", or leave it to the end of parent's batch.         */
+/*---------------------------------------------------------------------------*/
+static void
+emit_moved (glLabelObject *object)
+{
+        if ( object->priv->parent &&
+             gl_label_defer_object_notify (object->priv->parent, object, TRUE) )
+        {
+                return;
+        }
+
+        g_signal_emit (G_OBJECT(object), signals[MOVED], 0);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Drop snapshot, because object is about to change or has changed.*/
+/*---------------------------------------------------------------------------*/
+static void
+invalidate_snapshot (glLabelObject *object)
+{
+        if ( object->priv->snapshot )
+        {
+                g_object_unref (object->priv->snapshot);
+                object->priv->snapshot = NULL;
+        }
+}
+
+
 /*****************************************************************************/
 /* Emit "changed" signal (for derived objects).                              */
 /*****************************************************************************/
@@ -268,6 +332,15 @@ gl_label_object_emit_changed (glLabelObject *object)
 
         g_return_if_fail (object && GL_IS_LABEL_OBJECT (object));
 
+        invalidate_snapshot (object);
+
+        if ( object->priv->parent &&
+             gl_label_defer_object_notify (object->priv->parent, object, FALSE) )
+        {
+                gl_debug (DEBUG_LABEL, "END");
+                return;
+        }
+
         g_signal_emit (G_OBJECT(object), signals[CHANGED], 0);
 
         gl_debug (DEBUG_LABEL, "END");
@@ -395,7 +468,8 @@ gl_label_object_set_position (glLabelObject *object,
 		object->priv->x = x;
 		object->priv->y = y;
 
-                g_signal_emit (G_OBJECT(object), signals[MOVED], 0);
+                invalidate_snapshot (object);
+                emit_moved (object);
 
 	}
 
@@ -430,7 +504,8 @@ gl_label_object_set_position_relative (glLabelObject *object,
 			  object->priv->x,
 			  object->priv->y);
 
-                g_signal_emit (G_OBJECT(object), signals[MOVED], 0);
+                invalidate_snapshot (object);
+                emit_moved (object);
 	}
 
 	gl_debug (DEBUG_LABEL, "END");
@@ -1429,6 +1504,7 @@ gl_label_object_flip_horiz (glLabelObject *object)
 
         cairo_matrix_init_scale (&flip_matrix, -1.0, 1.0);
         cairo_matrix_multiply (&object->priv->matrix, &object->priv->matrix, &flip_matrix);
+        invalidate_snapshot (object);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -1448,6 +1524,7 @@ gl_label_object_flip_vert (glLabelObject *object)
 
         cairo_matrix_init_scale (&flip_matrix, 1.0, -1.0);
         cairo_matrix_multiply (&object->priv->matrix, &object->priv->matrix, &flip_matrix);
+        invalidate_snapshot (object);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -1468,6 +1545,7 @@ gl_label_object_rotate (glLabelObject *object,
 
         cairo_matrix_init_rotate (&rotate_matrix, theta_degs*(G_PI/180.));
         cairo_matrix_multiply (&object->priv->matrix, &object->priv->matrix, &rotate_matrix);
+        invalidate_snapshot (object);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -1485,6 +1563,8 @@ gl_label_object_set_matrix (glLabelObject  *object,
 	g_return_if_fail (object && GL_IS_LABEL_OBJECT (object));
 
         object->priv->matrix = *matrix;
+
+        gl_label_object_emit_changed (object);
 }
 
 
@@ -1554,10 +1634,13 @@ gl_label_object_draw (glLabelObject *object,
                 cairo_save (cr);
                 cairo_transform (cr, &matrix);
 
+                /* Timed per object class, e.g. "glLabelText". */
+                GL_TRACE_BEGIN (G_OBJECT_TYPE_NAME (object));
                 GL_LABEL_OBJECT_GET_CLASS(object)->draw_object (object,
                                                                 cr,
                                                                 screen_flag,
                                                                 record);
+                GL_TRACE_END (G_OBJECT_TYPE_NAME (object));
 
                 cairo_restore (cr);
         }
@@ -222,6 +222,8 @@ GObject       *gl_label_object_new                   (glLabel           *label);
 glLabelObject *gl_label_object_dup                   (glLabelObject     *src_object,
                                                       glLabel           *label);
 
+glLabelObject *gl_label_object_get_snapshot          (glLabelObject     *object);
+
 
 void           gl_label_object_emit_changed          (glLabelObject     *object);
 
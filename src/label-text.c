@@ -45,6 +45,12 @@
 
 #define SELECTION_SLOP_PIXELS 4.0
 
+/* Auto shrink fit results kept per thread before the cache is flushed. */
+#define FIT_CACHE_MAX 4096
+
+/* Half point steps down from the linear estimate before bisecting. */
+#define FIT_SEARCH_MAX 4
+
 
 /*========================================================*/
 /* Private types.                                         */
@@ -69,14 +75,30 @@ struct _glLabelTextPrivate {
         gdouble          w;
         gdouble          h;
 
+        /* Compiled text, NULL when buffer has changed, and reusable buffer
+         * to expand it into. */
+        glTextTemplate  *text_template;
+        GString         *expand_buffer;
+
         gboolean         checkpoint_flag;
 };
 
 
+/* Auto shrink fit results of one thread. */
+typedef struct {
+        GHashTable      *fits;
+        GString         *key;           /* Reused to build lookup keys. */
+} FitCache;
+
+
 /*========================================================*/
 /* Private globals.                                       */
 /*========================================================*/
 
+static void     fit_cache_free (FitCache *fit_cache);
+
+static GPrivate fit_cache_key = G_PRIVATE_INIT ((GDestroyNotify)fit_cache_free);
+
 
 /*========================================================*/
 /* Private function prototypes.                           */
@@ -167,16 +189,29 @@ static void            draw_text_real              (glLabelObject    *object,
                                                     glMergeRecord    *record,
                                                     guint             color);
 
-static gdouble         auto_shrink_font_size       (cairo_t          *cr,
-                                                    gchar            *family,
+static gdouble         auto_shrink_font_size       (glLabelText      *this,
+                                                    PangoLayout      *layout,
+                                                    PangoFontDescription *desc,
+                                                    gdouble           scale,
+                                                    const gchar      *text,
                                                     gdouble           size,
-                                                    PangoWeight       weight,
-                                                    PangoStyle        style,
-                                                    gdouble           line_spacing,
-                                                    gchar            *text,
                                                     gdouble           width,
                                                     gdouble           height);
 
+static void            set_layout_font_size        (PangoLayout      *layout,
+                                                    PangoFontDescription *desc,
+                                                    gdouble           size,
+                                                    gdouble           line_spacing,
+                                                    gdouble           scale);
+
+static gboolean        layout_fits                 (PangoLayout      *layout,
+                                                    PangoFontDescription *desc,
+                                                    gdouble           size,
+                                                    gdouble           line_spacing,
+                                                    gdouble           scale,
+                                                    gdouble           max_width,
+                                                    gdouble           max_height);
+
 static gboolean        object_at                   (glLabelObject    *object,
                                                     cairo_t          *cr,
                                                     gdouble           x_pixels,
@@ -245,6 +280,8 @@ gl_label_text_init (glLabelText *ltext)
 
         ltext->priv->size_changed      = TRUE;
 
+        ltext->priv->expand_buffer     = g_string_new (NULL);
+
         ltext->priv->checkpoint_flag   = TRUE;
 
 	g_signal_connect (G_OBJECT(ltext->priv->buffer), "begin-user-action",
@@ -268,6 +305,8 @@ gl_label_text_finalize (GObject *object)
 	g_object_unref (ltext->priv->buffer);
 	g_free (ltext->priv->font_family);
 	gl_color_node_free (&(ltext->priv->color_node));
+        gl_text_template_free (&ltext->priv->text_template);
+        g_string_free (ltext->priv->expand_buffer, TRUE);
 	g_free (ltext->priv);
 
 	G_OBJECT_CLASS (gl_label_text_parent_class)->finalize (object);
@@ -477,6 +516,7 @@ buffer_changed_cb (GtkTextBuffer *textbuffer,
                    glLabelText   *ltext)
 {
         ltext->priv->size_changed = TRUE;
+        gl_text_template_free (&ltext->priv->text_template);
 
 	gl_label_object_emit_changed (GL_LABEL_OBJECT(ltext));
 }
@@ -491,11 +531,7 @@ get_size (glLabelObject *object,
 	  gdouble       *h)
 {
 	glLabelText          *ltext = (glLabelText *)object;
-	PangoFontMap         *fontmap;
-	PangoContext         *context;
-	cairo_font_options_t *options;
         PangoStyle            style;
-        PangoLayout          *layout;
         PangoFontDescription *desc;
         gdouble               font_size;
         gdouble               line_spacing;
@@ -530,17 +566,6 @@ get_size (glLabelObject *object,
 	text = gtk_text_buffer_get_text (ltext->priv->buffer,
 					 &start, &end, FALSE);
 
-	
-	fontmap = pango_cairo_font_map_new ();
-	context = pango_font_map_create_context (PANGO_FONT_MAP (fontmap));
-	options = cairo_font_options_create ();
-        cairo_font_options_set_hint_style (options, CAIRO_HINT_STYLE_NONE);
-        cairo_font_options_set_hint_metrics (options, CAIRO_HINT_METRICS_OFF);
-	pango_cairo_context_set_font_options (context, options);
-	cairo_font_options_destroy (options);
-
-	layout = pango_layout_new (context);
-
         style = GL_LABEL_TEXT (object)->priv->font_italic_flag ? PANGO_STYLE_ITALIC : PANGO_STYLE_NORMAL;
 
 	desc = pango_font_description_new ();
@@ -548,19 +573,16 @@ get_size (glLabelObject *object,
 	pango_font_description_set_weight (desc, GL_LABEL_TEXT (object)->priv->font_weight);
 	pango_font_description_set_style  (desc, style);
 	pango_font_description_set_size   (desc, font_size * PANGO_SCALE);
-	pango_layout_set_font_description (layout, desc);
+
+        /* Shared measurement context, results are cached by font and text. */
+        gl_font_util_measure_text (desc, font_size * (line_spacing-1) * PANGO_SCALE, text, &iw, &ih);
+
 	pango_font_description_free       (desc);
 
-        pango_layout_set_spacing (layout, font_size * (line_spacing-1) * PANGO_SCALE);
-	pango_layout_set_text (layout, text, -1);
-	pango_layout_get_size (layout, &iw, &ih);
 	*w = ltext->priv->w = iw / PANGO_SCALE + 2*GL_LABEL_TEXT_MARGIN;
 	*h = ltext->priv->h = ih / PANGO_SCALE;
         ltext->priv->size_changed = FALSE;
 
-	g_object_unref (layout);
-	g_object_unref (context);
-	g_object_unref (fontmap);
 	g_free (text);
 
 	gl_debug (DEBUG_LABEL, "END");
@@ -1020,53 +1042,75 @@ gl_label_text_get_auto_shrink (glLabelText      *ltext)
 
 
 /*****************************************************************************/
-/* Automatically shrink text size to fit within bounding box.                */
+/* Automatically shrink text size to fit within bounding box.  Measures      */
+/* with the layout that will render the text (unwrapped, family, weight and  */
+/* style already set), and leaves it at the returned size.  Results are      */
+/* memoized per thread by text, font and box, since merge data repeats.      */
 /*****************************************************************************/
 static gdouble
-auto_shrink_font_size (cairo_t     *cr,
-                       gchar       *family,
-                       gdouble      size,
-                       PangoWeight  weight,
-                       PangoStyle   style,
-                       gdouble      line_spacing,
-                       gchar       *text,
-                       gdouble      width,
-                       gdouble      height)
+auto_shrink_font_size (glLabelText          *this,
+                       PangoLayout          *layout,
+                       PangoFontDescription *desc,
+                       gdouble               scale,
+                       const gchar          *text,
+                       gdouble               size,
+                       gdouble               width,
+                       gdouble               height)
 {
-        PangoLayout          *layout;
-        PangoFontDescription *desc;
+        FitCache             *fit_cache;
+        gdouble              *fit_size;
+        gdouble               line_spacing;
         gint                  iw, ih;
         gdouble               layout_width, layout_height;
         gdouble               new_wsize, new_hsize;
+        gdouble               max_width, max_height;
+        gint                  lo, hi, mid;
+        gint                  i;
 
-        layout = pango_cairo_create_layout (cr);
-
-        desc = pango_font_description_new ();
-        pango_font_description_set_family (desc, family);
-        pango_font_description_set_weight (desc, weight);
-        pango_font_description_set_style  (desc, style);
-        pango_font_description_set_size   (desc, size * PANGO_SCALE);
+        line_spacing = this->priv->line_spacing;
 
-        pango_layout_set_font_description (layout, desc);
-        pango_font_description_free       (desc);
+        fit_cache = g_private_get (&fit_cache_key);
+        if ( fit_cache == NULL )
+        {
+                fit_cache = g_new0 (FitCache, 1);
+                fit_cache->fits = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+                fit_cache->key  = g_string_sized_new (256);
+                g_private_set (&fit_cache_key, fit_cache);
+        }
 
-        pango_layout_set_spacing (layout, size * (line_spacing-1) * PANGO_SCALE);
-        pango_layout_set_width (layout, -1);
-        pango_layout_set_text (layout, text, -1);
-        pango_layout_get_size (layout, &iw, &ih);
-        layout_width = (gdouble)iw / (gdouble)PANGO_SCALE;
-        layout_height = (gdouble)ih / (gdouble)PANGO_SCALE;
+        /* Everything the fit depends on, including the layout's alignment and wrapping. */
+        g_string_printf (fit_cache->key, "%s\x1f%d\x1f%d\x1f%g\x1f%g\x1f%g\x1f%g\x1f%g\x1f%d\x1f%d\x1f%d\x1f%s",
+                         this->priv->font_family,
+                         this->priv->font_weight,
+                         this->priv->font_italic_flag,
+                         size, line_spacing, width, height, scale,
+                         pango_layout_get_alignment (layout),
+                         pango_layout_get_wrap (layout),
+                         pango_layout_get_width (layout),
+                         text);
+
+        fit_size = g_hash_table_lookup (fit_cache->fits, fit_cache->key->str);
+        if ( fit_size != NULL )
+        {
+                GL_TRACE_COUNT ("text fit cache hits", 1);
 
-        g_object_unref (layout);
+                set_layout_font_size (layout, desc, *fit_size, line_spacing, scale);
+                return *fit_size;
+        }
+        GL_TRACE_COUNT ("text fit cache misses", 1);
 
-        g_print ("Object w = %g, layout w = %g\n", width, layout_width);
-        g_print ("Object h = %g, layout h = %g\n", height, layout_height);
+        set_layout_font_size (layout, desc, size, line_spacing, scale);
+        pango_layout_get_size (layout, &iw, &ih);
+        layout_width  = iw * scale / PANGO_SCALE;
+        layout_height = ih * scale / PANGO_SCALE;
 
         new_wsize = new_hsize = size;
+        max_width = max_height = G_MAXDOUBLE;
         if ( layout_width > width )
         {
                 /* Scale down. */
-                new_wsize = size * (width-2*GL_LABEL_TEXT_MARGIN) / layout_width;
+                max_width = width - 2*GL_LABEL_TEXT_MARGIN;
+                new_wsize = size * max_width / layout_width;
 
                 /* Round down to nearest 1/2 point */
                 new_wsize = (int)(new_wsize*2.0) / 2.0;
@@ -1081,6 +1125,7 @@ auto_shrink_font_size (cairo_t     *cr,
         if ( layout_height > height )
         {
                 /* Scale down. */
+                max_height = height;
                 new_hsize = size * height / layout_height;
 
                 /* Round down to nearest 1/2 point */
@@ -1093,7 +1138,109 @@ auto_shrink_font_size (cairo_t     *cr,
                 }
         }
 
-        return (new_wsize < new_hsize ? new_wsize : new_hsize);
+        size = MIN (new_wsize, new_hsize);
+
+        if ( (max_width < G_MAXDOUBLE || max_height < G_MAXDOUBLE) &&
+             !layout_fits (layout, desc, size, line_spacing, scale, max_width, max_height) &&
+             (size > 1.0) )
+        {
+                /*
+                 * Text does not scale exactly linearly (line spacing, rounding of
+                 * glyph advances), so find the largest half point size that fits
+                 * below the estimate.  It is almost always within a step or two,
+                 * so step down first and only bisect the rest of the range.
+                 */
+                hi = (gint)(size * 2.0);        /* Does not fit. */
+                lo = 0;
+                for ( i = 0; (i < FIT_SEARCH_MAX) && (hi > 2); i++ )
+                {
+                        if ( layout_fits (layout, desc, (hi - 1) / 2.0, line_spacing, scale, max_width, max_height) )
+                        {
+                                lo = hi - 1;
+                                break;
+                        }
+                        hi--;
+                }
+                if ( lo == 0 )
+                {
+                        /* Don't get ridiculously small. */
+                        lo = 2;
+                        while ( hi - lo > 1 )
+                        {
+                                mid = (lo + hi) / 2;
+                                if ( layout_fits (layout, desc, mid / 2.0, line_spacing, scale, max_width, max_height) )
+                                {
+                                        lo = mid;
+                                }
+                                else
+                                {
+                                        hi = mid;
+                                }
+                        }
+                }
+                size = lo / 2.0;
+
+                set_layout_font_size (layout, desc, size, line_spacing, scale);
+        }
+
+        if ( g_hash_table_size (fit_cache->fits) >= FIT_CACHE_MAX )
+        {
+                g_hash_table_remove_all (fit_cache->fits);
+        }
+        fit_size = g_new (gdouble, 1);
+        *fit_size = size;
+        g_hash_table_insert (fit_cache->fits, g_strdup (fit_cache->key->str), fit_size);
+
+        return size;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Set font size of layout, line spacing follows font size.        */
+/*---------------------------------------------------------------------------*/
+static void
+set_layout_font_size (PangoLayout          *layout,
+                      PangoFontDescription *desc,
+                      gdouble               size,
+                      gdouble               line_spacing,
+                      gdouble               scale)
+{
+        pango_font_description_set_size   (desc, size * PANGO_SCALE / scale);
+        pango_layout_set_font_description (layout, desc);
+        pango_layout_set_spacing (layout, size * (line_spacing-1) * PANGO_SCALE / scale);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Set font size of layout and test if it fits given size.         */
+/*---------------------------------------------------------------------------*/
+static gboolean
+layout_fits (PangoLayout          *layout,
+             PangoFontDescription *desc,
+             gdouble               size,
+             gdouble               line_spacing,
+             gdouble               scale,
+             gdouble               max_width,
+             gdouble               max_height)
+{
+        gint iw, ih;
+
+        set_layout_font_size (layout, desc, size, line_spacing, scale);
+        pango_layout_get_size (layout, &iw, &ih);
+
+        return (iw * scale / PANGO_SCALE <= max_width) && (ih * scale / PANGO_SCALE <= max_height);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Free fit cache of thread.                                       */
+/*---------------------------------------------------------------------------*/
+static void
+fit_cache_free (FitCache *fit_cache)
+{
+        g_hash_table_destroy (fit_cache->fits);
+        g_string_free (fit_cache->key, TRUE);
+        g_free (fit_cache);
 }
 
 
@@ -1110,7 +1257,7 @@ layout_text (glLabelText      *this,
         gint                  iw, ih, y;
         gdouble               object_w, object_h;
         gdouble               raw_w, raw_h;
-        gchar                *text;
+        const gchar          *text;
         GList                *lines;
         gdouble               font_size;
         gboolean              auto_shrink;
@@ -1139,26 +1286,19 @@ layout_text (glLabelText      *this,
         gl_label_object_get_size (GL_LABEL_OBJECT (this), &object_w, &object_h);
         gl_label_object_get_raw_size (GL_LABEL_OBJECT (this), &raw_w, &raw_h);
 
-        lines = gl_label_text_get_lines (this);
-        text = gl_text_node_lines_expand (lines, record);
+        if ( this->priv->text_template == NULL )
+        {
+                lines = gl_label_text_get_lines (this);
+                this->priv->text_template = gl_text_template_new (lines);
+                gl_text_node_lines_free (&lines);
+        }
+        text = gl_text_template_expand (this->priv->text_template, record,
+                                        this->priv->expand_buffer);
 
         style = this->priv->font_italic_flag ? PANGO_STYLE_ITALIC : PANGO_STYLE_NORMAL;
 
         font_size   = this->priv->font_size * FONT_SCALE;
         auto_shrink = gl_label_text_get_auto_shrink (this);
-        if (!screen_flag && record && auto_shrink && (raw_w != 0.0))
-        {
-                font_size = auto_shrink_font_size (cr,
-                                                   this->priv->font_family,
-                                                   font_size,
-                                                   this->priv->font_weight,
-                                                   style,
-                                                   this->priv->line_spacing,
-                                                   text,
-                                                   object_w,
-                                                   object_h);
-        }
-
 
         layout = pango_cairo_create_layout (cr);
 
@@ -1169,16 +1309,7 @@ layout_text (glLabelText      *this,
         pango_cairo_context_set_font_options (context, font_options);
         cairo_font_options_destroy (font_options);
 
-        desc = pango_font_description_new ();
-        pango_font_description_set_family (desc, this->priv->font_family);
-        pango_font_description_set_weight (desc, this->priv->font_weight);
-        pango_font_description_set_size   (desc, font_size * PANGO_SCALE / scale_x);
-        pango_font_description_set_style  (desc, style);
-        pango_layout_set_font_description (layout, desc);
-        pango_font_description_free       (desc);
-
         pango_layout_set_text (layout, text, -1);
-        pango_layout_set_spacing (layout, font_size * (this->priv->line_spacing-1) * PANGO_SCALE / scale_x);
         if ( (raw_w == 0.0) || auto_shrink )
         {
                 pango_layout_set_width (layout, -1);
@@ -1189,6 +1320,26 @@ layout_text (glLabelText      *this,
         }
         pango_layout_set_wrap (layout, PANGO_WRAP_WORD);
         pango_layout_set_alignment (layout, this->priv->align);
+
+        desc = pango_font_description_new ();
+        pango_font_description_set_family (desc, this->priv->font_family);
+        pango_font_description_set_weight (desc, this->priv->font_weight);
+        pango_font_description_set_style  (desc, style);
+
+        if (!screen_flag && record && auto_shrink && (raw_w != 0.0))
+        {
+                /* Same layout is measured and rendered, left at fitted size. */
+                font_size = auto_shrink_font_size (this, layout, desc, scale_x,
+                                                   text, font_size,
+                                                   object_w, object_h);
+        }
+        else
+        {
+                set_layout_font_size (layout, desc, font_size, this->priv->line_spacing, scale_x);
+        }
+
+        pango_font_description_free       (desc);
+
         pango_layout_get_pixel_size (layout, &iw, &ih);
 
         switch (this->priv->valign)
@@ -1215,7 +1366,6 @@ layout_text (glLabelText      *this,
         }
 
         g_object_unref (layout);
-        gl_text_node_lines_free (&lines);
 
         cairo_restore (cr);
 
@@ -40,6 +40,19 @@
 /* Private macros and constants.                          */
 /*========================================================*/
 
+/* Spatial index cell size (points). */
+#define INDEX_CELL_SIZE     36.0
+
+/* Objects spanning more cells than this are kept in a separate list. */
+#define INDEX_MAX_CELLS     256
+
+/* Hit-test tolerance around object extents, covers handles and slop. */
+#define HIT_SLOP_PIXELS     8.0
+
+/* Pending object signals during a batch. */
+#define BATCH_OBJECT_CHANGED 1
+#define BATCH_OBJECT_MOVED   2
+
 
 /*========================================================*/
 /* Private types.                                         */
@@ -64,10 +77,23 @@ struct _glLabelPrivate {
 	GHashTable  *pixbuf_cache;
 	GHashTable  *svg_cache;
 
-        /* Delay changed signals while operating on selections of multiple objects. */
-        gboolean     selection_op_flag;
+        /* Delay changed signals while operating on multiple objects (batches). */
+        gint         batch_depth;
+        gboolean     batch_flushing_flag;
+        GHashTable  *batch_objects;
         gboolean     delayed_change_flag;
 
+        /* Damage accumulated since the last gl_label_take_damage(). */
+        glLabelRegion damage;
+        gboolean     damage_flag;
+        gboolean     damage_all_flag;
+
+        /* Spatial index of object extents, kept up to date by damage_object(). */
+        GHashTable  *object_info;
+        GHashTable  *index_cells;
+        GList       *index_large_objects;
+        gboolean     z_order_valid;
+
 	/* Default object text properties */
 	gchar             *default_font_family;
 	gdouble            default_font_size;
@@ -93,7 +119,15 @@ struct _glLabelPrivate {
 };
 
 typedef struct {
-        gchar             *xml_buffer;
+        glLabelRegion      extent;           /* Last known extent, including shadow. */
+        gint               i1, j1, i2, j2;   /* Index cells covered by extent. */
+        gboolean           large_flag;
+        gint               z;                /* Position in object list. */
+} ObjectInfo;
+
+typedef struct {
+        glLabel           *label_copy;      /* Snapshot of copied objects.   */
+        gchar             *xml_buffer;      /* Only if requested by others.  */
         gchar             *text;
         GdkPixbuf         *pixbuf;
 } ClipboardData;
@@ -117,8 +151,15 @@ typedef struct {
         lglTemplate *template;
         gboolean     rotate_flag;
 
+        /* Object snapshots are shared with the live objects (see
+         * gl_label_object_get_snapshot()), so unchanged objects cost nothing
+         * per checkpoint.  Selection is kept apart since it does not
+         * invalidate a snapshot. */
         GList       *object_list;
+        gboolean    *selected_flags;
 
+        /* The label's merge is never modified in place, so a reference is
+         * enough, regardless of how many records it holds. */
 	glMerge     *merge;
 
 } State;
@@ -132,6 +173,9 @@ static guint signals[LAST_SIGNAL] = {0};
 
 static guint untitled = 0;
 
+/* Our clipboard contents, while we own the clipboard. */
+static ClipboardData *clipboard_data = NULL;
+
 
 /*========================================================*/
 /* Private function prototypes.                           */
@@ -146,9 +190,38 @@ static void object_moved_cb        (glLabelObject *object,
                                     glLabel       *label);
 
 static void do_modify              (glLabel       *label);
+static void do_modify_objects      (glLabel       *label);
+
+static void get_damage_extent      (glLabelObject *object,
+                                    glLabelRegion *region);
+static void add_damage             (glLabel       *label,
+                                    glLabelRegion *region);
+static void damage_object          (glLabel       *label,
+                                    glLabelObject *object);
+
+static void   index_insert         (glLabel             *label,
+                                    glLabelObject       *object,
+                                    ObjectInfo          *info);
+static void   index_remove         (glLabel             *label,
+                                    glLabelObject       *object,
+                                    ObjectInfo          *info);
+static GList *index_query          (glLabel             *label,
+                                    const glLabelRegion *region);
+static gint   index_compare_z      (gconstpointer        a,
+                                    gconstpointer        b,
+                                    gpointer             user_data);
+static void   free_index_cell      (gpointer             key,
+                                    gpointer             value,
+                                    gpointer             user_data);
+static void   get_hit_region       (cairo_t             *cr,
+                                    gdouble              x_pixels,
+                                    gdouble              y_pixels,
+                                    glLabelRegion       *region);
+
+static void set_object_selected    (glLabel       *label,
+                                    glLabelObject *object,
+                                    gboolean       select_flag);
 
-static void begin_selection_op     (glLabel       *label);
-static void end_selection_op       (glLabel       *label);
 
 static void clipboard_get_cb       (GtkClipboard     *clipboard,
                                     GtkSelectionData *selection_data,
@@ -167,6 +240,9 @@ static void paste_xml_received_cb  (GtkClipboard     *clipboard,
                                     GtkSelectionData *selection_data,
                                     glLabel          *label);
 
+static void paste_objects          (glLabel          *label,
+                                    glLabel          *label_copy);
+
 static void paste_text_received_cb (GtkClipboard     *clipboard,
                                     const gchar      *text,
                                     glLabel          *label);
@@ -282,6 +358,11 @@ gl_label_init (glLabel *label)
 	label->priv->pixbuf_cache  = gl_pixbuf_cache_new ();
 	label->priv->svg_cache     = gl_svg_cache_new ();
 
+        label->priv->object_info   = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                            NULL, g_free);
+        label->priv->index_cells   = g_hash_table_new (g_direct_hash, g_direct_equal);
+        label->priv->batch_objects = g_hash_table_new (g_direct_hash, g_direct_equal);
+
         label->priv->undo_stack    = g_queue_new ();
         label->priv->redo_stack    = g_queue_new ();
 
@@ -336,6 +417,12 @@ gl_label_finalize (GObject *object)
 	gl_pixbuf_cache_free (label->priv->pixbuf_cache);
 	gl_svg_cache_free (label->priv->svg_cache);
 
+        g_hash_table_foreach (label->priv->index_cells, free_index_cell, NULL);
+        g_hash_table_destroy (label->priv->index_cells);
+        g_hash_table_destroy (label->priv->object_info);
+        g_list_free (label->priv->index_large_objects);
+        g_hash_table_destroy (label->priv->batch_objects);
+
 	g_free (label->priv);
 
 	G_OBJECT_CLASS (gl_label_parent_class)->finalize (object);
@@ -362,6 +449,46 @@ gl_label_new (void)
 }
 
 
+/*****************************************************************************/
+/* Duplicate label, e.g. to render it outside of the main thread.  The copy  */
+/* shares the (never modified in place) merge of the original.               */
+/*****************************************************************************/
+glLabel *
+gl_label_dup (glLabel *label)
+{
+	glLabel       *new_label;
+        GList         *p;
+        glLabelObject *object;
+
+	gl_debug (DEBUG_LABEL, "START");
+
+	g_return_val_if_fail (label && GL_IS_LABEL (label), NULL);
+
+	new_label = GL_LABEL (gl_label_new ());
+
+        /* Set directly, this is not a user visible template change. */
+        new_label->priv->template    = lgl_template_dup (label->priv->template);
+        new_label->priv->rotate_flag = label->priv->rotate_flag;
+
+        gl_label_begin_batch (new_label);
+        for ( p = label->priv->object_list; p != NULL; p = p->next )
+        {
+                object = gl_label_object_dup (GL_LABEL_OBJECT (p->data), new_label);
+                gl_label_add_object (new_label, object);
+        }
+        gl_label_end_batch (new_label);
+
+        if ( label->priv->merge )
+        {
+                new_label->priv->merge = g_object_ref (label->priv->merge);
+        }
+
+	gl_debug (DEBUG_LABEL, "END");
+
+	return new_label;
+}
+
+
 /****************************************************************************/
 /* Set filename.                                                            */
 /****************************************************************************/
@@ -518,7 +645,8 @@ static void
 object_changed_cb (glLabelObject *object,
                    glLabel       *label)
 {
-        do_modify (label);
+        damage_object (label, object);
+        do_modify_objects (label);
 }
 
 
@@ -529,17 +657,30 @@ static void
 object_moved_cb (glLabelObject *object,
                  glLabel       *label)
 {
-        do_modify (label);
+        damage_object (label, object);
+        do_modify_objects (label);
 }
 
 
 /****************************************************************************/
-/* Do modify.                                                               */
+/* Do modify.  Damages the entire label.                                    */
 /****************************************************************************/
 static void
 do_modify (glLabel  *label)
 {
-        if ( label->priv->selection_op_flag )
+        label->priv->damage_all_flag = TRUE;
+
+        do_modify_objects (label);
+}
+
+
+/****************************************************************************/
+/* Do modify, damage limited to objects already passed to damage_object().  */
+/****************************************************************************/
+static void
+do_modify_objects (glLabel  *label)
+{
+        if ( label->priv->batch_depth > 0 )
         {
                 label->priv->delayed_change_flag = TRUE;
         }
@@ -554,30 +695,421 @@ do_modify (glLabel  *label)
 
 
 /****************************************************************************/
-/* Begin selection operation.                                               */
+/* Get extent of everything an object draws, including its shadow.          */
 /****************************************************************************/
 static void
-begin_selection_op (glLabel  *label)
+get_damage_extent (glLabelObject *object,
+                   glLabelRegion *region)
 {
-        label->priv->selection_op_flag = TRUE;
+        gdouble shadow_x, shadow_y;
+
+        gl_label_object_get_extent (object, region);
+
+        if ( gl_label_object_get_shadow_state (object) )
+        {
+                gl_label_object_get_shadow_offset (object, &shadow_x, &shadow_y);
+
+                region->x1 += MIN (shadow_x, 0);
+                region->y1 += MIN (shadow_y, 0);
+                region->x2 += MAX (shadow_x, 0);
+                region->y2 += MAX (shadow_y, 0);
+        }
 }
 
 
 /****************************************************************************/
-/* End selection operation.                                                 */
+/* Add region to accumulated damage.                                        */
 /****************************************************************************/
 static void
-end_selection_op (glLabel  *label)
+add_damage (glLabel       *label,
+            glLabelRegion *region)
+{
+        if ( label->priv->damage_flag )
+        {
+                label->priv->damage.x1 = MIN (label->priv->damage.x1, region->x1);
+                label->priv->damage.y1 = MIN (label->priv->damage.y1, region->y1);
+                label->priv->damage.x2 = MAX (label->priv->damage.x2, region->x2);
+                label->priv->damage.y2 = MAX (label->priv->damage.y2, region->y2);
+        }
+        else
+        {
+                label->priv->damage      = *region;
+                label->priv->damage_flag = TRUE;
+        }
+}
+
+
+/****************************************************************************/
+/* Damage both the last known and the current extent of an object, and      */
+/* update its entry in the spatial index.                                   */
+/****************************************************************************/
+static void
+damage_object (glLabel       *label,
+               glLabelObject *object)
+{
+        ObjectInfo    *info;
+        glLabelRegion  extent;
+
+        get_damage_extent (object, &extent);
+        add_damage (label, &extent);
+
+        info = g_hash_table_lookup (label->priv->object_info, object);
+        if ( info == NULL )
+        {
+                info = g_new0 (ObjectInfo, 1);
+                g_hash_table_insert (label->priv->object_info, object, info);
+
+                label->priv->z_order_valid = FALSE;
+        }
+        else
+        {
+                add_damage (label, &info->extent);
+
+                if ( (info->extent.x1 == extent.x1) && (info->extent.y1 == extent.y1) &&
+                     (info->extent.x2 == extent.x2) && (info->extent.y2 == extent.y2) )
+                {
+                        return;
+                }
+
+                index_remove (label, object, info);
+        }
+
+        info->extent = extent;
+        index_insert (label, object, info);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Index cell coordinate and key.                                  */
+/*---------------------------------------------------------------------------*/
+static inline gint
+index_cell (gdouble x)
+{
+        return (gint) CLAMP (floor (x / INDEX_CELL_SIZE), -32767.0, 32767.0);
+}
+
+#define INDEX_CELL_KEY(i,j) GUINT_TO_POINTER ((((guint)(i) & 0xFFFF) << 16) | ((guint)(j) & 0xFFFF))
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Add object to spatial index at info->extent.                    */
+/*---------------------------------------------------------------------------*/
+static void
+index_insert (glLabel       *label,
+              glLabelObject *object,
+              ObjectInfo    *info)
+{
+        gint     i, j;
+        gpointer key;
+        GList   *cell;
+
+        info->i1 = index_cell (info->extent.x1);
+        info->j1 = index_cell (info->extent.y1);
+        info->i2 = index_cell (info->extent.x2);
+        info->j2 = index_cell (info->extent.y2);
+
+        info->large_flag = ((info->i2 - info->i1 + 1) * (info->j2 - info->j1 + 1) > INDEX_MAX_CELLS);
+        if ( info->large_flag )
+        {
+                label->priv->index_large_objects =
+                        g_list_prepend (label->priv->index_large_objects, object);
+                return;
+        }
+
+        for ( i = info->i1; i <= info->i2; i++ )
+        {
+                for ( j = info->j1; j <= info->j2; j++ )
+                {
+                        key  = INDEX_CELL_KEY (i, j);
+                        cell = g_hash_table_lookup (label->priv->index_cells, key);
+                        cell = g_list_prepend (cell, object);
+                        g_hash_table_insert (label->priv->index_cells, key, cell);
+                }
+        }
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Remove object from spatial index.                               */
+/*---------------------------------------------------------------------------*/
+static void
+index_remove (glLabel       *label,
+              glLabelObject *object,
+              ObjectInfo    *info)
+{
+        gint     i, j;
+        gpointer key;
+        GList   *cell;
+
+        if ( info->large_flag )
+        {
+                label->priv->index_large_objects =
+                        g_list_remove (label->priv->index_large_objects, object);
+                return;
+        }
+
+        for ( i = info->i1; i <= info->i2; i++ )
+        {
+                for ( j = info->j1; j <= info->j2; j++ )
+                {
+                        key  = INDEX_CELL_KEY (i, j);
+                        cell = g_hash_table_lookup (label->priv->index_cells, key);
+                        cell = g_list_remove (cell, object);
+                        if ( cell )
+                        {
+                                g_hash_table_insert (label->priv->index_cells, key, cell);
+                        }
+                        else
+                        {
+                                g_hash_table_remove (label->priv->index_cells, key);
+                        }
+                }
+        }
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Get objects whose extent intersects region, front most first.   */
+/*---------------------------------------------------------------------------*/
+static GList *
+index_query (glLabel             *label,
+             const glLabelRegion *region)
+{
+        GList         *candidates = NULL;
+        GList         *p, *p_next;
+        GList         *cell;
+        ObjectInfo    *info;
+        gint           qi1, qj1, qi2, qj2;
+        gint           i, j;
+
+        qi1 = index_cell (region->x1);
+        qj1 = index_cell (region->y1);
+        qi2 = index_cell (region->x2);
+        qj2 = index_cell (region->y2);
+
+        if ( (qi2 - qi1 + 1) * (qj2 - qj1 + 1) > INDEX_MAX_CELLS )
+        {
+                /* Large query, cheaper to scan every object. */
+                for ( p = label->priv->object_list; p != NULL; p = p->next )
+                {
+                        candidates = g_list_prepend (candidates, p->data);
+                }
+        }
+        else
+        {
+                for ( i = qi1; i <= qi2; i++ )
+                {
+                        for ( j = qj1; j <= qj2; j++ )
+                        {
+                                cell = g_hash_table_lookup (label->priv->index_cells,
+                                                            INDEX_CELL_KEY (i, j));
+                                for ( p = cell; p != NULL; p = p->next )
+                                {
+                                        info = g_hash_table_lookup (label->priv->object_info, p->data);
+
+                                        /* Collect each object only from the first cell it shares with query. */
+                                        if ( (i == MAX (info->i1, qi1)) && (j == MAX (info->j1, qj1)) )
+                                        {
+                                                candidates = g_list_prepend (candidates, p->data);
+                                        }
+                                }
+                        }
+                }
+
+                for ( p = label->priv->index_large_objects; p != NULL; p = p->next )
+                {
+                        candidates = g_list_prepend (candidates, p->data);
+                }
+        }
+
+        /* Exact extent test. */
+        for ( p = candidates; p != NULL; p = p_next )
+        {
+                p_next = p->next;
+                info   = g_hash_table_lookup (label->priv->object_info, p->data);
+
+                if ( (info->extent.x2 < region->x1) || (info->extent.x1 > region->x2) ||
+                     (info->extent.y2 < region->y1) || (info->extent.y1 > region->y2) )
+                {
+                        candidates = g_list_delete_link (candidates, p);
+                }
+        }
+
+        if ( !label->priv->z_order_valid )
+        {
+                for ( p = label->priv->object_list, i = 0; p != NULL; p = p->next, i++ )
+                {
+                        info = g_hash_table_lookup (label->priv->object_info, p->data);
+                        info->z = i;
+                }
+                label->priv->z_order_valid = TRUE;
+        }
+
+        return g_list_sort_with_data (candidates, index_compare_z, label);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Sort objects, front most first.                                 */
+/*---------------------------------------------------------------------------*/
+static gint
+index_compare_z (gconstpointer a,
+                 gconstpointer b,
+                 gpointer      user_data)
+{
+        glLabel    *label = GL_LABEL (user_data);
+        ObjectInfo *info_a, *info_b;
+
+        info_a = g_hash_table_lookup (label->priv->object_info, a);
+        info_b = g_hash_table_lookup (label->priv->object_info, b);
+
+        return info_b->z - info_a->z;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Free list of objects in an index cell.                          */
+/*---------------------------------------------------------------------------*/
+static void
+free_index_cell (gpointer key,
+                 gpointer value,
+                 gpointer user_data)
 {
-        label->priv->selection_op_flag = FALSE;
+        g_list_free ((GList *)value);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Get label region within hit slop of device coordinates.         */
+/*---------------------------------------------------------------------------*/
+static void
+get_hit_region (cairo_t       *cr,
+                gdouble        x_pixels,
+                gdouble        y_pixels,
+                glLabelRegion *region)
+{
+        gdouble x, y;
+        gdouble slop_x, slop_y;
+
+        x = x_pixels;
+        y = y_pixels;
+        cairo_device_to_user (cr, &x, &y);
+
+        slop_x = HIT_SLOP_PIXELS;
+        slop_y = HIT_SLOP_PIXELS;
+        cairo_device_to_user_distance (cr, &slop_x, &slop_y);
+        slop_x = fabs (slop_x);
+        slop_y = fabs (slop_y);
+
+        region->x1 = x - slop_x;
+        region->y1 = y - slop_y;
+        region->x2 = x + slop_x;
+        region->y2 = y + slop_y;
+}
+
+
+/****************************************************************************/
+/* Begin batch.  Until the matching gl_label_end_batch(), "changed" and     */
+/* "moved" signals of member objects are coalesced, and the label emits at  */
+/* most one "changed" and "modified_changed".  Batches may be nested.       */
+/****************************************************************************/
+void
+gl_label_begin_batch (glLabel  *label)
+{
+        g_return_if_fail (label && GL_IS_LABEL (label));
+
+        label->priv->batch_depth++;
+}
+
+
+/****************************************************************************/
+/* End batch.  Flush coalesced object signals, then label signals.          */
+/****************************************************************************/
+void
+gl_label_end_batch (glLabel  *label)
+{
+        GHashTable    *pending;
+        GList         *p;
+        glLabelObject *object;
+        gint           flags;
+
+        g_return_if_fail (label && GL_IS_LABEL (label));
+        g_return_if_fail (label->priv->batch_depth > 0);
+
+        if ( label->priv->batch_depth > 1 )
+        {
+                label->priv->batch_depth--;
+                return;
+        }
+
+        if ( g_hash_table_size (label->priv->batch_objects) > 0 )
+        {
+                gl_debug (DEBUG_LABEL, "flushing %d objects",
+                          g_hash_table_size (label->priv->batch_objects));
+
+                pending = label->priv->batch_objects;
+                label->priv->batch_objects = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+                /* Emit in z-order, still holding off label signals until the end. */
+                label->priv->batch_flushing_flag = TRUE;
+                for ( p = label->priv->object_list; p != NULL; p = p->next )
+                {
+                        object = GL_LABEL_OBJECT (p->data);
+                        flags  = GPOINTER_TO_INT (g_hash_table_lookup (pending, object));
+
+                        if ( flags & BATCH_OBJECT_MOVED )
+                        {
+                                g_signal_emit_by_name (G_OBJECT (object), "moved");
+                        }
+                        if ( flags & BATCH_OBJECT_CHANGED )
+                        {
+                                g_signal_emit_by_name (G_OBJECT (object), "changed");
+                        }
+                }
+                label->priv->batch_flushing_flag = FALSE;
+
+                g_hash_table_destroy (pending);
+        }
+
+        label->priv->batch_depth = 0;
         if ( label->priv->delayed_change_flag )
         {
                 label->priv->delayed_change_flag = FALSE;
-                do_modify (label);
+                do_modify_objects (label);
         }
 }
 
 
+/****************************************************************************/
+/* Defer "changed" (or "moved") signal of object until end of batch.        */
+/* Returns FALSE if no batch is open and object should emit it now.         */
+/****************************************************************************/
+gboolean
+gl_label_defer_object_notify (glLabel       *label,
+                              glLabelObject *object,
+                              gboolean       moved_flag)
+{
+        gint flags;
+
+        if ( (label->priv->batch_depth == 0) || label->priv->batch_flushing_flag )
+        {
+                return FALSE;
+        }
+
+        /* Only objects that are part of this label, not snapshots or copies. */
+        if ( !g_hash_table_lookup (label->priv->object_info, object) )
+        {
+                return FALSE;
+        }
+
+        flags  = GPOINTER_TO_INT (g_hash_table_lookup (label->priv->batch_objects, object));
+        flags |= moved_flag ? BATCH_OBJECT_MOVED : BATCH_OBJECT_CHANGED;
+        g_hash_table_insert (label->priv->batch_objects, object, GINT_TO_POINTER (flags));
+
+        return TRUE;
+}
+
+
 /****************************************************************************/
 /* set template.                                                            */
 /****************************************************************************/
@@ -904,7 +1436,8 @@ gl_label_add_object (glLabel       *label,
         g_signal_connect (G_OBJECT (object), "moved",
                           G_CALLBACK (object_moved_cb), label);
 
-        do_modify (label);
+        damage_object (label, object);
+        do_modify_objects (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -928,9 +1461,16 @@ gl_label_delete_object (glLabel       *label,
                                               G_CALLBACK (object_changed_cb), label);
         g_signal_handlers_disconnect_by_func (G_OBJECT (object),
                                               G_CALLBACK (object_moved_cb), label);
+
+        damage_object (label, object);
+        index_remove (label, object, g_hash_table_lookup (label->priv->object_info, object));
+        g_hash_table_remove (label->priv->object_info, object);
+        g_hash_table_remove (label->priv->batch_objects, object);
+        label->priv->z_order_valid = FALSE;
+
         g_object_unref (object);
 
-        do_modify (label);
+        do_modify_objects (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -946,6 +1486,30 @@ gl_label_get_object_list (glLabel       *label)
 }
 
 
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Select or unselect object, damaging it if its state changes.    */
+/*---------------------------------------------------------------------------*/
+static void
+set_object_selected (glLabel       *label,
+                     glLabelObject *object,
+                     gboolean       select_flag)
+{
+        if ( gl_label_object_is_selected (object) != select_flag )
+        {
+                damage_object (label, object);
+        }
+
+        if ( select_flag )
+        {
+                gl_label_object_select (object);
+        }
+        else
+        {
+                gl_label_object_unselect (object);
+        }
+}
+
+
 /*****************************************************************************/
 /* Select object.                                                            */
 /*****************************************************************************/
@@ -958,7 +1522,7 @@ gl_label_select_object (glLabel       *label,
 	g_return_if_fail (label && GL_IS_LABEL (label));
 	g_return_if_fail (object && GL_IS_LABEL_OBJECT (object));
 
-        gl_label_object_select (object);
+        set_object_selected (label, object, TRUE);
 
         label->priv->cp_cleared_flag = TRUE;
 	g_signal_emit (G_OBJECT(label), signals[SELECTION_CHANGED], 0);
@@ -979,7 +1543,7 @@ gl_label_unselect_object (glLabel       *label,
 	g_return_if_fail (label && GL_IS_LABEL (label));
 	g_return_if_fail (object && GL_IS_LABEL_OBJECT (object));
 
-        gl_label_object_unselect (object);
+        set_object_selected (label, object, FALSE);
 
         label->priv->cp_cleared_flag = TRUE;
 	g_signal_emit (G_OBJECT(label), signals[SELECTION_CHANGED], 0);
@@ -1005,7 +1569,7 @@ gl_label_select_all (glLabel       *label)
         {
                 object = GL_LABEL_OBJECT (p->data);
 
-                gl_label_object_select (object);
+                set_object_selected (label, object, TRUE);
         }
 
         label->priv->cp_cleared_flag = TRUE;
@@ -1032,7 +1596,7 @@ gl_label_unselect_all (glLabel       *label)
         {
                 object = GL_LABEL_OBJECT (p->data);
 
-                gl_label_object_unselect (object);
+                set_object_selected (label, object, FALSE);
         }
 
         label->priv->cp_cleared_flag = TRUE;
@@ -1049,35 +1613,39 @@ void
 gl_label_select_region (glLabel       *label,
                         glLabelRegion *region)
 {
+        glLabelRegion  r;
+        GList         *candidates;
 	GList         *p;
 	glLabelObject *object;
-        gdouble        r_x1, r_y1;
-        gdouble        r_x2, r_y2;
         glLabelRegion  obj_extent;
 
 	gl_debug (DEBUG_LABEL, "START");
 
 	g_return_if_fail (label && GL_IS_LABEL (label));
 
-        r_x1 = MIN (region->x1, region->x2);
-        r_y1 = MIN (region->y1, region->y2);
-        r_x2 = MAX (region->x1, region->x2);
-        r_y2 = MAX (region->y1, region->y2);
+        r.x1 = MIN (region->x1, region->x2);
+        r.y1 = MIN (region->y1, region->y2);
+        r.x2 = MAX (region->x1, region->x2);
+        r.y2 = MAX (region->y1, region->y2);
 
-	for (p = label->priv->object_list; p != NULL; p = p->next)
+        candidates = index_query (label, &r);
+
+	for (p = candidates; p != NULL; p = p->next)
         {
 		object = GL_LABEL_OBJECT(p->data);
 
                 gl_label_object_get_extent (object, &obj_extent);
-                if ((obj_extent.x1 >= r_x1) &&
-                    (obj_extent.x2 <= r_x2) &&
-                    (obj_extent.y1 >= r_y1) &&
-                    (obj_extent.y2 <= r_y2))
+                if ((obj_extent.x1 >= r.x1) &&
+                    (obj_extent.x2 <= r.x2) &&
+                    (obj_extent.y1 >= r.y1) &&
+                    (obj_extent.y2 <= r.y2))
                 {
-                        gl_label_object_select (object);
+                        set_object_selected (label, object, TRUE);
                 }
 	}
 
+        g_list_free (candidates);
+
         label->priv->cp_cleared_flag = TRUE;
 	g_signal_emit (G_OBJECT(label), signals[SELECTION_CHANGED], 0);
 
@@ -1330,7 +1898,7 @@ gl_label_delete_selection (glLabel       *label)
 
         gl_label_checkpoint (label, _("Delete"));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -1343,7 +1911,7 @@ gl_label_delete_selection (glLabel       *label)
 
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	g_signal_emit (G_OBJECT(label), signals[SELECTION_CHANGED], 0);
 
@@ -1365,7 +1933,7 @@ gl_label_raise_selection_to_top (glLabel       *label)
 
         gl_label_checkpoint (label, _("Bring to front"));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -1373,15 +1941,17 @@ gl_label_raise_selection_to_top (glLabel       *label)
         {
                 object = GL_LABEL_OBJECT (p->data);
 
+                damage_object (label, object);
                 label->priv->object_list = g_list_remove (label->priv->object_list, object);
         }
 
 	/* Move to end of list, representing front most object */
 	label->priv->object_list = g_list_concat (label->priv->object_list, selection_list);
+        label->priv->z_order_valid = FALSE;
 
-        do_modify (label);
+        do_modify_objects (label);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -1401,7 +1971,7 @@ gl_label_lower_selection_to_bottom (glLabel       *label)
 
         gl_label_checkpoint (label, _("Send to back"));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -1409,15 +1979,17 @@ gl_label_lower_selection_to_bottom (glLabel       *label)
         {
                 object = GL_LABEL_OBJECT (p->data);
 
+                damage_object (label, object);
                 label->priv->object_list = g_list_remove (label->priv->object_list, object);
         }
 
 	/* Move to front of list, representing rear most object */
 	label->priv->object_list = g_list_concat (selection_list, label->priv->object_list);
+        label->priv->z_order_valid = FALSE;
 
-        do_modify (label);
+        do_modify_objects (label);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -1438,7 +2010,7 @@ gl_label_rotate_selection (glLabel *label,
 
 	g_return_if_fail (label && GL_IS_LABEL (label));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         gl_label_checkpoint (label, _("Rotate"));
 
@@ -1449,13 +2021,14 @@ gl_label_rotate_selection (glLabel *label,
 		object = GL_LABEL_OBJECT (p->data);
 
 		gl_label_object_rotate (object, theta_degs);
+                damage_object (label, object);
 	}
 
 	g_list_free (selection_list);
 
-	do_modify (label);
+	do_modify_objects (label);
 
-	end_selection_op (label);
+	gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -1475,7 +2048,7 @@ gl_label_rotate_selection_left (glLabel *label)
 
 	g_return_if_fail (label && GL_IS_LABEL (label));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         gl_label_checkpoint (label, _("Rotate left"));
 
@@ -1486,13 +2059,14 @@ gl_label_rotate_selection_left (glLabel *label)
 		object = GL_LABEL_OBJECT (p->data);
 
 		gl_label_object_rotate (object, -90.0);
+                damage_object (label, object);
 	}
 
 	g_list_free (selection_list);
 
-	do_modify (label);
+	do_modify_objects (label);
 
-	end_selection_op (label);
+	gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -1514,7 +2088,7 @@ gl_label_rotate_selection_right (glLabel *label)
 
         gl_label_checkpoint (label, _("Rotate right"));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -1523,13 +2097,14 @@ gl_label_rotate_selection_right (glLabel *label)
 		object = GL_LABEL_OBJECT (p->data);
 
 		gl_label_object_rotate (object, 90.0);
+                damage_object (label, object);
 	}
 
 	g_list_free (selection_list);
 
-	do_modify (label);
+	do_modify_objects (label);
 
-	end_selection_op (label);
+	gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -1551,7 +2126,7 @@ gl_label_flip_selection_horiz (glLabel *label)
 
         gl_label_checkpoint (label, _("Flip horizontally"));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -1560,13 +2135,14 @@ gl_label_flip_selection_horiz (glLabel *label)
 		object = GL_LABEL_OBJECT (p->data);
 
 		gl_label_object_flip_horiz (object);
+                damage_object (label, object);
 	}
 
 	g_list_free (selection_list);
 
-	do_modify (label);
+	do_modify_objects (label);
 
-	end_selection_op (label);
+	gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -1588,7 +2164,7 @@ gl_label_flip_selection_vert (glLabel *label)
 
         gl_label_checkpoint (label, _("Flip vertically"));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -1597,13 +2173,14 @@ gl_label_flip_selection_vert (glLabel *label)
 		object = GL_LABEL_OBJECT (p->data);
 
 		gl_label_object_flip_vert (object);
+                damage_object (label, object);
 	}
 
 	g_list_free (selection_list);
 
-	do_modify (label);
+	do_modify_objects (label);
 
-	end_selection_op (label);
+	gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -1630,7 +2207,7 @@ gl_label_align_selection_left (glLabel *label)
 
         gl_label_checkpoint (label, _("Align left"));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -1660,7 +2237,7 @@ gl_label_align_selection_left (glLabel *label)
 
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -1687,7 +2264,7 @@ gl_label_align_selection_right (glLabel *label)
 
         gl_label_checkpoint (label, _("Align right"));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -1717,7 +2294,7 @@ gl_label_align_selection_right (glLabel *label)
 
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -1748,7 +2325,7 @@ gl_label_align_selection_hcenter (glLabel *label)
 
         gl_label_checkpoint (label, _("Align horizontal center"));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -1797,7 +2374,7 @@ gl_label_align_selection_hcenter (glLabel *label)
 
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -1824,7 +2401,7 @@ gl_label_align_selection_top (glLabel *label)
 
         gl_label_checkpoint (label, _("Align tops"));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -1854,7 +2431,7 @@ gl_label_align_selection_top (glLabel *label)
 
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -1881,7 +2458,7 @@ gl_label_align_selection_bottom (glLabel *label)
 
         gl_label_checkpoint (label, _("Align bottoms"));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -1911,7 +2488,7 @@ gl_label_align_selection_bottom (glLabel *label)
 
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -1942,7 +2519,7 @@ gl_label_align_selection_vcenter (glLabel *label)
 
         gl_label_checkpoint (label, _("Align vertical center"));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -1991,7 +2568,7 @@ gl_label_align_selection_vcenter (glLabel *label)
 
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -2020,7 +2597,7 @@ gl_label_center_selection_horiz (glLabel *label)
 
         gl_label_checkpoint (label, _("Center horizontally"));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
 	gl_label_get_size (label, &w, &h);
 	x_label_center = w / 2.0;
@@ -2038,7 +2615,7 @@ gl_label_center_selection_horiz (glLabel *label)
 	}
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -2067,7 +2644,7 @@ gl_label_center_selection_vert (glLabel *label)
 
         gl_label_checkpoint (label, _("Center vertically"));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
 	gl_label_get_size (label, &w, &h);
 	y_label_center = h / 2.0;
@@ -2085,7 +2662,7 @@ gl_label_center_selection_vert (glLabel *label)
 	}
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -2107,7 +2684,7 @@ gl_label_move_selection (glLabel  *label,
 
 	g_return_if_fail (label && GL_IS_LABEL (label));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -2120,7 +2697,7 @@ gl_label_move_selection (glLabel  *label,
 
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -2141,7 +2718,7 @@ gl_label_set_selection_font_family (glLabel      *label,
 
 	g_return_if_fail (label && GL_IS_LABEL (label));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -2153,7 +2730,7 @@ gl_label_set_selection_font_family (glLabel      *label,
 
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -2174,7 +2751,7 @@ gl_label_set_selection_font_size (glLabel  *label,
 
 	g_return_if_fail (label && GL_IS_LABEL (label));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -2186,7 +2763,7 @@ gl_label_set_selection_font_size (glLabel  *label,
 
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -2207,7 +2784,7 @@ gl_label_set_selection_font_weight (glLabel      *label,
 
 	g_return_if_fail (label && GL_IS_LABEL (label));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -2219,7 +2796,7 @@ gl_label_set_selection_font_weight (glLabel      *label,
 
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -2240,7 +2817,7 @@ gl_label_set_selection_font_italic_flag (glLabel   *label,
 
 	g_return_if_fail (label && GL_IS_LABEL (label));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -2252,7 +2829,7 @@ gl_label_set_selection_font_italic_flag (glLabel   *label,
 
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -2273,7 +2850,7 @@ gl_label_set_selection_text_alignment (glLabel        *label,
 
 	g_return_if_fail (label && GL_IS_LABEL (label));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -2285,7 +2862,7 @@ gl_label_set_selection_text_alignment (glLabel        *label,
 
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -2306,7 +2883,7 @@ gl_label_set_selection_text_valignment (glLabel        *label,
 
 	g_return_if_fail (label && GL_IS_LABEL (label));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -2318,7 +2895,7 @@ gl_label_set_selection_text_valignment (glLabel        *label,
 
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -2339,7 +2916,7 @@ gl_label_set_selection_text_line_spacing (glLabel  *label,
 
 	g_return_if_fail (label && GL_IS_LABEL (label));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -2351,7 +2928,7 @@ gl_label_set_selection_text_line_spacing (glLabel  *label,
 
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -2372,7 +2949,7 @@ gl_label_set_selection_text_color (glLabel      *label,
 
 	g_return_if_fail (label && GL_IS_LABEL (label));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -2384,7 +2961,7 @@ gl_label_set_selection_text_color (glLabel      *label,
 
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -2405,7 +2982,7 @@ gl_label_set_selection_fill_color (glLabel      *label,
 
 	g_return_if_fail (label && GL_IS_LABEL (label));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -2417,7 +2994,7 @@ gl_label_set_selection_fill_color (glLabel      *label,
 
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -2438,7 +3015,7 @@ gl_label_set_selection_line_color (glLabel      *label,
 
 	g_return_if_fail (label && GL_IS_LABEL (label));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -2450,7 +3027,7 @@ gl_label_set_selection_line_color (glLabel      *label,
 
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -2471,7 +3048,7 @@ gl_label_set_selection_line_width (glLabel  *label,
 
 	g_return_if_fail (label && GL_IS_LABEL (label));
 
-        begin_selection_op (label);
+        gl_label_begin_batch (label);
 
         selection_list = gl_label_get_selection_list (label);
 
@@ -2483,7 +3060,7 @@ gl_label_set_selection_line_width (glLabel  *label,
 
         g_list_free (selection_list);
 
-        end_selection_op (label);
+        gl_label_end_batch (label);
 
 	gl_debug (DEBUG_LABEL, "END");
 }
@@ -2517,7 +3094,6 @@ gl_label_copy_selection (glLabel       *label)
         glLabel           *label_copy;
 	GList             *p;
 	glLabelObject     *object;
-        glXMLLabelStatus   status;
 
         ClipboardData     *data;
 
@@ -2545,7 +3121,10 @@ gl_label_copy_selection (glLabel       *label)
                 target_list = gtk_target_list_new (glabels_targets, G_N_ELEMENTS(glabels_targets));
 
                 /*
-                 * Serialize selection by encoding as an XML label document.
+                 * Snapshot selection.  Objects share pixbufs and encoded data
+                 * with the original through the caches, so this is cheap.  It
+                 * is only serialized as an XML label document if another
+                 * application asks for it.
                  */
 		label_copy = GL_LABEL(gl_label_new ());
 
@@ -2559,9 +3138,7 @@ gl_label_copy_selection (glLabel       *label)
 			gl_label_add_object (label_copy, gl_label_object_dup (object, label_copy));
 		}
 
-                data->xml_buffer = gl_xml_label_save_buffer (label_copy, &status);
-
-                g_object_unref (G_OBJECT (label_copy));
+                data->label_copy = label_copy;
 
 
                 /*
@@ -2597,11 +3174,18 @@ gl_label_copy_selection (glLabel       *label)
 
                 target_table = gtk_target_table_new_from_list (target_list, &n_targets);
 
-                gtk_clipboard_set_with_data (clipboard,
-                                             target_table, n_targets,
-                                             (GtkClipboardGetFunc)clipboard_get_cb,
-                                             (GtkClipboardClearFunc)clipboard_clear_cb,
-                                             data);
+                if ( gtk_clipboard_set_with_data (clipboard,
+                                                  target_table, n_targets,
+                                                  (GtkClipboardGetFunc)clipboard_get_cb,
+                                                  (GtkClipboardClearFunc)clipboard_clear_cb,
+                                                  data) )
+                {
+                        clipboard_data = data;
+                }
+                else
+                {
+                        clipboard_clear_cb (clipboard, data);
+                }
 
                 gtk_target_table_free (target_table, n_targets);
                 gtk_target_list_unref (target_list);
@@ -2626,6 +3210,15 @@ gl_label_paste (glLabel       *label)
 
 	g_return_if_fail (label && GL_IS_LABEL (label));
 
+        if ( clipboard_data )
+        {
+                /* We own the clipboard, paste our snapshot directly. */
+                paste_objects (label, clipboard_data->label_copy);
+
+                gl_debug (DEBUG_LABEL, "END (in-process)");
+                return;
+        }
+
         clipboard = gtk_clipboard_get (GDK_SELECTION_CLIPBOARD);
 
         gtk_clipboard_request_targets (clipboard,
@@ -2647,6 +3240,12 @@ gl_label_can_paste (glLabel       *label)
 
 	gl_debug (DEBUG_LABEL, "START");
 
+        if ( clipboard_data )
+        {
+                gl_debug (DEBUG_LABEL, "END (in-process)");
+                return TRUE;
+        }
+
         clipboard = gtk_clipboard_get (GDK_SELECTION_CLIPBOARD);
 
         can_flag = gtk_clipboard_wait_is_target_available (clipboard,
@@ -2668,12 +3267,18 @@ clipboard_get_cb (GtkClipboard     *clipboard,
                   guint             info,
                   ClipboardData    *data)
 {
+        glXMLLabelStatus   status;
+
 	gl_debug (DEBUG_LABEL, "START");
 
         switch (info)
         {
 
         case 0:
+                if ( !data->xml_buffer )
+                {
+                        data->xml_buffer = gl_xml_label_save_buffer (data->label_copy, &status);
+                }
                 gtk_selection_data_set (selection_data,
                                         gtk_selection_data_get_target (selection_data),
                                         8,
@@ -2707,6 +3312,12 @@ clipboard_clear_cb (GtkClipboard     *clipboard,
 {
 	gl_debug (DEBUG_LABEL, "START");
 
+        if ( data == clipboard_data )
+        {
+                clipboard_data = NULL;
+        }
+
+        g_object_unref (G_OBJECT (data->label_copy));
         g_free (data->xml_buffer);
         g_free (data->text);
         if (data->pixbuf)
@@ -2781,13 +3392,9 @@ paste_xml_received_cb (GtkClipboard     *clipboard,
         gchar            *xml_buffer;
         glLabel          *label_copy;
         glXMLLabelStatus  status;
-        GList            *p;
-        glLabelObject    *object, *newobject;
 
 	gl_debug (DEBUG_LABEL, "START");
 
-        gl_label_checkpoint (label, _("Paste"));
-
         xml_buffer = (gchar *)gtk_selection_data_get_data (selection_data);
 
         /*
@@ -2796,23 +3403,43 @@ paste_xml_received_cb (GtkClipboard     *clipboard,
         label_copy = gl_xml_label_open_buffer (xml_buffer, &status);
         if ( label_copy )
         {
-                gl_label_unselect_all (label);
+                paste_objects (label, label_copy);
 
-                for (p = label_copy->priv->object_list; p != NULL; p = p->next)
-                {
-                        object = (glLabelObject *) p->data;
-                        newobject = gl_label_object_dup (object, label);
-                        gl_label_add_object( label, newobject );
+                g_object_unref (G_OBJECT (label_copy));
+        }
 
-                        gl_label_select_object (label, newobject);
+	gl_debug (DEBUG_LABEL, "END");
+}
 
-                        gl_debug (DEBUG_LABEL, "object pasted");
-                }
 
-                g_object_unref (G_OBJECT (label_copy));
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Paste copies of all objects of label_copy, and select them.     */
+/*---------------------------------------------------------------------------*/
+static void
+paste_objects (glLabel          *label,
+               glLabel          *label_copy)
+{
+        GList            *p;
+        glLabelObject    *object, *newobject;
+
+        gl_label_checkpoint (label, _("Paste"));
+
+        gl_label_unselect_all (label);
+
+        gl_label_begin_batch (label);
+
+        for (p = label_copy->priv->object_list; p != NULL; p = p->next)
+        {
+                object = (glLabelObject *) p->data;
+                newobject = gl_label_object_dup (object, label);
+                gl_label_add_object( label, newobject );
+
+                gl_label_select_object (label, newobject);
+
+                gl_debug (DEBUG_LABEL, "object pasted");
         }
 
-	gl_debug (DEBUG_LABEL, "END");
+        gl_label_end_batch (label);
 }
 
 
@@ -3238,18 +3865,89 @@ gl_label_draw (glLabel       *label,
                cairo_t       *cr,
                gboolean       screen_flag,
                glMergeRecord *record)
+{
+	g_return_if_fail (label && GL_IS_LABEL (label));
+
+        gl_label_draw_region (label, cr, screen_flag, record, NULL);
+}
+
+
+/****************************************************************************/
+/* Draw only objects intersecting region (entire label if region is NULL).  */
+/****************************************************************************/
+void
+gl_label_draw_region (glLabel             *label,
+                      cairo_t             *cr,
+                      gboolean             screen_flag,
+                      glMergeRecord       *record,
+                      const glLabelRegion *region)
 {
 	GList            *p_obj;
+        GList            *candidates;
 	glLabelObject    *object;
 
 	g_return_if_fail (label && GL_IS_LABEL (label));
 
-	for (p_obj = label->priv->object_list; p_obj != NULL; p_obj = p_obj->next)
+        GL_TRACE_BEGIN ("gl_label_draw");
+
+        if ( region == NULL )
         {
-		object = GL_LABEL_OBJECT (p_obj->data);
+                for (p_obj = label->priv->object_list; p_obj != NULL; p_obj = p_obj->next)
+                {
+                        object = GL_LABEL_OBJECT (p_obj->data);
 
-                gl_label_object_draw (object, cr, screen_flag, record);
-	}
+                        gl_label_object_draw (object, cr, screen_flag, record);
+                }
+        }
+        else
+        {
+                /* Candidates are front most first, draw back to front. */
+                candidates = g_list_reverse (index_query (label, region));
+
+                for (p_obj = candidates; p_obj != NULL; p_obj = p_obj->next)
+                {
+                        object = GL_LABEL_OBJECT (p_obj->data);
+
+                        gl_label_object_draw (object, cr, screen_flag, record);
+                }
+
+                g_list_free (candidates);
+        }
+
+        GL_TRACE_END ("gl_label_draw");
+}
+
+
+/****************************************************************************/
+/* Take region damaged since last call.  Returns FALSE if the entire label  */
+/* must be redrawn instead.  If nothing has been damaged, the region is     */
+/* empty (x2 < x1).                                                         */
+/****************************************************************************/
+gboolean
+gl_label_take_damage (glLabel       *label,
+                      glLabelRegion *region)
+{
+        gboolean partial_flag;
+
+	g_return_val_if_fail (label && GL_IS_LABEL (label), FALSE);
+
+        if ( !label->priv->damage_flag && !label->priv->damage_all_flag )
+        {
+                region->x1 = region->y1 = 0.0;
+                region->x2 = region->y2 = -1.0;
+                return TRUE;
+        }
+
+        partial_flag = label->priv->damage_flag && !label->priv->damage_all_flag;
+        if ( partial_flag )
+        {
+                *region = label->priv->damage;
+        }
+
+        label->priv->damage_flag     = FALSE;
+        label->priv->damage_all_flag = FALSE;
+
+        return partial_flag;
 }
 
 
@@ -3261,23 +3959,29 @@ glLabelObject *gl_label_object_at              (glLabel       *label,
                                                 gdouble        x_pixels,
                                                 gdouble        y_pixels)
 {
+        glLabelRegion     hit_region;
+        GList            *candidates;
 	GList            *p_obj;
-	glLabelObject    *object;
+	glLabelObject    *object = NULL;
 
 	g_return_val_if_fail (label && GL_IS_LABEL (label), NULL);
 
-	for (p_obj = g_list_last (label->priv->object_list); p_obj != NULL; p_obj = p_obj->prev)
-        {
-		object = GL_LABEL_OBJECT (p_obj->data);
+        /* Only objects near the point can be hit, no need to test the rest. */
+        get_hit_region (cr, x_pixels, y_pixels, &hit_region);
+        candidates = index_query (label, &hit_region);
 
-                if (gl_label_object_is_located_at (object, cr, x_pixels, y_pixels))
+	for (p_obj = candidates; p_obj != NULL; p_obj = p_obj->next)
+        {
+                if (gl_label_object_is_located_at (GL_LABEL_OBJECT (p_obj->data), cr, x_pixels, y_pixels))
                 {
-                        return object;
+                        object = GL_LABEL_OBJECT (p_obj->data);
+                        break;
                 }
-
 	}
 
-        return NULL;
+        g_list_free (candidates);
+
+        return object;
 }
 
 
@@ -3291,28 +3995,31 @@ gl_label_get_handle_at (glLabel             *label,
                         gdouble              y_pixels,
                         glLabelObjectHandle *handle)
 {
-        GList            *selection_list;
+        glLabelRegion     hit_region;
+        GList            *candidates;
 	GList            *p_obj;
 	glLabelObject    *object;
 
 	g_return_val_if_fail (label && GL_IS_LABEL (label), NULL);
 
-        selection_list = gl_label_get_selection_list (label);
+        get_hit_region (cr, x_pixels, y_pixels, &hit_region);
+        candidates = index_query (label, &hit_region);
 
-	for (p_obj = g_list_last (selection_list); p_obj != NULL; p_obj = p_obj->prev)
+	for (p_obj = candidates; p_obj != NULL; p_obj = p_obj->next)
         {
 
 		object = GL_LABEL_OBJECT (p_obj->data);
 
-                if ((*handle = gl_label_object_handle_at (object, cr, x_pixels, y_pixels)))
+                if ( gl_label_object_is_selected (object) &&
+                     (*handle = gl_label_object_handle_at (object, cr, x_pixels, y_pixels)) )
                 {
-                        g_list_free (selection_list);
+                        g_list_free (candidates);
                         return object;
                 }
 
 	}
 
-        g_list_free (selection_list);
+        g_list_free (candidates);
 
         *handle = GL_LABEL_OBJECT_HANDLE_NONE;
         return NULL;
@@ -3535,6 +4242,7 @@ state_new (glLabel       *this,
         State          *state;
         GList          *p_obj;
         glLabelObject  *object;
+        gint            i;
 
 	gl_debug (DEBUG_LABEL, "START");
 
@@ -3545,15 +4253,21 @@ state_new (glLabel       *this,
         state->template    = lgl_template_dup (this->priv->template);
         state->rotate_flag = this->priv->rotate_flag;
 
-        for ( p_obj = this->priv->object_list; p_obj != NULL; p_obj = p_obj->next )
+        state->selected_flags = g_new (gboolean, g_list_length (this->priv->object_list));
+        for ( p_obj = this->priv->object_list, i = 0; p_obj != NULL; p_obj = p_obj->next, i++ )
         {
                 object = GL_LABEL_OBJECT (p_obj->data);
 
-                state->object_list = g_list_append (state->object_list,
-                                                    gl_label_object_dup (object, this));
+                state->object_list = g_list_prepend (state->object_list,
+                                                     gl_label_object_get_snapshot (object));
+                state->selected_flags[i] = gl_label_object_is_selected (object);
         }
+        state->object_list = g_list_reverse (state->object_list);
 
-        state->merge = gl_merge_dup (this->priv->merge);
+        if ( this->priv->merge )
+        {
+                state->merge = g_object_ref (this->priv->merge);
+        }
 
         state->modified_flag = this->priv->modified_flag;
         state->time_stamp    = this->priv->time_stamp;
@@ -3587,6 +4301,7 @@ state_free (State   *state)
                 g_object_unref (G_OBJECT (p_obj->data));
         }
         g_list_free (state->object_list);
+        g_free (state->selected_flags);
 
         g_free (state);
 
@@ -3604,12 +4319,15 @@ state_restore (State   *state,
 {
         GList          *p_obj, *p_next;
         glLabelObject  *object;
+        gint            i;
 
 	gl_debug (DEBUG_LABEL, "START");
 
         gl_label_set_rotate_flag (this, state->rotate_flag, FALSE);
         gl_label_set_template (this, state->template, FALSE);
 
+        gl_label_begin_batch (this);
+
         for ( p_obj = this->priv->object_list; p_obj != NULL; p_obj = p_next )
         {
                 p_next = p_obj->next; /* Hold on to next; delete is destructive */
@@ -3618,16 +4336,39 @@ state_restore (State   *state,
                 gl_label_delete_object (this, object);
         }
 
-        for ( p_obj = state->object_list; p_obj != NULL; p_obj = p_obj->next )
+        for ( p_obj = state->object_list, i = 0; p_obj != NULL; p_obj = p_obj->next, i++ )
         {
-                object = GL_LABEL_OBJECT (p_obj->data);
+                object = gl_label_object_dup (GL_LABEL_OBJECT (p_obj->data), this);
+
+                if ( state->selected_flags[i] )
+                {
+                        gl_label_object_select (object);
+                }
+                else
+                {
+                        gl_label_object_unselect (object);
+                }
 
-                gl_label_add_object (this, gl_label_object_dup (object, this));
+                gl_label_add_object (this, object);
         }
+
+        gl_label_end_batch (this);
+
 	g_signal_emit (G_OBJECT(this), signals[SELECTION_CHANGED], 0);
 
-        gl_label_set_merge (this, state->merge, FALSE);
-        
+        if ( state->merge )
+        {
+                g_object_ref (state->merge);
+        }
+	if ( this->priv->merge != NULL )
+        {
+		g_object_unref (G_OBJECT(this->priv->merge));
+	}
+        this->priv->merge = state->merge;
+
+        do_modify (this);
+	g_signal_emit (G_OBJECT(this), signals[MERGE_CHANGED], 0);
+
 
         if ( !state->modified_flag &&
              (state->time_stamp.tv_sec  == this->priv->time_stamp.tv_sec) &&
@@ -84,6 +84,8 @@ GType         gl_label_get_type                (void) G_GNUC_CONST;
 
 GObject      *gl_label_new                     (void);
 
+glLabel      *gl_label_dup                     (glLabel       *label);
+
 
 void          gl_label_set_filename            (glLabel       *label,
 						const gchar   *filename);
@@ -148,6 +150,18 @@ void          gl_label_delete_object           (glLabel       *label,
 const GList  *gl_label_get_object_list         (glLabel       *label);
 
 
+/*
+ * Batch methods, coalesce object and label signals of multi-object operations
+ */
+void          gl_label_begin_batch             (glLabel       *label);
+
+void          gl_label_end_batch               (glLabel       *label);
+
+gboolean      gl_label_defer_object_notify     (glLabel       *label,
+                                                glLabelObject *object,
+                                                gboolean       moved_flag);
+
+
 
 /*
  * Modify selection methods
@@ -339,6 +353,15 @@ void           gl_label_draw                   (glLabel       *label,
                                                 gboolean       screen_flag,
                                                 glMergeRecord *record);
 
+void           gl_label_draw_region            (glLabel             *label,
+                                                cairo_t             *cr,
+                                                gboolean             screen_flag,
+                                                glMergeRecord       *record,
+                                                const glLabelRegion *region);
+
+gboolean       gl_label_take_damage            (glLabel       *label,
+                                                glLabelRegion *region);
+
 glLabelObject *gl_label_object_at              (glLabel       *label,
                                                 cairo_t       *cr,
                                                 gdouble        x_pixels,
@@ -49,7 +49,6 @@
 
 enum {
 	NAME_COLUMN,
-	PREVIEW_COLUMN,
 	PREVIEW_COLUMN_STOCK,
 	PREVIEW_COLUMN_STOCK_SIZE,
 	DESCRIPTION_COLUMN,
@@ -141,6 +140,17 @@ static void   page_changed_cb            (GtkNotebook            *notebook,
 
 static void   db_changed_cb              (glMediaSelect          *this);
 
+static GtkTreeViewColumn *create_preview_column (glMediaSelect   *this);
+
+static void   preview_cell_data_func     (GtkTreeViewColumn      *column,
+                                          GtkCellRenderer        *renderer,
+                                          GtkTreeModel           *model,
+                                          GtkTreeIter            *iter,
+                                          gpointer                user_data);
+
+static void   preview_ready_cb           (GdkPixbuf              *pixbuf,
+                                          gpointer                user_data);
+
 static void   load_recent_list           (glMediaSelect          *this,
                                           GtkListStore           *store,
                                           GtkTreeSelection       *selection,
@@ -213,6 +223,8 @@ gl_media_select_finalize (GObject *object)
                 lgl_db_notify_remove (this->priv->db_notify_id);
         }
 
+        gl_mini_preview_pixbuf_cache_cancel (preview_ready_cb, this);
+
         if (this->priv->builder)
         {
                 g_object_unref (this->priv->builder);
@@ -329,16 +341,10 @@ gl_media_select_construct (glMediaSelect *this)
         gtk_widget_show_all (GTK_WIDGET (this));
 
         /* Recent templates treeview */
-        this->priv->recent_store = gtk_list_store_new (N_COLUMNS, G_TYPE_STRING, GDK_TYPE_PIXBUF, G_TYPE_STRING, G_TYPE_UINT, G_TYPE_STRING);
+        this->priv->recent_store = gtk_list_store_new (N_COLUMNS, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_UINT, G_TYPE_STRING);
         gtk_tree_view_set_model (GTK_TREE_VIEW (this->priv->recent_treeview),
                                  GTK_TREE_MODEL (this->priv->recent_store));
-        renderer = gtk_cell_renderer_pixbuf_new ();
-        column = gtk_tree_view_column_new_with_attributes ("", renderer,
-                                                           "pixbuf", PREVIEW_COLUMN,
-                                                           "stock-id", PREVIEW_COLUMN_STOCK,
-                                                           "stock-size", PREVIEW_COLUMN_STOCK_SIZE,
-                                                           NULL);
-        gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_AUTOSIZE);
+        column = create_preview_column (this);
         gtk_tree_view_append_column (GTK_TREE_VIEW (this->priv->recent_treeview), column);
         renderer = gtk_cell_renderer_text_new ();
         column = gtk_tree_view_column_new_with_attributes ("", renderer,
@@ -375,16 +381,10 @@ gl_media_select_construct (glMediaSelect *this)
         gl_combo_util_set_active_text (GTK_COMBO_BOX (this->priv->category_combo), C_("Category", "Any"));
 
         /* Search all treeview */
-        this->priv->search_all_store = gtk_list_store_new (N_COLUMNS, G_TYPE_STRING, GDK_TYPE_PIXBUF, G_TYPE_STRING, G_TYPE_UINT, G_TYPE_STRING);
+        this->priv->search_all_store = gtk_list_store_new (N_COLUMNS, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_UINT, G_TYPE_STRING);
         gtk_tree_view_set_model (GTK_TREE_VIEW (this->priv->search_all_treeview),
                                  GTK_TREE_MODEL (this->priv->search_all_store));
-        renderer = gtk_cell_renderer_pixbuf_new ();
-        column = gtk_tree_view_column_new_with_attributes ("", renderer,
-                                                           "pixbuf", PREVIEW_COLUMN,
-                                                           "stock-id", PREVIEW_COLUMN_STOCK,
-                                                           "stock-size", PREVIEW_COLUMN_STOCK_SIZE,
-                                                           NULL);
-        gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_AUTOSIZE);
+        column = create_preview_column (this);
         gtk_tree_view_append_column (GTK_TREE_VIEW (this->priv->search_all_treeview), column);
         renderer = gtk_cell_renderer_text_new ();
         column = gtk_tree_view_column_new_with_attributes ("", renderer,
@@ -398,16 +398,10 @@ gl_media_select_construct (glMediaSelect *this)
         lgl_db_free_template_name_list (search_all_names);
 
         /* Custom templates treeview */
-        this->priv->custom_store = gtk_list_store_new (N_COLUMNS, G_TYPE_STRING, GDK_TYPE_PIXBUF, G_TYPE_STRING, G_TYPE_UINT, G_TYPE_STRING);
+        this->priv->custom_store = gtk_list_store_new (N_COLUMNS, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_UINT, G_TYPE_STRING);
         gtk_tree_view_set_model (GTK_TREE_VIEW (this->priv->custom_treeview),
                                  GTK_TREE_MODEL (this->priv->custom_store));
-        renderer = gtk_cell_renderer_pixbuf_new ();
-        column = gtk_tree_view_column_new_with_attributes ("", renderer,
-                                                           "pixbuf", PREVIEW_COLUMN,
-                                                           "stock-id", PREVIEW_COLUMN_STOCK,
-                                                           "stock-size", PREVIEW_COLUMN_STOCK_SIZE,
-                                                           NULL);
-        gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_AUTOSIZE);
+        column = create_preview_column (this);
         gtk_tree_view_append_column (GTK_TREE_VIEW (this->priv->custom_treeview), column);
         renderer = gtk_cell_renderer_text_new ();
         column = gtk_tree_view_column_new_with_attributes ("", renderer,
@@ -912,6 +906,93 @@ gl_media_select_set_filter_parameters (glMediaSelect  *this,
 }
 
 
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  Create preview column for template treeviews.                  */
+/*--------------------------------------------------------------------------*/
+static GtkTreeViewColumn *
+create_preview_column (glMediaSelect *this)
+{
+        GtkCellRenderer   *renderer;
+        GtkTreeViewColumn *column;
+        gint               xpad, ypad;
+
+        renderer = gtk_cell_renderer_pixbuf_new ();
+
+        /* Previews arrive asynchronously, so reserve their space up front. */
+        gtk_cell_renderer_get_padding (renderer, &xpad, &ypad);
+        gtk_cell_renderer_set_fixed_size (renderer, 72 + 2*xpad, 72 + 2*ypad);
+
+        column = gtk_tree_view_column_new_with_attributes ("", renderer,
+                                                           "stock-id", PREVIEW_COLUMN_STOCK,
+                                                           "stock-size", PREVIEW_COLUMN_STOCK_SIZE,
+                                                           NULL);
+        gtk_tree_view_column_set_cell_data_func (column, renderer,
+                                                 preview_cell_data_func, this, NULL);
+        gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_AUTOSIZE);
+
+        return column;
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  Fetch preview pixbuf for a row, only once it is on screen.     */
+/*--------------------------------------------------------------------------*/
+static void
+preview_cell_data_func (GtkTreeViewColumn *column,
+                        GtkCellRenderer   *renderer,
+                        GtkTreeModel      *model,
+                        GtkTreeIter       *iter,
+                        gpointer           user_data)
+{
+        glMediaSelect *this = GL_MEDIA_SELECT (user_data);
+        GtkWidget     *treeview;
+        GtkTreePath   *path, *start_path, *end_path;
+        gchar         *name;
+        GdkPixbuf     *pixbuf = NULL;
+
+        treeview = gtk_tree_view_column_get_tree_view (column);
+
+        /* The treeview also runs this function while measuring rows that are
+         * off screen; those must not trigger any rendering. */
+        if ( gtk_tree_view_get_visible_range (GTK_TREE_VIEW (treeview), &start_path, &end_path) )
+        {
+                path = gtk_tree_model_get_path (model, iter);
+
+                if ( (gtk_tree_path_compare (path, start_path) >= 0) &&
+                     (gtk_tree_path_compare (path, end_path) <= 0) )
+                {
+                        gtk_tree_model_get (model, iter, NAME_COLUMN, &name, -1);
+                        pixbuf = gl_mini_preview_pixbuf_cache_lookup (name, preview_ready_cb, this);
+                        g_free (name);
+                }
+
+                gtk_tree_path_free (path);
+                gtk_tree_path_free (start_path);
+                gtk_tree_path_free (end_path);
+        }
+
+        g_object_set (renderer, "pixbuf", pixbuf, NULL);
+
+        if ( pixbuf )
+        {
+                g_object_unref (pixbuf);
+        }
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  A requested preview has been rendered.                         */
+/*--------------------------------------------------------------------------*/
+static void
+preview_ready_cb (GdkPixbuf *pixbuf,
+                  gpointer   user_data)
+{
+        glMediaSelect *this = GL_MEDIA_SELECT (user_data);
+
+        gtk_widget_queue_draw (GTK_WIDGET (this));
+}
+
+
 /*--------------------------------------------------------------------------*/
 /* PRIVATE.  Load list store from template name list.                       */
 /*--------------------------------------------------------------------------*/
@@ -926,7 +1007,6 @@ load_recent_list (glMediaSelect      *this,
         lglUnits          units;
         lglTemplate      *template;
         lglTemplateFrame *frame;
-        GdkPixbuf        *pixbuf;
         gchar            *size;
         gchar            *layout;
         gchar            *description;
@@ -955,7 +1035,6 @@ load_recent_list (glMediaSelect      *this,
 
                         template = lgl_db_lookup_template_from_name (p->data);
                         frame    = (lglTemplateFrame *)template->frames->data;
-                        pixbuf   = gl_mini_preview_pixbuf_cache_get_pixbuf (p->data);
 
                         size     = lgl_template_frame_get_size_description (frame, units);
                         layout   = lgl_template_frame_get_layout_description (frame);
@@ -972,11 +1051,9 @@ load_recent_list (glMediaSelect      *this,
                         gtk_list_store_append (store, &iter);
                         gtk_list_store_set (store, &iter,
                                             NAME_COLUMN, p->data,
-                                            PREVIEW_COLUMN, pixbuf,
                                             DESCRIPTION_COLUMN, description,
                                             -1);
 
-                        g_object_unref (G_OBJECT (pixbuf));
                         g_free (description);
                 }
 
@@ -1019,7 +1096,6 @@ load_search_all_list (glMediaSelect      *this,
         lglUnits          units;
         lglTemplate      *template;
         lglTemplateFrame *frame;
-        GdkPixbuf        *pixbuf;
         gchar            *size;
         gchar            *layout;
         gchar            *description;
@@ -1047,7 +1123,6 @@ load_search_all_list (glMediaSelect      *this,
 
                         template = lgl_db_lookup_template_from_name (p->data);
                         frame    = (lglTemplateFrame *)template->frames->data;
-                        pixbuf   = gl_mini_preview_pixbuf_cache_get_pixbuf (p->data);
 
                         size     = lgl_template_frame_get_size_description (frame, units);
                         layout   = lgl_template_frame_get_layout_description (frame);
@@ -1064,11 +1139,9 @@ load_search_all_list (glMediaSelect      *this,
                         gtk_list_store_append (store, &iter);
                         gtk_list_store_set (store, &iter,
                                             NAME_COLUMN, p->data,
-                                            PREVIEW_COLUMN, pixbuf,
                                             DESCRIPTION_COLUMN, description,
                                             -1);
 
-                        g_object_unref (G_OBJECT (pixbuf));
                         g_free (description);
                 }
 
@@ -1112,7 +1185,6 @@ load_custom_list (glMediaSelect      *this,
         lglUnits          units;
         lglTemplate      *template;
         lglTemplateFrame *frame;
-        GdkPixbuf        *pixbuf;
         gchar            *size;
         gchar            *layout;
         gchar            *description;
@@ -1141,7 +1213,6 @@ load_custom_list (glMediaSelect      *this,
 
                         template = lgl_db_lookup_template_from_name (p->data);
                         frame    = (lglTemplateFrame *)template->frames->data;
-                        pixbuf   = gl_mini_preview_pixbuf_cache_get_pixbuf (p->data);
 
                         size     = lgl_template_frame_get_size_description (frame, units);
                         layout   = lgl_template_frame_get_layout_description (frame);
@@ -1158,11 +1229,9 @@ load_custom_list (glMediaSelect      *this,
                         gtk_list_store_append (store, &iter);
                         gtk_list_store_set (store, &iter,
                                             NAME_COLUMN, p->data,
-                                            PREVIEW_COLUMN, pixbuf,
                                             DESCRIPTION_COLUMN, description,
                                             -1);
 
-                        g_object_unref (G_OBJECT (pixbuf));
                         g_free (description);
                 }
 
@@ -486,7 +486,6 @@ gl_merge_evolution_get_record (glMerge *merge)
         contact = E_CONTACT(head->data);
 
         record = g_new0 (glMergeRecord, 1);
-        record->select_flag = TRUE;
 
         /* Take the interesting fields one by one from the contact, and put them
          * into the glMergeRecord structure. When done, free up the resources for
@@ -28,6 +28,7 @@
 
 #include "label.h"
 #include "merge.h"
+#include "merge-record-model.h"
 #include "combo-util.h"
 #include "builder-util.h"
 
@@ -50,8 +51,9 @@ struct _glMergePropertiesDialogPrivate {
 	GtkWidget    *location_vbox;
 	GtkWidget    *src_entry;
 
-	GtkTreeStore *store;
+	glMergeRecordModel *model;
 	GtkWidget    *treeview;
+	GtkWidget    *search_entry;
 
 	GtkWidget    *select_all_button;
 	GtkWidget    *unselect_all_button;
@@ -62,18 +64,11 @@ struct _glMergePropertiesDialogPrivate {
 
 };
 
-enum {
-	/* Real columns */
-	SELECT_COLUMN,
-	RECORD_FIELD_COLUMN,
-	VALUE_COLUMN,
-
-	/* Invisible columns */
-	IS_RECORD_COLUMN,
-	DATA_COLUMN, /* points to glMergeRecord */
-
-	N_COLUMNS
-};
+/* Fixed row heights and column widths keep the tree view from measuring
+ * every record of large merge sources. */
+#define SELECT_COLUMN_WIDTH        60
+#define RECORD_FIELD_COLUMN_WIDTH  160
+#define VALUE_COLUMN_WIDTH         240
 
 
 /*===========================================*/
@@ -100,12 +95,14 @@ static void response_cb                           (glMergePropertiesDialog
 					           gint                          response,
 						   gpointer                      user_data);
 
-static void load_tree                             (GtkTreeStore                 *store,
-					           glMerge                      *merge);
+static void load_tree                             (glMergePropertiesDialog      *dialog);
 
 static void record_select_toggled_cb              (GtkCellRendererToggle        *cell,
 						   gchar                        *path_str,
-						   GtkTreeStore                 *store);
+						   glMergePropertiesDialog      *dialog);
+
+static void search_changed_cb                     (GtkSearchEntry               *entry,
+						   glMergePropertiesDialog      *dialog);
 
 static void select_all_button_clicked_cb          (GtkWidget                    *widget,
 						   glMergePropertiesDialog      *dialog);
@@ -179,6 +176,7 @@ gl_merge_properties_dialog_init (glMergePropertiesDialog *dialog)
                                      "treeview",              &dialog->priv->treeview,
                                      "select_all_button",     &dialog->priv->select_all_button,
                                      "unselect_all_button",   &dialog->priv->unselect_all_button,
+                                     "search_entry",          &dialog->priv->search_entry,
                                      NULL);
 
 	gtk_container_add (GTK_CONTAINER (vbox), merge_properties_vbox);
@@ -206,6 +204,9 @@ gl_merge_properties_dialog_finalize (GObject *object)
 	g_return_if_fail (GL_IS_MERGE_PROPERTIES_DIALOG (dialog));
 	g_return_if_fail (dialog->priv != NULL);
 
+	if (dialog->priv->model != NULL) {
+		g_object_unref (G_OBJECT (dialog->priv->model));
+	}
 	if (dialog->priv->merge != NULL) {
 		g_object_unref (G_OBJECT (dialog->priv->merge));
 	}
@@ -320,44 +321,54 @@ gl_merge_properties_dialog_construct (glMergePropertiesDialog *dialog,
 			    dialog->priv->src_entry, FALSE, FALSE, 0);
 	gtk_widget_show_all (GTK_WIDGET (dialog->priv->location_vbox));
 
-	dialog->priv->store = gtk_tree_store_new (N_COLUMNS,
-					  G_TYPE_BOOLEAN, /* Record selector */
-					  G_TYPE_STRING,  /* Record/Field name */
-					  G_TYPE_STRING,  /* Field value */
-					  G_TYPE_BOOLEAN, /* Is Record? */
-					  G_TYPE_POINTER  /* Pointer to record */);
-	load_tree (dialog->priv->store, dialog->priv->merge);
-
-	gtk_tree_view_set_model (GTK_TREE_VIEW (dialog->priv->treeview),
-				 GTK_TREE_MODEL (dialog->priv->store));
-
 	gtk_tree_view_set_rules_hint (GTK_TREE_VIEW (dialog->priv->treeview),
 				      TRUE);
 	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (dialog->priv->treeview));
 	gtk_tree_selection_set_mode (selection, GTK_SELECTION_NONE);
 	renderer = gtk_cell_renderer_toggle_new ();
 	g_signal_connect (G_OBJECT (renderer), "toggled",
-			  G_CALLBACK (record_select_toggled_cb), dialog->priv->store);
+			  G_CALLBACK (record_select_toggled_cb), dialog);
 	column = gtk_tree_view_column_new_with_attributes (_("Select"), renderer,
-							   "active", SELECT_COLUMN,
-							   "visible", IS_RECORD_COLUMN,
+							   "active", GL_MERGE_RECORD_MODEL_SELECT_COLUMN,
+							   "visible", GL_MERGE_RECORD_MODEL_IS_RECORD_COLUMN,
 							   NULL);
+	gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_FIXED);
+	gtk_tree_view_column_set_fixed_width (column, SELECT_COLUMN_WIDTH);
 	gtk_tree_view_append_column (GTK_TREE_VIEW (dialog->priv->treeview), column);
 	renderer = gtk_cell_renderer_text_new ();
-	g_object_set (G_OBJECT (renderer), "yalign", 0.0, NULL);
+	g_object_set (G_OBJECT (renderer),
+		      "yalign", 0.0,
+		      "single-paragraph-mode", TRUE,
+		      "ellipsize", PANGO_ELLIPSIZE_END,
+		      NULL);
 	column = gtk_tree_view_column_new_with_attributes (_("Record/Field"), renderer,
-							   "text", RECORD_FIELD_COLUMN,
+							   "text", GL_MERGE_RECORD_MODEL_RECORD_FIELD_COLUMN,
 							   NULL);
-	gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_AUTOSIZE);
+	gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_FIXED);
+	gtk_tree_view_column_set_fixed_width (column, RECORD_FIELD_COLUMN_WIDTH);
+	gtk_tree_view_column_set_resizable (column, TRUE);
 	gtk_tree_view_append_column (GTK_TREE_VIEW (dialog->priv->treeview), column);
 	gtk_tree_view_set_expander_column (GTK_TREE_VIEW (dialog->priv->treeview), column);
 	renderer = gtk_cell_renderer_text_new ();
-	g_object_set (G_OBJECT (renderer), "yalign", 0.0, NULL);
+	g_object_set (G_OBJECT (renderer),
+		      "yalign", 0.0,
+		      "single-paragraph-mode", TRUE,
+		      "ellipsize", PANGO_ELLIPSIZE_END,
+		      NULL);
 	column = gtk_tree_view_column_new_with_attributes (_("Data"), renderer,
-							   "text", VALUE_COLUMN,
+							   "text", GL_MERGE_RECORD_MODEL_VALUE_COLUMN,
 							   NULL);
-	gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_AUTOSIZE);
+	gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_FIXED);
+	gtk_tree_view_column_set_fixed_width (column, VALUE_COLUMN_WIDTH);
+	gtk_tree_view_column_set_resizable (column, TRUE);
 	gtk_tree_view_append_column (GTK_TREE_VIEW (dialog->priv->treeview), column);
+	gtk_tree_view_set_fixed_height_mode (GTK_TREE_VIEW (dialog->priv->treeview), TRUE);
+
+	load_tree (dialog);
+
+	g_signal_connect (G_OBJECT (dialog->priv->search_entry),
+			  "search-changed",
+			  G_CALLBACK (search_changed_cb), dialog);
 
 	g_signal_connect (G_OBJECT (dialog->priv->select_all_button),
 			  "clicked",
@@ -451,7 +462,7 @@ type_changed_cb (GtkWidget               *widget,
 			    dialog->priv->src_entry, FALSE, FALSE, 0);
 	gtk_widget_show_all (dialog->priv->location_vbox);
 
-	load_tree (dialog->priv->store, dialog->priv->merge);
+	load_tree (dialog);
 
 	g_free (description);
 	g_free (name);
@@ -480,8 +491,11 @@ src_changed_cb (GtkWidget               *widget,
 	    ((orig_src != NULL) && (src == NULL)) ||
 	    ((orig_src != NULL) && (src != NULL) && strcmp (src, orig_src)))
 	{
+		/* Records are replaced in place, don't let the view see them go. */
+		gtk_tree_view_set_model (GTK_TREE_VIEW (dialog->priv->treeview), NULL);
+
 		gl_merge_set_src (dialog->priv->merge, src);
-		load_tree (dialog->priv->store, dialog->priv->merge);
+		load_tree (dialog);
 	}
 
 	g_free (orig_src);
@@ -524,55 +538,48 @@ response_cb (glMergePropertiesDialog *dialog,
 
 
 /*--------------------------------------------------------------------------*/
-/* PRIVATE.  Load tree store from merge data.                               */
+/* PRIVATE.  Load tree view from merge data.  The model reads records in     */
+/* place, so this is cheap even for very large merge sources.                */
 /*--------------------------------------------------------------------------*/
 static void
-load_tree (GtkTreeStore           *store,
-	   glMerge                *merge)
+load_tree (glMergePropertiesDialog *dialog)
 {
-	const GList   *record_list;
-	GList         *p_rec, *p_field;
-	glMergeRecord *record;
-	glMergeField  *field;
-	GtkTreeIter    iter1, iter2;
-	gchar         *primary_key;
-	gchar         *primary_value;
-
 	gl_debug (DEBUG_MERGE, "START");
 
-	gtk_tree_store_clear (store);
+	gtk_tree_view_set_model (GTK_TREE_VIEW (dialog->priv->treeview), NULL);
 
-	primary_key = gl_merge_get_primary_key (merge);
-	record_list = gl_merge_get_record_list (merge);
+	if (dialog->priv->model != NULL) {
+		g_object_unref (G_OBJECT (dialog->priv->model));
+	}
+	dialog->priv->model = gl_merge_record_model_new (dialog->priv->merge);
 
-	for ( p_rec=(GList *)record_list; p_rec!=NULL; p_rec=p_rec->next ) {
-		record = (glMergeRecord *)p_rec->data;
-		
-		primary_value = gl_merge_eval_key (record, primary_key);
+	gl_merge_record_model_set_filter (dialog->priv->model,
+					  gtk_entry_get_text (GTK_ENTRY (dialog->priv->search_entry)));
 
-		gtk_tree_store_append (store, &iter1, NULL);
-		gtk_tree_store_set (store, &iter1,
-				    SELECT_COLUMN,       record->select_flag,
-				    RECORD_FIELD_COLUMN, primary_value,
-				    IS_RECORD_COLUMN,    TRUE,
-				    DATA_COLUMN,         record,
-				    -1);
+	gtk_tree_view_set_model (GTK_TREE_VIEW (dialog->priv->treeview),
+				 GTK_TREE_MODEL (dialog->priv->model));
 
-		g_free (primary_value);
+	gl_debug (DEBUG_MERGE, "END");
+}
 
-		for ( p_field=record->field_list; p_field!=NULL; p_field=p_field->next ) {
-			field = (glMergeField *)p_field->data;
 
-			gtk_tree_store_append (store, &iter2, &iter1);
-			gtk_tree_store_set (store, &iter2,
-					    RECORD_FIELD_COLUMN, field->key,
-					    VALUE_COLUMN,        field->value,
-					    IS_RECORD_COLUMN,    FALSE,
-					    -1);
-		}
-	}
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  Search entry changed callback.                                 */
+/*--------------------------------------------------------------------------*/
+static void
+search_changed_cb (GtkSearchEntry          *entry,
+		   glMergePropertiesDialog *dialog)
+{
+	gl_debug (DEBUG_MERGE, "START");
+
+	/* Filtering renumbers all rows, so detach while doing it. */
+	gtk_tree_view_set_model (GTK_TREE_VIEW (dialog->priv->treeview), NULL);
+
+	gl_merge_record_model_set_filter (dialog->priv->model,
+					  gtk_entry_get_text (GTK_ENTRY (entry)));
 
-	g_free (primary_key);
+	gtk_tree_view_set_model (GTK_TREE_VIEW (dialog->priv->treeview),
+				 GTK_TREE_MODEL (dialog->priv->model));
 
 	gl_debug (DEBUG_MERGE, "END");
 }
@@ -582,32 +589,22 @@ load_tree (GtkTreeStore           *store,
 /* PRIVATE.  Record select toggled.                                         */
 /*--------------------------------------------------------------------------*/
 static void
-record_select_toggled_cb (GtkCellRendererToggle *cell,
-			  gchar                 *path_str,
-			  GtkTreeStore          *store)
+record_select_toggled_cb (GtkCellRendererToggle   *cell,
+			  gchar                   *path_str,
+			  glMergePropertiesDialog *dialog)
 {
 	GtkTreePath   *path;
 	GtkTreeIter    iter;
-	glMergeRecord *record;
 
 	gl_debug (DEBUG_MERGE, "START");
 
 	/* get toggled iter */
 	path = gtk_tree_path_new_from_string (path_str);
-	gtk_tree_model_get_iter (GTK_TREE_MODEL (store), &iter, path);
-
-	/* get current data */
-	gtk_tree_model_get (GTK_TREE_MODEL (store), &iter,
-			    DATA_COLUMN,   &record,
-			    -1);
-
-	/* toggle the select flag within the record */
-	record->select_flag ^= 1;
-
-	/* set new value in store */
-	gtk_tree_store_set (store, &iter,
-			    SELECT_COLUMN, record->select_flag,
-			    -1);
+	if ( gtk_tree_model_get_iter (GTK_TREE_MODEL (dialog->priv->model), &iter, path) )
+	{
+		/* toggle the select flag within the record */
+		gl_merge_record_model_toggle_select (dialog->priv->model, &iter);
+	}
 
 	/* clean up */
 	gtk_tree_path_free (path);
@@ -623,33 +620,10 @@ static void
 select_all_button_clicked_cb (GtkWidget                    *widget,
 			      glMergePropertiesDialog      *dialog)
 {
-	GtkTreeModel  *store = GTK_TREE_MODEL (dialog->priv->store);
-	GtkTreeIter    iter;
-	glMergeRecord *record;
-	gboolean       good;
-
 	gl_debug (DEBUG_MERGE, "START");
 
-	for ( good = gtk_tree_model_get_iter_first (store, &iter);
-	      good;
-	      good = gtk_tree_model_iter_next (store, &iter) )
-	{
-		
-		/* get current data */
-		gtk_tree_model_get (GTK_TREE_MODEL (store), &iter,
-				    DATA_COLUMN,   &record,
-				    -1);
-
-		
-		/* Set select flag within the record */
-		record->select_flag = TRUE;
-
-		/* set new value in store */
-		gtk_tree_store_set (GTK_TREE_STORE (store), &iter,
-				    SELECT_COLUMN, record->select_flag,
-				    -1);
-
-	}
+	gl_merge_record_model_set_all_selected (dialog->priv->model, TRUE);
+	gtk_widget_queue_draw (dialog->priv->treeview);
 
 	gl_debug (DEBUG_MERGE, "END");
 }
@@ -662,33 +636,10 @@ static void
 unselect_all_button_clicked_cb (GtkWidget                    *widget,
 				glMergePropertiesDialog      *dialog)
 {
-	GtkTreeModel  *store = GTK_TREE_MODEL (dialog->priv->store);
-	GtkTreeIter    iter;
-	glMergeRecord *record;
-	gboolean       good;
-
 	gl_debug (DEBUG_MERGE, "START");
 
-	for ( good = gtk_tree_model_get_iter_first (store, &iter);
-	      good;
-	      good = gtk_tree_model_iter_next (store, &iter) )
-	{
-		
-		/* get current data */
-		gtk_tree_model_get (GTK_TREE_MODEL (store), &iter,
-				    DATA_COLUMN,   &record,
-				    -1);
-
-		
-		/* Set select flag within the record */
-		record->select_flag = FALSE;
-
-		/* set new value in store */
-		gtk_tree_store_set (GTK_TREE_STORE (store), &iter,
-				    SELECT_COLUMN, record->select_flag,
-				    -1);
-
-	}
+	gl_merge_record_model_set_all_selected (dialog->priv->model, FALSE);
+	gtk_widget_queue_draw (dialog->priv->treeview);
 
 	gl_debug (DEBUG_MERGE, "END");
 }
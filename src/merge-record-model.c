@@ -0,0 +1,644 @@
+/*
+ *  merge-record-model.c
+ *  Copyright (C) 2026  gLabels contributors.
+ *
+ *  This file is part of gLabels.
+ *
+ *  gLabels is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gLabels is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with gLabels.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "merge-record-model.h"
+
+#include <string.h>
+
+#include "debug.h"
+
+
+/*
+ * A GtkTreeModel read directly from the merge record list.  Rows are never
+ * copied: iterators simply hold the row number of a record and, for field
+ * rows, the list node of the field within that record.
+ *
+ *   iter->user_data  = row number (index into visible rows)
+ *   iter->user_data2 = GList node of glMergeField, or NULL for a record row
+ */
+
+
+/*========================================================*/
+/* Private types.                                         */
+/*========================================================*/
+
+struct _glMergeRecordModelPrivate {
+
+	glMerge      *merge;
+	gchar        *primary_key;
+
+	GPtrArray    *records;      /* All records, in source order */
+	GArray       *rows;         /* Visible record indices, NULL if unfiltered */
+
+	gint          stamp;
+};
+
+
+/*========================================================*/
+/* Private function prototypes.                           */
+/*========================================================*/
+
+static void          gl_merge_record_model_finalize   (GObject            *object);
+
+static void          tree_model_init                  (GtkTreeModelIface  *iface);
+
+static GtkTreeModelFlags get_flags                    (GtkTreeModel       *tree_model);
+static gint          get_n_columns                    (GtkTreeModel       *tree_model);
+static GType         get_column_type                  (GtkTreeModel       *tree_model,
+                                                       gint                index);
+static gboolean      get_iter                         (GtkTreeModel       *tree_model,
+                                                       GtkTreeIter        *iter,
+                                                       GtkTreePath        *path);
+static GtkTreePath  *get_path                         (GtkTreeModel       *tree_model,
+                                                       GtkTreeIter        *iter);
+static void          get_value                        (GtkTreeModel       *tree_model,
+                                                       GtkTreeIter        *iter,
+                                                       gint                column,
+                                                       GValue             *value);
+static gboolean      iter_next                        (GtkTreeModel       *tree_model,
+                                                       GtkTreeIter        *iter);
+static gboolean      iter_children                    (GtkTreeModel       *tree_model,
+                                                       GtkTreeIter        *iter,
+                                                       GtkTreeIter        *parent);
+static gboolean      iter_has_child                   (GtkTreeModel       *tree_model,
+                                                       GtkTreeIter        *iter);
+static gint          iter_n_children                  (GtkTreeModel       *tree_model,
+                                                       GtkTreeIter        *iter);
+static gboolean      iter_nth_child                   (GtkTreeModel       *tree_model,
+                                                       GtkTreeIter        *iter,
+                                                       GtkTreeIter        *parent,
+                                                       gint                n);
+static gboolean      iter_parent                      (GtkTreeModel       *tree_model,
+                                                       GtkTreeIter        *iter,
+                                                       GtkTreeIter        *child);
+
+static guint         n_rows                           (glMergeRecordModel *model);
+static glMergeRecord *row_record                      (glMergeRecordModel *model,
+                                                       guint               row);
+static gboolean      record_matches                   (glMergeRecord      *record,
+                                                       const gchar        *text);
+
+
+/*****************************************************************************/
+/* Boilerplate object stuff.                                                 */
+/*****************************************************************************/
+G_DEFINE_TYPE_WITH_CODE (glMergeRecordModel, gl_merge_record_model, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_MODEL, tree_model_init))
+
+
+/*****************************************************************************/
+/* Class Init Function.                                                      */
+/*****************************************************************************/
+static void
+gl_merge_record_model_class_init (glMergeRecordModelClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+	gl_debug (DEBUG_MERGE, "");
+
+	gl_merge_record_model_parent_class = g_type_class_peek_parent (class);
+
+	object_class->finalize = gl_merge_record_model_finalize;
+}
+
+
+/*****************************************************************************/
+/* GtkTreeModel Interface Init Function.                                     */
+/*****************************************************************************/
+static void
+tree_model_init (GtkTreeModelIface *iface)
+{
+	iface->get_flags       = get_flags;
+	iface->get_n_columns   = get_n_columns;
+	iface->get_column_type = get_column_type;
+	iface->get_iter        = get_iter;
+	iface->get_path        = get_path;
+	iface->get_value       = get_value;
+	iface->iter_next       = iter_next;
+	iface->iter_children   = iter_children;
+	iface->iter_has_child  = iter_has_child;
+	iface->iter_n_children = iter_n_children;
+	iface->iter_nth_child  = iter_nth_child;
+	iface->iter_parent     = iter_parent;
+}
+
+
+/*****************************************************************************/
+/* Object Instance Init Function.                                            */
+/*****************************************************************************/
+static void
+gl_merge_record_model_init (glMergeRecordModel *model)
+{
+	gl_debug (DEBUG_MERGE, "");
+
+	model->priv = g_new0 (glMergeRecordModelPrivate, 1);
+
+	model->priv->stamp = g_random_int ();
+}
+
+
+/*****************************************************************************/
+/* Finalize Function.                                                        */
+/*****************************************************************************/
+static void
+gl_merge_record_model_finalize (GObject *object)
+{
+	glMergeRecordModel *model = GL_MERGE_RECORD_MODEL (object);
+
+	gl_debug (DEBUG_MERGE, "START");
+
+	g_return_if_fail (object && GL_IS_MERGE_RECORD_MODEL (object));
+
+	if (model->priv->rows) {
+		g_array_free (model->priv->rows, TRUE);
+	}
+	g_ptr_array_free (model->priv->records, TRUE);
+	g_free (model->priv->primary_key);
+	g_object_unref (G_OBJECT (model->priv->merge));
+	g_free (model->priv);
+
+	G_OBJECT_CLASS (gl_merge_record_model_parent_class)->finalize (object);
+
+	gl_debug (DEBUG_MERGE, "END");
+}
+
+
+/*****************************************************************************/
+/* New record model for merge.  Records are referenced, not copied.          */
+/*****************************************************************************/
+glMergeRecordModel *
+gl_merge_record_model_new (glMerge *merge)
+{
+	glMergeRecordModel *model;
+	const GList        *p;
+
+	gl_debug (DEBUG_MERGE, "START");
+
+	g_return_val_if_fail (merge && GL_IS_MERGE (merge), NULL);
+
+	model = g_object_new (GL_TYPE_MERGE_RECORD_MODEL, NULL);
+
+	model->priv->merge       = g_object_ref (merge);
+	model->priv->primary_key = gl_merge_get_primary_key (merge);
+
+	/* Index records once, so rows can be found by number. */
+	model->priv->records = g_ptr_array_new ();
+	for ( p = gl_merge_get_record_list (merge); p != NULL; p = p->next )
+	{
+		g_ptr_array_add (model->priv->records, p->data);
+	}
+
+	gl_debug (DEBUG_MERGE, "END");
+
+	return model;
+}
+
+
+/*****************************************************************************/
+/* Toggle select flag of record at iter.                                     */
+/*****************************************************************************/
+void
+gl_merge_record_model_toggle_select (glMergeRecordModel *model,
+                                     GtkTreeIter        *iter)
+{
+	glMergeRecord *record;
+	GtkTreePath   *path;
+
+	g_return_if_fail (model && GL_IS_MERGE_RECORD_MODEL (model));
+	g_return_if_fail (iter->stamp == model->priv->stamp);
+
+	if ( iter->user_data2 != NULL )
+	{
+		/* Field rows have no selection. */
+		return;
+	}
+
+	record = row_record (model, GPOINTER_TO_UINT (iter->user_data));
+	gl_merge_set_record_selected (model->priv->merge, record,
+	                              !gl_merge_is_record_selected (model->priv->merge, record));
+
+	path = get_path (GTK_TREE_MODEL (model), iter);
+	gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, iter);
+	gtk_tree_path_free (path);
+}
+
+
+/*****************************************************************************/
+/* Set select flag of all records, including those hidden by the filter.     */
+/* Since this touches every row, no per-row signals are emitted; views only  */
+/* need to be redrawn.                                                       */
+/*****************************************************************************/
+void
+gl_merge_record_model_set_all_selected (glMergeRecordModel *model,
+                                        gboolean            select_flag)
+{
+	g_return_if_fail (model && GL_IS_MERGE_RECORD_MODEL (model));
+
+	gl_merge_set_all_selected (model->priv->merge, select_flag);
+}
+
+
+/*****************************************************************************/
+/* Only show records with a field value containing text (ignoring ASCII     */
+/* case).  NULL or empty text shows all records.  This invalidates all      */
+/* iterators and emits no row signals, so detach the model from any view    */
+/* before calling.                                                           */
+/*****************************************************************************/
+void
+gl_merge_record_model_set_filter (glMergeRecordModel *model,
+                                  const gchar        *text)
+{
+	guint          i;
+	glMergeRecord *record;
+
+	gl_debug (DEBUG_MERGE, "START");
+
+	g_return_if_fail (model && GL_IS_MERGE_RECORD_MODEL (model));
+
+	if (model->priv->rows) {
+		g_array_free (model->priv->rows, TRUE);
+		model->priv->rows = NULL;
+	}
+
+	if ( text && *text )
+	{
+		model->priv->rows = g_array_new (FALSE, FALSE, sizeof (guint));
+
+		for ( i = 0; i < model->priv->records->len; i++ )
+		{
+			record = g_ptr_array_index (model->priv->records, i);
+
+			if ( record_matches (record, text) )
+			{
+				g_array_append_val (model->priv->rows, i);
+			}
+		}
+	}
+
+	model->priv->stamp++;
+
+	gl_debug (DEBUG_MERGE, "END");
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Number of visible records.                                      */
+/*---------------------------------------------------------------------------*/
+static guint
+n_rows (glMergeRecordModel *model)
+{
+	return model->priv->rows ? model->priv->rows->len : model->priv->records->len;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Record at visible row.                                          */
+/*---------------------------------------------------------------------------*/
+static glMergeRecord *
+row_record (glMergeRecordModel *model,
+            guint               row)
+{
+	guint i;
+
+	i = model->priv->rows ? g_array_index (model->priv->rows, guint, row) : row;
+
+	return g_ptr_array_index (model->priv->records, i);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Does any field value of record contain text?                    */
+/*---------------------------------------------------------------------------*/
+static gboolean
+record_matches (glMergeRecord *record,
+                const gchar   *text)
+{
+	GList         *p;
+	glMergeField  *field;
+	const gchar   *s;
+	gsize          len;
+
+	len = strlen (text);
+
+	for ( p = record->field_list; p != NULL; p = p->next )
+	{
+		field = (glMergeField *)p->data;
+
+		if ( field->value == NULL ) continue;
+
+		for ( s = field->value; *s; s++ )
+		{
+			if ( (g_ascii_tolower (*s) == g_ascii_tolower (*text)) &&
+			     (g_ascii_strncasecmp (s, text, len) == 0) )
+			{
+				return TRUE;
+			}
+		}
+	}
+
+	return FALSE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  GtkTreeModel methods.                                           */
+/*---------------------------------------------------------------------------*/
+static GtkTreeModelFlags
+get_flags (GtkTreeModel *tree_model)
+{
+	return 0;
+}
+
+
+static gint
+get_n_columns (GtkTreeModel *tree_model)
+{
+	return GL_MERGE_RECORD_MODEL_N_COLUMNS;
+}
+
+
+static GType
+get_column_type (GtkTreeModel *tree_model,
+                 gint          index)
+{
+	switch (index) {
+	case GL_MERGE_RECORD_MODEL_SELECT_COLUMN:
+	case GL_MERGE_RECORD_MODEL_IS_RECORD_COLUMN:
+		return G_TYPE_BOOLEAN;
+	case GL_MERGE_RECORD_MODEL_RECORD_FIELD_COLUMN:
+	case GL_MERGE_RECORD_MODEL_VALUE_COLUMN:
+		return G_TYPE_STRING;
+	case GL_MERGE_RECORD_MODEL_DATA_COLUMN:
+		return G_TYPE_POINTER;
+	default:
+		g_return_val_if_reached (G_TYPE_INVALID);
+	}
+}
+
+
+static gboolean
+get_iter (GtkTreeModel *tree_model,
+          GtkTreeIter  *iter,
+          GtkTreePath  *path)
+{
+	gint               *indices;
+	gint                depth;
+	GtkTreeIter         parent;
+
+	indices = gtk_tree_path_get_indices (path);
+	depth   = gtk_tree_path_get_depth (path);
+
+	if ( !iter_nth_child (tree_model, &parent, NULL, indices[0]) )
+	{
+		return FALSE;
+	}
+	if ( depth == 1 )
+	{
+		*iter = parent;
+		return TRUE;
+	}
+	if ( depth == 2 )
+	{
+		return iter_nth_child (tree_model, iter, &parent, indices[1]);
+	}
+
+	return FALSE;
+}
+
+
+static GtkTreePath *
+get_path (GtkTreeModel *tree_model,
+          GtkTreeIter  *iter)
+{
+	glMergeRecordModel *model = GL_MERGE_RECORD_MODEL (tree_model);
+	GtkTreePath        *path;
+	glMergeRecord      *record;
+	guint               row;
+
+	g_return_val_if_fail (iter->stamp == model->priv->stamp, NULL);
+
+	row  = GPOINTER_TO_UINT (iter->user_data);
+	path = gtk_tree_path_new ();
+	gtk_tree_path_append_index (path, row);
+
+	if ( iter->user_data2 != NULL )
+	{
+		record = row_record (model, row);
+		gtk_tree_path_append_index (path,
+					    g_list_position (record->field_list, iter->user_data2));
+	}
+
+	return path;
+}
+
+
+static void
+get_value (GtkTreeModel *tree_model,
+           GtkTreeIter  *iter,
+           gint          column,
+           GValue       *value)
+{
+	glMergeRecordModel *model = GL_MERGE_RECORD_MODEL (tree_model);
+	glMergeRecord      *record;
+	glMergeField       *field = NULL;
+
+	g_return_if_fail (iter->stamp == model->priv->stamp);
+
+	record = row_record (model, GPOINTER_TO_UINT (iter->user_data));
+	if ( iter->user_data2 != NULL )
+	{
+		field = (glMergeField *)((GList *)iter->user_data2)->data;
+	}
+
+	g_value_init (value, get_column_type (tree_model, column));
+
+	switch (column) {
+	case GL_MERGE_RECORD_MODEL_SELECT_COLUMN:
+		g_value_set_boolean (value,
+		                     field ? FALSE : gl_merge_is_record_selected (model->priv->merge, record));
+		break;
+	case GL_MERGE_RECORD_MODEL_RECORD_FIELD_COLUMN:
+		if ( field )
+		{
+			g_value_set_string (value, field->key);
+		}
+		else
+		{
+			g_value_set_string (value, gl_merge_lookup_key (record, model->priv->primary_key));
+		}
+		break;
+	case GL_MERGE_RECORD_MODEL_VALUE_COLUMN:
+		g_value_set_string (value, field ? field->value : NULL);
+		break;
+	case GL_MERGE_RECORD_MODEL_IS_RECORD_COLUMN:
+		g_value_set_boolean (value, field == NULL);
+		break;
+	case GL_MERGE_RECORD_MODEL_DATA_COLUMN:
+		g_value_set_pointer (value, record);
+		break;
+	default:
+		break;
+	}
+}
+
+
+static gboolean
+iter_next (GtkTreeModel *tree_model,
+           GtkTreeIter  *iter)
+{
+	glMergeRecordModel *model = GL_MERGE_RECORD_MODEL (tree_model);
+	guint               row;
+
+	g_return_val_if_fail (iter->stamp == model->priv->stamp, FALSE);
+
+	if ( iter->user_data2 != NULL )
+	{
+		iter->user_data2 = ((GList *)iter->user_data2)->next;
+		return (iter->user_data2 != NULL);
+	}
+
+	row = GPOINTER_TO_UINT (iter->user_data) + 1;
+	if ( row < n_rows (model) )
+	{
+		iter->user_data = GUINT_TO_POINTER (row);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+
+static gboolean
+iter_children (GtkTreeModel *tree_model,
+               GtkTreeIter  *iter,
+               GtkTreeIter  *parent)
+{
+	return iter_nth_child (tree_model, iter, parent, 0);
+}
+
+
+static gboolean
+iter_has_child (GtkTreeModel *tree_model,
+                GtkTreeIter  *iter)
+{
+	return (iter_n_children (tree_model, iter) > 0);
+}
+
+
+static gint
+iter_n_children (GtkTreeModel *tree_model,
+                 GtkTreeIter  *iter)
+{
+	glMergeRecordModel *model = GL_MERGE_RECORD_MODEL (tree_model);
+	glMergeRecord      *record;
+
+	if ( iter == NULL )
+	{
+		return n_rows (model);
+	}
+
+	g_return_val_if_fail (iter->stamp == model->priv->stamp, 0);
+
+	if ( iter->user_data2 != NULL )
+	{
+		return 0;
+	}
+
+	record = row_record (model, GPOINTER_TO_UINT (iter->user_data));
+	return g_list_length (record->field_list);
+}
+
+
+static gboolean
+iter_nth_child (GtkTreeModel *tree_model,
+                GtkTreeIter  *iter,
+                GtkTreeIter  *parent,
+                gint          n)
+{
+	glMergeRecordModel *model = GL_MERGE_RECORD_MODEL (tree_model);
+	glMergeRecord      *record;
+	GList              *p;
+
+	if ( parent == NULL )
+	{
+		if ( (n >= 0) && ((guint)n < n_rows (model)) )
+		{
+			iter->stamp      = model->priv->stamp;
+			iter->user_data  = GUINT_TO_POINTER (n);
+			iter->user_data2 = NULL;
+			return TRUE;
+		}
+		return FALSE;
+	}
+
+	g_return_val_if_fail (parent->stamp == model->priv->stamp, FALSE);
+
+	if ( parent->user_data2 != NULL )
+	{
+		return FALSE;
+	}
+
+	record = row_record (model, GPOINTER_TO_UINT (parent->user_data));
+	p = g_list_nth (record->field_list, n);
+	if ( p == NULL )
+	{
+		return FALSE;
+	}
+
+	iter->stamp      = model->priv->stamp;
+	iter->user_data  = parent->user_data;
+	iter->user_data2 = p;
+	return TRUE;
+}
+
+
+static gboolean
+iter_parent (GtkTreeModel *tree_model,
+             GtkTreeIter  *iter,
+             GtkTreeIter  *child)
+{
+	glMergeRecordModel *model = GL_MERGE_RECORD_MODEL (tree_model);
+
+	g_return_val_if_fail (child->stamp == model->priv->stamp, FALSE);
+
+	if ( child->user_data2 == NULL )
+	{
+		return FALSE;
+	}
+
+	iter->stamp      = model->priv->stamp;
+	iter->user_data  = child->user_data;
+	iter->user_data2 = NULL;
+	return TRUE;
+}
+
+
+
+
+/*
+ * Local Variables:       -- emacs
+ * mode: C                -- emacs
+ * c-basic-offset: 8      -- emacs
+ * tab-width: 8           -- emacs
+ * indent-tabs-mode: nil  -- emacs
+ * End:                   -- emacs
+ */
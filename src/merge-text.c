@@ -599,7 +599,6 @@ gl_merge_text_get_record (glMerge *merge)
         }
 
         record = g_new0 (glMergeRecord, 1);
-        record->select_flag = TRUE;
         for (p=fields, i_field=0; p != NULL; p=p->next, i_field++) {
 
                 field = g_new0 (glMergeField, 1);
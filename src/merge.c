@@ -28,19 +28,47 @@
 
 #include <libglabels.h>
 
+#include "color.h"
+
 #include "debug.h"
 
 /*========================================================*/
 /* Private types.                                         */
 /*========================================================*/
 
+/*
+ * Records read from a source.  Immutable once loaded, and shared by every
+ * copy of a merge, so duplicating a merge does not copy any record data.
+ * Fields used as colors are parsed once per store, on first use.
+ */
+typedef struct {
+	gint               ref_count;
+	GList             *record_list;
+	gint               n_records;
+
+	GMutex             color_lock;
+	GHashTable        *color_columns;
+} RecordStore;
+
+/*
+ * Record selection, one bit per record.  Shared between copies of a merge
+ * until one of them changes the selection (copy on write).
+ */
+typedef struct {
+	gint               ref_count;
+	gint               n_records;
+	gint               n_selected;
+	guint32            bits[1];
+} SelectMap;
+
 struct _glMergePrivate {
 	gchar             *name;
 	gchar             *description;
 	gchar             *src;
 	glMergeSrcType     src_type;
 
-	GList             *record_list;
+	RecordStore       *store;
+	SelectMap         *selection;
 };
 
 enum {
@@ -79,11 +107,22 @@ static glMergeRecord *merge_get_record       (glMerge              *merge);
 
 static void           merge_free_record      (glMergeRecord       **record);
 
-static glMergeRecord *merge_dup_record       (const glMergeRecord  *record);
-
 static void           merge_free_record_list (GList               **record_list);
 
-static GList         *merge_dup_record_list  (GList                *record_list);
+static RecordStore   *record_store_new       (GList                *record_list);
+
+static RecordStore   *record_store_ref       (RecordStore          *store);
+
+static void           record_store_unref     (RecordStore          *store);
+
+static SelectMap     *select_map_new         (gint                  n_records,
+                                              gboolean              select_flag);
+
+static SelectMap     *select_map_ref         (SelectMap            *selection);
+
+static void           select_map_unref       (SelectMap            *selection);
+
+static SelectMap     *select_map_writable    (glMerge              *merge);
 
 
 
@@ -261,7 +300,8 @@ gl_merge_finalize (GObject *object)
 
 	g_return_if_fail (object && GL_IS_MERGE (object));
 
-	merge_free_record_list (&merge->priv->record_list);
+	record_store_unref (merge->priv->store);
+	select_map_unref (merge->priv->selection);
 	g_free (merge->priv->name);
 	g_free (merge->priv->description);
 	g_free (merge->priv->src);
@@ -332,8 +372,8 @@ gl_merge_dup (const glMerge *src_merge)
 	dst_merge->priv->description = g_strdup (src_merge->priv->description);
 	dst_merge->priv->src         = g_strdup (src_merge->priv->src);
 	dst_merge->priv->src_type    = src_merge->priv->src_type;
-	dst_merge->priv->record_list 
-		= merge_dup_record_list (src_merge->priv->record_list);
+	dst_merge->priv->store       = record_store_ref (src_merge->priv->store);
+	dst_merge->priv->selection   = select_map_ref (src_merge->priv->selection);
 
 	if ( GL_MERGE_GET_CLASS(src_merge)->copy != NULL ) {
 
@@ -426,7 +466,11 @@ gl_merge_set_src (glMerge       *merge,
 			g_free (merge->priv->src);
 		}
 		merge->priv->src = NULL;
-		merge_free_record_list (&merge->priv->record_list);
+
+		record_store_unref (merge->priv->store);
+		merge->priv->store = NULL;
+		select_map_unref (merge->priv->selection);
+		merge->priv->selection = NULL;
 
 	}
 	else
@@ -438,15 +482,22 @@ gl_merge_set_src (glMerge       *merge,
 		}
 		merge->priv->src = g_strdup (src);
 
-		merge_free_record_list (&merge->priv->record_list);
+		record_store_unref (merge->priv->store);
+		select_map_unref (merge->priv->selection);
 			
+		GL_TRACE_BEGIN ("merge parse");
 		merge_open (merge);
 		while ( (record = merge_get_record (merge)) != NULL )
 		{
-			record_list = g_list_append( record_list, record );
+			record_list = g_list_prepend( record_list, record );
 		}
 		merge_close (merge);
-		merge->priv->record_list = record_list;
+		GL_TRACE_END ("merge parse");
+
+		merge->priv->store     = record_store_new (g_list_reverse (record_list));
+		merge->priv->selection = select_map_new (merge->priv->store->n_records, TRUE);
+
+		GL_TRACE_COUNT ("merge records", merge->priv->store->n_records);
 
 	}
 		     
@@ -639,39 +690,6 @@ merge_free_record (glMergeRecord **record)
 	gl_debug (DEBUG_MERGE, "END");
 }
 
-/*---------------------------------------------------------------------------*/
-/* Duplicate a merge record (list of fields)                                 */
-/*---------------------------------------------------------------------------*/
-static glMergeRecord *
-merge_dup_record (const glMergeRecord *record)
-{
-	glMergeRecord *dest_record;
-	GList         *p;
-	glMergeField  *dest_field, *field;
-
-	gl_debug (DEBUG_MERGE, "START");
-
-	dest_record = g_new0 (glMergeRecord, 1);
-	dest_record->select_flag = record->select_flag;
-
-	for (p = record->field_list; p != NULL; p = p->next) {
-		field = (glMergeField *) p->data;
-
-		dest_field = g_new0 (glMergeField, 1);
-
-		dest_field->key   = g_strdup (field->key);
-		dest_field->value = g_strdup (field->value);
-
-		dest_record->field_list =
-			g_list_append (dest_record->field_list, dest_field);
-
-	}
-
-	gl_debug (DEBUG_MERGE, "END");
-
-	return dest_record;
-}
-
 /*****************************************************************************/
 /* Find key in given record and evaluate.                                    */
 /*****************************************************************************/
@@ -679,26 +697,34 @@ gchar *
 gl_merge_eval_key (const glMergeRecord *record,
 		   const gchar         *key)
 		   
+{
+	gl_debug (DEBUG_MERGE, "");
+
+	return g_strdup (gl_merge_lookup_key (record, key));
+}
+
+/*****************************************************************************/
+/* Lookup value of key in record, without copying.                           */
+/*****************************************************************************/
+const gchar *
+gl_merge_lookup_key (const glMergeRecord *record,
+		     const gchar         *key)
 {
 	GList        *p;
 	glMergeField *field;
-	gchar        *val = NULL;
-
-	gl_debug (DEBUG_MERGE, "START");
+	const gchar  *val = NULL;
 
 	if ( (record != NULL) && (key != NULL) ) {
 		for (p = record->field_list; p != NULL; p = p->next) {
 			field = (glMergeField *) p->data;
 
 			if (strcmp (key, field->key) == 0) {
-				val = g_strdup (field->value);
+				val = field->value;
 			}
 
 		}
 	}
 
-	gl_debug (DEBUG_MERGE, "END");
-
 	return val;
 }
 
@@ -710,13 +736,66 @@ gl_merge_get_record_list (const glMerge *merge)
 {
 	gl_debug (DEBUG_MERGE, "");
 	      
-	if ( merge != NULL ) {
-		return merge->priv->record_list;
+	if ( (merge != NULL) && (merge->priv->store != NULL) ) {
+		return merge->priv->store->record_list;
 	} else {
 		return NULL;
 	}
 }
 
+/*****************************************************************************/
+/* Get values of field key parsed as colors, indexed by record index.  Each  */
+/* key is resolved only once per set of records read, and the values are     */
+/* shared by all copies of the merge.  Thread safe.                          */
+/*****************************************************************************/
+const guint *
+gl_merge_get_color_column (const glMerge *merge,
+			   const gchar   *key,
+			   gint          *n_values)
+{
+	RecordStore   *store;
+	guint         *column;
+	const GList   *p;
+	glMergeRecord *record;
+
+	gl_debug (DEBUG_MERGE, "START");
+
+	*n_values = 0;
+
+	if ( (merge == NULL) || (merge->priv->store == NULL) || (key == NULL) ) {
+		gl_debug (DEBUG_MERGE, "END no records");
+		return NULL;
+	}
+	store = merge->priv->store;
+
+	g_mutex_lock (&store->color_lock);
+
+	if ( store->color_columns == NULL ) {
+		store->color_columns = g_hash_table_new_full (g_str_hash, g_str_equal,
+							      g_free, g_free);
+	}
+
+	column = g_hash_table_lookup (store->color_columns, key);
+	if ( column == NULL ) {
+		column = g_new (guint, MAX (1, store->n_records));
+		for ( p = store->record_list; p != NULL; p = p->next ) {
+			record = (glMergeRecord *)p->data;
+			column[record->index] = gl_color_parse (gl_merge_lookup_key (record, key));
+		}
+		g_hash_table_insert (store->color_columns, g_strdup (key), column);
+
+		GL_TRACE_COUNT ("merge color columns", 1);
+	}
+
+	g_mutex_unlock (&store->color_lock);
+
+	*n_values = store->n_records;
+
+	gl_debug (DEBUG_MERGE, "END");
+
+	return column;
+}
+
 /*---------------------------------------------------------------------------*/
 /* Free a list of records.                                                   */
 /*---------------------------------------------------------------------------*/
@@ -741,52 +820,209 @@ merge_free_record_list (GList **record_list)
 	gl_debug (DEBUG_MERGE, "END");
 }
 
-/*---------------------------------------------------------------------------*/
-/* Duplicate a list of records.                                              */
-/*---------------------------------------------------------------------------*/
-static GList *
-merge_dup_record_list (GList *record_list)
+/*****************************************************************************/
+/* Count selected records.                                                   */
+/*****************************************************************************/
+gint
+gl_merge_get_record_count (const glMerge *merge)
 {
-	GList         *dest_list = NULL, *p;
-	glMergeRecord *dest_record, *record;
+	gl_debug (DEBUG_MERGE, "");
 
-	gl_debug (DEBUG_MERGE, "START");
+	if ( merge->priv->selection == NULL ) {
+		return 0;
+	}
 
-	for (p = record_list; p != NULL; p = p->next) {
-		record = (glMergeRecord *) p->data;
+	return merge->priv->selection->n_selected;
+}
 
-		dest_record = merge_dup_record( record );
-		dest_list = g_list_append (dest_list, dest_record);
-	}
+/*****************************************************************************/
+/* Is record selected?                                                       */
+/*****************************************************************************/
+gboolean
+gl_merge_is_record_selected (const glMerge       *merge,
+			     const glMergeRecord *record)
+{
+	SelectMap *selection;
 
+	g_return_val_if_fail (merge && GL_IS_MERGE (merge), FALSE);
+	g_return_val_if_fail (record, FALSE);
 
-	gl_debug (DEBUG_MERGE, "END");
+	selection = merge->priv->selection;
+	g_return_val_if_fail (selection && (record->index < selection->n_records), FALSE);
 
-	return dest_list;
+	return (selection->bits[record->index / 32] >> (record->index % 32)) & 1;
 }
 
 /*****************************************************************************/
-/* Count selected records.                                                   */
+/* Select or unselect record.                                                */
 /*****************************************************************************/
-gint
-gl_merge_get_record_count (const glMerge *merge)
+void
+gl_merge_set_record_selected (glMerge             *merge,
+			      const glMergeRecord *record,
+			      gboolean             select_flag)
 {
-	GList *p;
-	glMergeRecord *record;
-	gint count;
+	SelectMap *selection;
+	guint32    mask;
+
+	g_return_if_fail (merge && GL_IS_MERGE (merge));
+	g_return_if_fail (record);
+
+	if ( gl_merge_is_record_selected (merge, record) == !!select_flag ) {
+		return;
+	}
+
+	selection = select_map_writable (merge);
+	mask = 1u << (record->index % 32);
+
+	if ( select_flag ) {
+		selection->bits[record->index / 32] |= mask;
+		selection->n_selected++;
+	} else {
+		selection->bits[record->index / 32] &= ~mask;
+		selection->n_selected--;
+	}
+}
 
+/*****************************************************************************/
+/* Select or unselect all records.                                           */
+/*****************************************************************************/
+void
+gl_merge_set_all_selected (glMerge  *merge,
+			   gboolean  select_flag)
+{
 	gl_debug (DEBUG_MERGE, "START");
 
-	count = 0;
-	for ( p=merge->priv->record_list; p!=NULL; p=p->next ) {
-		record = (glMergeRecord *)p->data;
+	g_return_if_fail (merge && GL_IS_MERGE (merge));
 
-		if ( record->select_flag ) count ++;
+	if ( merge->priv->selection != NULL ) {
+		select_map_unref (merge->priv->selection);
+		merge->priv->selection = select_map_new (merge->priv->store->n_records,
+							 select_flag);
 	}
 
 	gl_debug (DEBUG_MERGE, "END");
+}
+
+/*---------------------------------------------------------------------------*/
+/* Create record store, taking ownership of records.                         */
+/*---------------------------------------------------------------------------*/
+static RecordStore *
+record_store_new (GList *record_list)
+{
+	RecordStore   *store;
+	GList         *p;
+	glMergeRecord *record;
+
+	store = g_new0 (RecordStore, 1);
+	store->ref_count   = 1;
+	store->record_list = record_list;
+	g_mutex_init (&store->color_lock);
+
+	for ( p = record_list; p != NULL; p = p->next ) {
+		record = (glMergeRecord *)p->data;
+
+		record->index = store->n_records++;
+	}
+
+	return store;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Reference record store.  NULL safe.                                       */
+/*---------------------------------------------------------------------------*/
+static RecordStore *
+record_store_ref (RecordStore *store)
+{
+	if ( store != NULL ) {
+		g_atomic_int_inc (&store->ref_count);
+	}
+
+	return store;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Unreference record store, freeing records with last reference.  Copies   */
+/* of a merge may be released in other threads (e.g. print preview).         */
+/*---------------------------------------------------------------------------*/
+static void
+record_store_unref (RecordStore *store)
+{
+	if ( (store != NULL) && g_atomic_int_dec_and_test (&store->ref_count) ) {
+		merge_free_record_list (&store->record_list);
+		if ( store->color_columns != NULL ) {
+			g_hash_table_destroy (store->color_columns);
+		}
+		g_mutex_clear (&store->color_lock);
+		g_free (store);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* Create selection map for n_records, all selected or all unselected.       */
+/*---------------------------------------------------------------------------*/
+static SelectMap *
+select_map_new (gint     n_records,
+		gboolean select_flag)
+{
+	SelectMap *selection;
+	gint       n_words;
+
+	n_words = MAX (1, (n_records + 31) / 32);
+
+	selection = g_malloc (sizeof (SelectMap) + (n_words - 1) * sizeof (guint32));
+	selection->ref_count  = 1;
+	selection->n_records  = n_records;
+	selection->n_selected = select_flag ? n_records : 0;
+	memset (selection->bits, select_flag ? 0xFF : 0x00, n_words * sizeof (guint32));
+
+	return selection;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Reference selection map.  NULL safe.                                      */
+/*---------------------------------------------------------------------------*/
+static SelectMap *
+select_map_ref (SelectMap *selection)
+{
+	if ( selection != NULL ) {
+		g_atomic_int_inc (&selection->ref_count);
+	}
+
+	return selection;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Unreference selection map.  NULL safe.                                    */
+/*---------------------------------------------------------------------------*/
+static void
+select_map_unref (SelectMap *selection)
+{
+	if ( (selection != NULL) && g_atomic_int_dec_and_test (&selection->ref_count) ) {
+		g_free (selection);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* Get selection map of merge for modification, copying it if shared.        */
+/*---------------------------------------------------------------------------*/
+static SelectMap *
+select_map_writable (glMerge *merge)
+{
+	SelectMap *selection = merge->priv->selection;
+	gsize      size;
+
+	if ( g_atomic_int_get (&selection->ref_count) > 1 ) {
+		size = sizeof (SelectMap) +
+			(MAX (1, (selection->n_records + 31) / 32) - 1) * sizeof (guint32);
+
+		merge->priv->selection = g_malloc (size);
+		memcpy (merge->priv->selection, selection, size);
+		merge->priv->selection->ref_count = 1;
+
+		select_map_unref (selection);
+	}
 
-	return count;
+	return merge->priv->selection;
 }
 
 
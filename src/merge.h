@@ -36,7 +36,7 @@ typedef struct {
 } glMergeField;
 
 typedef struct {
-	gboolean select_flag;
+	gint      index;       /* Position in merge, set when loaded */
 	GList    *field_list;  /* List of glMergeFields */
 } glMergeRecord;
 
@@ -118,10 +118,27 @@ gchar            *gl_merge_get_primary_key     (const glMerge       *merge);
 gchar            *gl_merge_eval_key            (const glMergeRecord *record,
                                                 const gchar         *key);
 
+const gchar      *gl_merge_lookup_key          (const glMergeRecord *record,
+                                                const gchar         *key);
+
 const GList      *gl_merge_get_record_list     (const glMerge       *merge);
 
+const guint      *gl_merge_get_color_column    (const glMerge       *merge,
+                                                const gchar         *key,
+                                                gint                *n_values);
+
 gint              gl_merge_get_record_count    (const glMerge       *merge);
 
+gboolean          gl_merge_is_record_selected  (const glMerge       *merge,
+                                                const glMergeRecord *record);
+
+void              gl_merge_set_record_selected (glMerge             *merge,
+                                                const glMergeRecord *record,
+                                                gboolean             select_flag);
+
+void              gl_merge_set_all_selected    (glMerge             *merge,
+                                                gboolean             select_flag);
+
 G_END_DECLS
 
 #endif
@@ -23,134 +23,556 @@
 #include "mini-preview-pixbuf-cache.h"
 
 #include <glib.h>
+#include <glib/gstdio.h>
 
 #include <libglabels.h>
 #include "mini-preview-pixbuf.h"
 
 #include "debug.h"
 
+/*========================================================*/
+/* Private macros and constants.                          */
+/*========================================================*/
+
+#define PREVIEW_SIZE   72
+
+/* Bump whenever the appearance of mini previews changes, so that stale
+ * thumbnails in the disk cache are no longer picked up. */
+#define CACHE_VERSION  1
+
 /*========================================================*/
 /* Private types.                                         */
 /*========================================================*/
 
+/*
+ * One entry per distinct template geometry.  Templates that are identical
+ * in size and layout share a single entry, and therefore a single pixbuf.
+ */
+typedef struct {
+        gchar       *key;        /* Geometry hash, also used as disk cache name. */
+        gboolean     disk_flag;  /* Key may be used as disk cache name. */
+        lglTemplate *template;   /* Representative template. */
+        GdkPixbuf   *pixbuf;     /* NULL until rendered or loaded. */
+        gboolean     pending;    /* Render job queued or running. */
+        GList       *waiters;    /* List of (Waiter *) to notify when ready. */
+} CacheEntry;
+
+typedef struct {
+        glMiniPreviewPixbufCacheFunc  func;
+        gpointer                      user_data;
+} Waiter;
+
+/*
+ * Render job, owned by the worker thread until it is handed back to the
+ * main loop.  Only the template copy and filename are touched off the main
+ * thread; the entry pointer is only dereferenced in render_job_done().
+ */
+typedef struct {
+        CacheEntry  *entry;
+        lglTemplate *template;
+        gchar       *filename;
+        GdkPixbuf   *pixbuf;
+} RenderJob;
+
 /*========================================================*/
 /* Private globals.                                       */
 /*========================================================*/
 
-static GHashTable *mini_preview_pixbuf_cache = NULL;
+static GHashTable  *entry_cache = NULL;   /* key  -> (CacheEntry *) */
+static GHashTable  *name_cache  = NULL;   /* name -> (CacheEntry *), not owned */
+static GThreadPool *render_pool = NULL;
+static gchar       *cache_dir   = NULL;
 
 /*========================================================*/
 /* Private function prototypes.                           */
 /*========================================================*/
 
+static gchar      *geometry_key        (const lglTemplate *template);
+
+static CacheEntry *lookup_entry        (const gchar       *name);
+
+static void        cache_entry_free    (CacheEntry        *entry);
+
+static void        queue_render        (CacheEntry        *entry);
+
+static void        render_job_func     (RenderJob         *job,
+                                        gpointer           user_data);
+
+static gboolean    render_job_done     (RenderJob         *job);
+
 
 /*****************************************************************************/
-/* Create a new hash table to keep track of cached mini preview pixbufs.     */
+/* Initialize cache.                                                         */
+/*                                                                           */
+/* No previews are rendered here.  They are created on demand the first time */
+/* they are looked up, in a background thread pool, and persisted to disk so */
+/* that later sessions only need to load them.                               */
 /*****************************************************************************/
 void
 gl_mini_preview_pixbuf_cache_init (void)
 {
-        GList       *names = NULL;
-        GList       *p;
-        lglTemplate *template;
-
 	gl_debug (DEBUG_PIXBUF_CACHE, "START");
 
-	mini_preview_pixbuf_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+	entry_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                             NULL, (GDestroyNotify)cache_entry_free);
+	name_cache  = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
-        names = lgl_db_get_template_name_list_all (NULL, NULL, NULL);
-        for ( p=names; p != NULL; p=p->next )
-        {
-                gl_debug (DEBUG_PIXBUF_CACHE, "name = \"%s\"", p->data);
+        render_pool = g_thread_pool_new ((GFunc)render_job_func, NULL,
+                                         g_get_num_processors (), FALSE, NULL);
 
-                template = lgl_db_lookup_template_from_name (p->data);
-                gl_mini_preview_pixbuf_cache_add_by_template (template);
-                lgl_template_free (template);
+        cache_dir = g_build_filename (g_get_user_cache_dir (), "glabels", "mini-previews", NULL);
+        if ( g_mkdir_with_parents (cache_dir, 0775) != 0 )
+        {
+                g_message ("Cannot create mini preview cache directory \"%s\"", cache_dir);
+                g_free (cache_dir);
+                cache_dir = NULL;
         }
-        lgl_db_free_template_name_list (names);
 
-	gl_debug (DEBUG_PIXBUF_CACHE, "END pixbuf_cache=%p", mini_preview_pixbuf_cache);
+	gl_debug (DEBUG_PIXBUF_CACHE, "END cache_dir=\"%s\"", cache_dir);
 }
 
 
 /*****************************************************************************/
-/* Add pixbuf to cache by template.                                          */
+/* (Re)associate name with its current template and start rendering it.     */
 /*****************************************************************************/
 void
-gl_mini_preview_pixbuf_cache_add_by_template (lglTemplate *template)
+gl_mini_preview_pixbuf_cache_add_by_name (gchar      *name)
 {
-        GdkPixbuf        *pixbuf;
-        gchar            *name;
+        CacheEntry *entry;
 
 	gl_debug (DEBUG_PIXBUF_CACHE, "START");
 
-        pixbuf = gl_mini_preview_pixbuf_new (template, 72, 72);
-
-        name = g_strdup_printf ("%s %s", template->brand, template->part);
-        g_hash_table_insert (mini_preview_pixbuf_cache, name, g_object_ref (pixbuf));
+        g_hash_table_remove (name_cache, name);
 
-        g_object_unref (pixbuf);
+        entry = lookup_entry (name);
+        if ( entry && !entry->pixbuf )
+        {
+                queue_render (entry);
+        }
 
 	gl_debug (DEBUG_PIXBUF_CACHE, "END");
 }
 
 
 /*****************************************************************************/
-/* Add pixbuf to cache by name.                                              */
+/* Delete pixbuf from cache by name.                                         */
 /*****************************************************************************/
 void
-gl_mini_preview_pixbuf_cache_add_by_name (gchar      *name)
+gl_mini_preview_pixbuf_cache_delete_by_name (gchar *name)
 {
-        lglTemplate *template;
-        GdkPixbuf   *pixbuf;
-
 	gl_debug (DEBUG_PIXBUF_CACHE, "START");
 
-        template = lgl_db_lookup_template_from_name (name);
-        pixbuf = gl_mini_preview_pixbuf_new (template, 72, 72);
-        lgl_template_free (template);
-
-        g_hash_table_insert (mini_preview_pixbuf_cache, g_strdup (name), pixbuf);
+        /* Only forget the name, the geometry entry may be shared. */
+        g_hash_table_remove (name_cache, name);
 
 	gl_debug (DEBUG_PIXBUF_CACHE, "END");
 }
 
 
 /*****************************************************************************/
-/* Delete pixbuf from cache by name.                                         */
+/* Get pixbuf, rendering it synchronously if needed.                         */
 /*****************************************************************************/
-void
-gl_mini_preview_pixbuf_cache_delete_by_name (gchar *name)
+GdkPixbuf *
+gl_mini_preview_pixbuf_cache_get_pixbuf (gchar      *name)
 {
+        CacheEntry  *entry;
+
 	gl_debug (DEBUG_PIXBUF_CACHE, "START");
 
-        g_hash_table_remove (mini_preview_pixbuf_cache, name);
+        entry = lookup_entry (name);
+        if ( !entry )
+        {
+                gl_debug (DEBUG_PIXBUF_CACHE, "END unknown template");
+                return NULL;
+        }
+        if ( !entry->pixbuf )
+        {
+                entry->pixbuf = gl_mini_preview_pixbuf_new (entry->template,
+                                                            PREVIEW_SIZE, PREVIEW_SIZE);
+        }
 
 	gl_debug (DEBUG_PIXBUF_CACHE, "END");
+
+	return g_object_ref (entry->pixbuf);
 }
 
 
 /*****************************************************************************/
-/* Get pixbuf.                                                               */
+/* Lookup pixbuf without blocking.                                           */
+/*                                                                           */
+/* Returns a new reference to the pixbuf if it is available.  Otherwise it   */
+/* returns NULL, queues the preview for rendering and calls func from the    */
+/* main loop once it is ready.  A given func/user_data pair is queued at     */
+/* most once per preview.                                                    */
 /*****************************************************************************/
 GdkPixbuf *
-gl_mini_preview_pixbuf_cache_get_pixbuf (gchar      *name)
+gl_mini_preview_pixbuf_cache_lookup (const gchar                   *name,
+                                     glMiniPreviewPixbufCacheFunc   func,
+                                     gpointer                       user_data)
 {
-	GdkPixbuf   *pixbuf;
+        CacheEntry  *entry;
+        GList       *p;
+        Waiter      *waiter;
 
-	gl_debug (DEBUG_PIXBUF_CACHE, "START pixbuf_cache=%p", mini_preview_pixbuf_cache);
+	gl_debug (DEBUG_PIXBUF_CACHE, "START");
 
-	pixbuf = g_hash_table_lookup (mini_preview_pixbuf_cache, name);
+        entry = lookup_entry (name);
+        if ( !entry )
+        {
+                gl_debug (DEBUG_PIXBUF_CACHE, "END unknown template");
+                return NULL;
+        }
+        if ( entry->pixbuf )
+        {
+                gl_debug (DEBUG_PIXBUF_CACHE, "END hit");
+                return g_object_ref (entry->pixbuf);
+        }
 
-        if (!pixbuf)
+        if ( func )
         {
-                gl_mini_preview_pixbuf_cache_add_by_name (name);
-                pixbuf = g_hash_table_lookup (mini_preview_pixbuf_cache, name);
+                for ( p = entry->waiters; p != NULL; p = p->next )
+                {
+                        waiter = (Waiter *)p->data;
+                        if ( (waiter->func == func) && (waiter->user_data == user_data) )
+                        {
+                                break;
+                        }
+                }
+                if ( p == NULL )
+                {
+                        waiter = g_new0 (Waiter, 1);
+                        waiter->func      = func;
+                        waiter->user_data = user_data;
+                        entry->waiters = g_list_prepend (entry->waiters, waiter);
+                }
+        }
+
+        queue_render (entry);
+
+	gl_debug (DEBUG_PIXBUF_CACHE, "END miss");
+
+        return NULL;
+}
+
+
+/*****************************************************************************/
+/* Cancel all pending notifications for func/user_data.                      */
+/*****************************************************************************/
+void
+gl_mini_preview_pixbuf_cache_cancel (glMiniPreviewPixbufCacheFunc   func,
+                                     gpointer                       user_data)
+{
+        GHashTableIter  iter;
+        CacheEntry     *entry;
+        GList          *p, *p_next;
+        Waiter         *waiter;
+
+	gl_debug (DEBUG_PIXBUF_CACHE, "START");
+
+        g_hash_table_iter_init (&iter, entry_cache);
+        while ( g_hash_table_iter_next (&iter, NULL, (gpointer *)&entry) )
+        {
+                for ( p = entry->waiters; p != NULL; p = p_next )
+                {
+                        p_next = p->next;
+                        waiter = (Waiter *)p->data;
+                        if ( (waiter->func == func) && (waiter->user_data == user_data) )
+                        {
+                                entry->waiters = g_list_delete_link (entry->waiters, p);
+                                g_free (waiter);
+                        }
+                }
         }
 
 	gl_debug (DEBUG_PIXBUF_CACHE, "END");
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Build hash of everything that affects the look of a preview.    */
+/* Includes every field compared by lgl_template_are_templates_identical(),  */
+/* exactly, so that templates with equal keys are identical.                 */
+/*---------------------------------------------------------------------------*/
+static gchar *
+geometry_key (const lglTemplate *template)
+{
+        const lglTemplateFrame  *frame;
+        GString                 *s;
+        GList                   *p;
+        lglTemplateLayout       *layout;
+        gchar                    buf[G_ASCII_DTOSTR_BUF_SIZE];
+        gchar                   *key;
+
+        frame = (lglTemplateFrame *)template->frames->data;
+
+        s = g_string_new (NULL);
+
+#define APPEND_DOUBLE(x) \
+        g_string_append_c (s, ' '); \
+        g_string_append (s, g_ascii_dtostr (buf, sizeof(buf), (x)))
+
+        g_string_append_printf (s, "v%d %d", CACHE_VERSION, PREVIEW_SIZE);
+        g_string_append_printf (s, " paper=%s", template->paper_id ? template->paper_id : "");
+        APPEND_DOUBLE (template->page_width);
+        APPEND_DOUBLE (template->page_height);
+
+        g_string_append_printf (s, " shape=%d", frame->shape);
+        switch ( frame->shape )
+        {
+        case LGL_TEMPLATE_FRAME_SHAPE_RECT:
+                APPEND_DOUBLE (frame->rect.w);
+                APPEND_DOUBLE (frame->rect.h);
+                APPEND_DOUBLE (frame->rect.r);
+                break;
+        case LGL_TEMPLATE_FRAME_SHAPE_ELLIPSE:
+                APPEND_DOUBLE (frame->ellipse.w);
+                APPEND_DOUBLE (frame->ellipse.h);
+                break;
+        case LGL_TEMPLATE_FRAME_SHAPE_ROUND:
+                APPEND_DOUBLE (frame->round.r);
+                break;
+        case LGL_TEMPLATE_FRAME_SHAPE_CD:
+                APPEND_DOUBLE (frame->cd.r1);
+                APPEND_DOUBLE (frame->cd.r2);
+                APPEND_DOUBLE (frame->cd.w);
+                APPEND_DOUBLE (frame->cd.h);
+                break;
+        }
+
+        for ( p = frame->all.layouts; p != NULL; p = p->next )
+        {
+                layout = (lglTemplateLayout *)p->data;
+                g_string_append_printf (s, " layout=%dx%d", layout->nx, layout->ny);
+                APPEND_DOUBLE (layout->x0);
+                APPEND_DOUBLE (layout->y0);
+                APPEND_DOUBLE (layout->dx);
+                APPEND_DOUBLE (layout->dy);
+        }
+
+#undef APPEND_DOUBLE
+
+        key = g_compute_checksum_for_string (G_CHECKSUM_SHA1, s->str, s->len);
+        g_string_free (s, TRUE);
+
+        return key;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Find or create entry for template name.  Returns NULL if there  */
+/* is no such template.                                                      */
+/*---------------------------------------------------------------------------*/
+static CacheEntry *
+lookup_entry (const gchar *name)
+{
+        CacheEntry  *entry;
+        lglTemplate *template;
+        gchar       *base_key;
+        gchar       *key;
+        gint         i;
+
+        entry = g_hash_table_lookup (name_cache, name);
+        if ( entry )
+        {
+                return entry;
+        }
+
+        template = lgl_db_lookup_template_from_name (name);
+        if ( template == NULL )
+        {
+                return NULL;
+        }
+
+        base_key = geometry_key (template);
+
+        /*
+         * Entries are never evicted, they may still be shown or waited on.  On
+         * a hash collision, probe "key-1", "key-2", ... for an identical
+         * template or a free slot.
+         */
+        for ( i = 0; ; i++ )
+        {
+                key   = (i == 0) ? g_strdup (base_key) : g_strdup_printf ("%s-%d", base_key, i);
+                entry = g_hash_table_lookup (entry_cache, key);
+
+                if ( (entry == NULL) || lgl_template_are_templates_identical (entry->template, template) )
+                {
+                        break;
+                }
+                g_free (key);
+        }
+
+        if ( entry )
+        {
+                gl_debug (DEBUG_PIXBUF_CACHE, "\"%s\" shares preview %s", name, key);
+                g_free (key);
+                lgl_template_free (template);
+        }
+        else
+        {
+                entry = g_new0 (CacheEntry, 1);
+                entry->key       = key;
+                entry->template  = template;
+
+                /* Probed slots depend on lookup order, not safe across sessions. */
+                entry->disk_flag = (i == 0);
+
+                g_hash_table_insert (entry_cache, entry->key, entry);
+        }
+        g_free (base_key);
+
+        g_hash_table_insert (name_cache, g_strdup (name), entry);
+
+        return entry;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Free cache entry.                                               */
+/*---------------------------------------------------------------------------*/
+static void
+cache_entry_free (CacheEntry *entry)
+{
+        if ( entry->pending )
+        {
+                /* Job still holds a pointer to us; it will finish the cleanup. */
+                g_free (entry->key);
+                entry->key = NULL;
+                return;
+        }
+
+        g_free (entry->key);
+        lgl_template_free (entry->template);
+        if ( entry->pixbuf )
+        {
+                g_object_unref (entry->pixbuf);
+        }
+        g_list_free_full (entry->waiters, g_free);
+        g_free (entry);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Queue render job for entry, unless one is already queued.       */
+/*---------------------------------------------------------------------------*/
+static void
+queue_render (CacheEntry *entry)
+{
+        RenderJob *job;
+
+        if ( entry->pending )
+        {
+                return;
+        }
+
+        job = g_new0 (RenderJob, 1);
+        job->entry    = entry;
+        job->template = lgl_template_dup (entry->template);
+        if ( cache_dir && entry->disk_flag )
+        {
+                gchar *basename = g_strdup_printf ("%s.png", entry->key);
+                job->filename = g_build_filename (cache_dir, basename, NULL);
+                g_free (basename);
+        }
+
+        entry->pending = TRUE;
+        g_thread_pool_push (render_pool, job, NULL);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Worker thread: load preview from disk, or render and save it.   */
+/*---------------------------------------------------------------------------*/
+static void
+render_job_func (RenderJob *job,
+                 gpointer   user_data)
+{
+        gchar  *buffer;
+        gsize   buffer_size;
+        GError *error = NULL;
+
+        if ( job->filename )
+        {
+                job->pixbuf = gdk_pixbuf_new_from_file (job->filename, NULL);
+                if ( job->pixbuf &&
+                     ((gdk_pixbuf_get_width (job->pixbuf)  != PREVIEW_SIZE) ||
+                      (gdk_pixbuf_get_height (job->pixbuf) != PREVIEW_SIZE)) )
+                {
+                        g_object_unref (job->pixbuf);
+                        job->pixbuf = NULL;
+                }
+        }
+
+        if ( !job->pixbuf )
+        {
+                job->pixbuf = gl_mini_preview_pixbuf_new (job->template,
+                                                          PREVIEW_SIZE, PREVIEW_SIZE);
+
+                if ( job->filename &&
+                     gdk_pixbuf_save_to_buffer (job->pixbuf, &buffer, &buffer_size,
+                                                "png", &error, NULL) )
+                {
+                        /* g_file_set_contents() is atomic, so concurrent glabels
+                         * instances never see a partially written file. */
+                        g_file_set_contents (job->filename, buffer, buffer_size, &error);
+                        g_free (buffer);
+                }
+                if ( error )
+                {
+                        g_message ("Cannot save mini preview \"%s\": %s",
+                                   job->filename, error->message);
+                        g_error_free (error);
+                }
+        }
+
+        g_idle_add ((GSourceFunc)render_job_done, job);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Main loop: install rendered pixbuf and notify waiters.          */
+/*---------------------------------------------------------------------------*/
+static gboolean
+render_job_done (RenderJob *job)
+{
+        CacheEntry *entry = job->entry;
+        GList      *waiters, *p;
+        Waiter     *waiter;
+
+        gl_debug (DEBUG_PIXBUF_CACHE, "START");
+
+        if ( entry->key == NULL )
+        {
+                /* Entry was dropped from the cache while we were busy. */
+                entry->pending = FALSE;
+                cache_entry_free (entry);
+        }
+        else
+        {
+                entry->pending = FALSE;
+                if ( !entry->pixbuf )
+                {
+                        entry->pixbuf = g_object_ref (job->pixbuf);
+                }
+
+                waiters = entry->waiters;
+                entry->waiters = NULL;
+                for ( p = waiters; p != NULL; p = p->next )
+                {
+                        waiter = (Waiter *)p->data;
+                        waiter->func (entry->pixbuf, waiter->user_data);
+                }
+                g_list_free_full (waiters, g_free);
+        }
+
+        g_object_unref (job->pixbuf);
+        lgl_template_free (job->template);
+        g_free (job->filename);
+        g_free (job);
+
+        gl_debug (DEBUG_PIXBUF_CACHE, "END");
 
-	return g_object_ref (pixbuf);
+        return FALSE;
 }
 
 
@@ -26,15 +26,24 @@
 
 G_BEGIN_DECLS
 
+typedef void (*glMiniPreviewPixbufCacheFunc) (GdkPixbuf *pixbuf,
+                                              gpointer   user_data);
+
 void        gl_mini_preview_pixbuf_cache_init            (void);
 
 void        gl_mini_preview_pixbuf_cache_add_by_name     (gchar       *name);
-void        gl_mini_preview_pixbuf_cache_add_by_template (lglTemplate *template);
 
 void        gl_mini_preview_pixbuf_cache_delete_by_name  (gchar       *name);
 
 GdkPixbuf  *gl_mini_preview_pixbuf_cache_get_pixbuf      (gchar       *name);
 
+GdkPixbuf  *gl_mini_preview_pixbuf_cache_lookup          (const gchar                  *name,
+                                                          glMiniPreviewPixbufCacheFunc  func,
+                                                          gpointer                      user_data);
+
+void        gl_mini_preview_pixbuf_cache_cancel          (glMiniPreviewPixbufCacheFunc  func,
+                                                          gpointer                      user_data);
+
 
 G_END_DECLS
 
@@ -23,6 +23,7 @@
 #include "mini-preview.h"
 
 #include <math.h>
+#include <string.h>
 #include <glib/gi18n.h>
 
 #include <libglabels.h>
@@ -61,6 +62,39 @@ typedef struct {
         gdouble y;
 } LabelCenter;
 
+/*
+ * Everything a rich preview render depends on, besides the label itself.
+ * Only gint members, so that instances can be compared with memcmp().
+ */
+typedef struct {
+        gint            width;
+        gint            height;
+        gint            scale_factor;
+        gint            page;
+        gint            n_sheets;
+        gint            n_copies;
+        gint            first;
+        gint            last;
+        gboolean        collate_flag;
+        gboolean        outline_flag;
+        gboolean        reverse_flag;
+        gboolean        crop_marks_flag;
+} RichParams;
+
+/*
+ * Rich preview render job.  The worker thread only touches the private
+ * label copy and the surface; the widget is only dereferenced in
+ * rich_job_done(), back in the main loop.
+ */
+typedef struct {
+        glMiniPreview   *this;
+        RichParams       params;
+        cairo_matrix_t   matrix;
+        glLabel         *label;
+        cairo_surface_t *surface;
+        GCancellable    *cancellable;
+} RichJob;
+
 struct _glMiniPreviewPrivate {
 
         GtkWidget      *canvas;
@@ -92,6 +126,11 @@ struct _glMiniPreviewPrivate {
         gboolean        outline_flag;
         gboolean        reverse_flag;
         gboolean        crop_marks_flag;
+
+        /* Rich preview, rendered in the background.  See draw_rich_preview(). */
+        cairo_surface_t *rich_surface;
+        RichParams       rich_surface_params;
+        RichJob         *rich_job;
 };
 
 
@@ -101,6 +140,8 @@ struct _glMiniPreviewPrivate {
 
 static gint mini_preview_signals[LAST_SIGNAL] = { 0 };
 
+static GThreadPool *rich_pool = NULL;
+
 
 /*===========================================*/
 /* Local function prototypes                 */
@@ -152,11 +193,26 @@ static void     draw_arrow                     (glMiniPreview          *this,
 static void     draw_rich_preview              (glMiniPreview          *this,
                                                 cairo_t                *cr);
 
+static void     get_rich_params                (glMiniPreview          *this,
+                                                RichParams             *params);
+static gboolean rich_preview_is_current        (glMiniPreview          *this);
+static void     invalidate_rich_preview        (glMiniPreview          *this);
+static void     queue_rich_preview             (glMiniPreview          *this,
+                                                const RichParams       *params);
+static void     rich_job_func                  (RichJob                *job,
+                                                gpointer                user_data);
+static gboolean rich_job_done                  (RichJob                *job);
+static void     render_rich_preview            (glLabel                *label,
+                                                cairo_t                *cr,
+                                                const RichParams       *params);
+
 
 static gint     find_closest_label             (glMiniPreview          *this,
                                                 gdouble                 x,
                                                 gdouble                 y);
 
+static gdouble  get_transform                  (glMiniPreview          *this,
+                                                cairo_matrix_t         *matrix);
 static gdouble  set_transform_and_get_scale    (glMiniPreview          *this,
                                                 cairo_t                *cr);
 
@@ -265,6 +321,10 @@ gl_mini_preview_finalize (GObject *object)
         }
         lgl_template_free (this->priv->template);
         g_free (this->priv->centers);
+        if (this->priv->rich_surface)
+        {
+                cairo_surface_destroy (this->priv->rich_surface);
+        }
         g_free (this->priv);
 
         G_OBJECT_CLASS (gl_mini_preview_parent_class)->finalize (object);
@@ -376,6 +436,7 @@ gl_mini_preview_set_template (glMiniPreview     *this,
         /*
          * Redraw modified preview
          */
+        invalidate_rich_preview (this);
         redraw (this);
 
         gl_debug (DEBUG_MINI_PREVIEW, "END");
@@ -449,6 +510,7 @@ gl_mini_preview_set_label (glMiniPreview     *this,
                 g_object_unref (this->priv->label);
         }
         this->priv->label = g_object_ref (label);
+        invalidate_rich_preview (this);
         redraw (this);
 }
 
@@ -594,6 +656,23 @@ gl_mini_preview_set_crop_marks_flag (glMiniPreview     *this,
 static gdouble
 set_transform_and_get_scale (glMiniPreview *this,
                              cairo_t       *cr)
+{
+        cairo_matrix_t matrix;
+        gdouble        scale;
+
+        scale = get_transform (this, &matrix);
+        cairo_transform (cr, &matrix);
+
+        return scale;
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* Get transformation from sheet to widget coordinates, and return scale.   */
+/*--------------------------------------------------------------------------*/
+static gdouble
+get_transform (glMiniPreview  *this,
+               cairo_matrix_t *matrix)
 {
         lglTemplate   *template = this->priv->template;
         GtkAllocation  allocation;
@@ -615,8 +694,8 @@ set_transform_and_get_scale (glMiniPreview *this,
         offset_y = (h/scale - template->page_height) / 2.0;
 
         /* Set transformation. */
-        cairo_scale (cr, scale, scale);
-        cairo_translate (cr, offset_x, offset_y);
+        cairo_matrix_init_scale (matrix, scale, scale);
+        cairo_matrix_translate (matrix, offset_x, offset_y);
 
         return scale;
 }
@@ -862,6 +941,8 @@ draw (glMiniPreview  *this,
         if (template)
         {
 
+                cairo_save (cr);
+
                 scale = set_transform_and_get_scale (this, cr);
 
                 /* update shadow */
@@ -883,6 +964,8 @@ draw (glMiniPreview  *this,
                         draw_arrow (this, cr);
                 }
 
+                cairo_restore (cr);
+
                 if (this->priv->label)
                 {
                         draw_rich_preview (this, cr);
@@ -990,9 +1073,9 @@ draw_labels (glMiniPreview *this,
         base_color      = gl_color_from_gdk_color (&style->base[GTK_STATE_SELECTED]);
 
         highlight_color = gl_color_set_opacity (base_color, 0.10);
-        if (this->priv->label)
+        if ( rich_preview_is_current (this) )
         {
-                /* Outlines are more subtle when doing a rich preview. */
+                /* Outlines are more subtle when showing a rich preview. */
                 outline_color   = gl_color_set_opacity (base_color, 0.25);
         }
         else
@@ -1116,27 +1199,243 @@ draw_arrow  (glMiniPreview      *this,
 
 /*--------------------------------------------------------------------------*/
 /* Draw rich preview using print renderers.                                 */
+/*                                                                          */
+/* Rendering full labels (images, barcodes, merge data) can take a long     */
+/* time, so it is done in a background thread on a private copy of the     */
+/* label.  Until the result for the current settings is available only the  */
+/* label outlines are shown.                                                */
 /*--------------------------------------------------------------------------*/
 static void
 draw_rich_preview (glMiniPreview          *this,
                    cairo_t                *cr)
+{
+        RichParams  params;
+
+        get_rich_params (this, &params);
+
+        if ( this->priv->rich_surface &&
+             !memcmp (&params, &this->priv->rich_surface_params, sizeof (RichParams)) )
+        {
+                cairo_save (cr);
+                cairo_set_source_surface (cr, this->priv->rich_surface, 0, 0);
+                cairo_paint (cr);
+                cairo_restore (cr);
+        }
+        else if ( !this->priv->rich_job ||
+                  memcmp (&params, &this->priv->rich_job->params, sizeof (RichParams)) )
+        {
+                queue_rich_preview (this, &params);
+        }
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* Get current rich preview parameters.                                     */
+/*--------------------------------------------------------------------------*/
+static void
+get_rich_params (glMiniPreview          *this,
+                 RichParams             *params)
+{
+        GtkAllocation  allocation;
+
+        gtk_widget_get_allocation (GTK_WIDGET (this), &allocation);
+
+        memset (params, 0, sizeof (RichParams));
+
+        params->width           = allocation.width;
+        params->height          = allocation.height;
+        params->scale_factor    = gtk_widget_get_scale_factor (GTK_WIDGET (this));
+        params->page            = this->priv->page;
+        params->n_sheets        = this->priv->n_sheets;
+        params->n_copies        = this->priv->n_copies;
+        params->first           = this->priv->first;
+        params->last            = this->priv->last;
+        params->collate_flag    = this->priv->collate_flag;
+        params->outline_flag    = this->priv->outline_flag;
+        params->reverse_flag    = this->priv->reverse_flag;
+        params->crop_marks_flag = this->priv->crop_marks_flag;
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* Is a rich preview for the current parameters available?                  */
+/*--------------------------------------------------------------------------*/
+static gboolean
+rich_preview_is_current (glMiniPreview          *this)
+{
+        RichParams  params;
+
+        if ( !this->priv->label || !this->priv->rich_surface )
+        {
+                return FALSE;
+        }
+
+        get_rich_params (this, &params);
+
+        return !memcmp (&params, &this->priv->rich_surface_params, sizeof (RichParams));
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* Drop rich preview and cancel any job in flight (label or template        */
+/* changed).                                                                */
+/*--------------------------------------------------------------------------*/
+static void
+invalidate_rich_preview (glMiniPreview          *this)
+{
+        if ( this->priv->rich_surface )
+        {
+                cairo_surface_destroy (this->priv->rich_surface);
+                this->priv->rich_surface = NULL;
+        }
+
+        if ( this->priv->rich_job )
+        {
+                g_cancellable_cancel (this->priv->rich_job->cancellable);
+                this->priv->rich_job = NULL;
+        }
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* Queue rich preview render job, superseding any job in flight.            */
+/*--------------------------------------------------------------------------*/
+static void
+queue_rich_preview (glMiniPreview          *this,
+                    const RichParams       *params)
+{
+        GdkWindow *window;
+        RichJob   *job;
+
+        gl_debug (DEBUG_MINI_PREVIEW, "START");
+
+        if ( this->priv->rich_job )
+        {
+                /* A job that has not started yet will be skipped by the worker. */
+                g_cancellable_cancel (this->priv->rich_job->cancellable);
+                this->priv->rich_job = NULL;
+        }
+
+        window = gtk_widget_get_window (this->priv->canvas);
+        if ( !window || (params->width <= 0) || (params->height <= 0) )
+        {
+                gl_debug (DEBUG_MINI_PREVIEW, "END (not realized)");
+                return;
+        }
+
+        if ( !rich_pool )
+        {
+                /* One worker: superseded jobs are skipped, not run in parallel. */
+                rich_pool = g_thread_pool_new ((GFunc)rich_job_func, NULL,
+                                               1, FALSE, NULL);
+        }
+
+        job = g_new0 (RichJob, 1);
+        job->this        = g_object_ref (this);
+        job->params      = *params;
+        job->label       = gl_label_dup (this->priv->label);
+        job->surface     = gdk_window_create_similar_image_surface (window,
+                                                                    CAIRO_FORMAT_ARGB32,
+                                                                    params->width,
+                                                                    params->height,
+                                                                    0);
+        job->cancellable = g_cancellable_new ();
+        get_transform (this, &job->matrix);
+
+        this->priv->rich_job = job;
+        g_thread_pool_push (rich_pool, job, NULL);
+
+        gl_debug (DEBUG_MINI_PREVIEW, "END");
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* Worker thread: render rich preview into job's surface.                   */
+/*--------------------------------------------------------------------------*/
+static void
+rich_job_func (RichJob                *job,
+               gpointer                user_data)
+{
+        cairo_t *cr;
+
+        if ( !g_cancellable_is_cancelled (job->cancellable) )
+        {
+                cr = cairo_create (job->surface);
+                cairo_transform (cr, &job->matrix);
+
+                /* Stop between labels as soon as the job is superseded. */
+                gl_print_set_cancellable (cr, job->cancellable);
+
+                render_rich_preview (job->label, cr, &job->params);
+
+                cairo_destroy (cr);
+        }
+
+        g_idle_add ((GSourceFunc)rich_job_done, job);
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* Main loop: swap in rendered preview, unless job has been superseded.     */
+/*--------------------------------------------------------------------------*/
+static gboolean
+rich_job_done (RichJob                *job)
+{
+        glMiniPreview *this = job->this;
+
+        gl_debug (DEBUG_MINI_PREVIEW, "START");
+
+        if ( (job == this->priv->rich_job) &&
+             !g_cancellable_is_cancelled (job->cancellable) )
+        {
+                this->priv->rich_job = NULL;
+
+                if ( this->priv->rich_surface )
+                {
+                        cairo_surface_destroy (this->priv->rich_surface);
+                }
+                this->priv->rich_surface        = cairo_surface_reference (job->surface);
+                this->priv->rich_surface_params = job->params;
+
+                redraw (this);
+        }
+
+        g_object_unref (job->label);
+        cairo_surface_destroy (job->surface);
+        g_object_unref (job->cancellable);
+        g_object_unref (job->this);
+        g_free (job);
+
+        gl_debug (DEBUG_MINI_PREVIEW, "END");
+
+        return FALSE;
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* Render rich preview of label (any thread).                               */
+/*--------------------------------------------------------------------------*/
+static void
+render_rich_preview (glLabel                *label,
+                     cairo_t                *cr,
+                     const RichParams       *params)
 {
         glMerge      *merge;
         glPrintState  state;
 
-        merge = gl_label_get_merge (this->priv->label);
+        merge = gl_label_get_merge (label);
 
         if (!merge)
         {
-                gl_print_simple_sheet (this->priv->label,
+                gl_print_simple_sheet (label,
                                        cr,
-                                       this->priv->page,
-                                       this->priv->n_sheets,
-                                       this->priv->first,
-                                       this->priv->last,
-                                       this->priv->outline_flag,
-                                       this->priv->reverse_flag,
-                                       this->priv->crop_marks_flag);
+                                       params->page,
+                                       params->n_sheets,
+                                       params->first,
+                                       params->last,
+                                       params->outline_flag,
+                                       params->reverse_flag,
+                                       params->crop_marks_flag);
         }
         else
         {
@@ -1148,35 +1447,36 @@ draw_rich_preview (glMiniPreview          *this,
                 state.i_copy = 0;
                 state.p_record = (GList *)gl_merge_get_record_list (merge);
 
-                if (this->priv->collate_flag)
+                if (params->collate_flag)
                 {
-                        gl_print_collated_merge_sheet (this->priv->label,
+                        gl_print_collated_merge_sheet (label,
                                                        cr,
-                                                       this->priv->page,
-                                                       this->priv->n_copies,
-                                                       this->priv->first,
-                                                       this->priv->outline_flag,
-                                                       this->priv->reverse_flag,
-                                                       this->priv->crop_marks_flag,
+                                                       params->page,
+                                                       params->n_copies,
+                                                       params->first,
+                                                       params->outline_flag,
+                                                       params->reverse_flag,
+                                                       params->crop_marks_flag,
                                                        &state);
                 }
                 else
                 {
-                        gl_print_uncollated_merge_sheet (this->priv->label,
+                        gl_print_uncollated_merge_sheet (label,
                                                          cr,
-                                                         this->priv->page,
-                                                         this->priv->n_copies,
-                                                         this->priv->first,
-                                                         this->priv->outline_flag,
-                                                         this->priv->reverse_flag,
-                                                         this->priv->crop_marks_flag,
+                                                         params->page,
+                                                         params->n_copies,
+                                                         params->first,
+                                                         params->outline_flag,
+                                                         params->reverse_flag,
+                                                         params->crop_marks_flag,
                                                          &state);
                 }
+
+                g_object_unref (merge);
         }
 }
 
 
-
 /*
  * Local Variables:       -- emacs
  * mode: C                -- emacs
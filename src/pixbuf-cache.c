@@ -22,17 +22,31 @@
 
 #include "pixbuf-cache.h"
 
+#include <string.h>
+#include <gdk/gdk.h>
+
 #include "debug.h"
 
 
+/*========================================================*/
+/* Private macros and constants.                          */
+/*========================================================*/
+
+/* Formats whose original file data is kept, and embedded as-is when saving. */
+static const gchar *embed_formats[] = { "png", "jpeg", "gif", "bmp", "tiff", NULL };
+
+
 /*========================================================*/
 /* Private types.                                         */
 /*========================================================*/
 
 typedef struct {
-	gchar     *key;
-	guint      references;
-	GdkPixbuf *pixbuf;
+	gchar           *key;
+	guint            references;
+	GdkPixbuf       *pixbuf;      /* NULL until decoded from data. */
+	GBytes          *data;        /* Encoded image, e.g. original PNG or JPEG file. */
+	gchar           *format;      /* GdkPixbuf format name of data (e.g. "jpeg"). */
+	cairo_surface_t *surface;     /* Premultiplied pixbuf for drawing, NULL until drawn. */
 } CacheRecord;
 
 
@@ -45,11 +59,20 @@ typedef struct {
 /* Private function prototypes.                           */
 /*========================================================*/
 
-static void  record_destroy   (gpointer val);
+static void       record_destroy   (gpointer     val);
+
+static GdkPixbuf *decode_data      (GBytes      *data,
+				    gchar      **format);
+
+static gboolean   is_embed_format  (const gchar *format);
 
-static void  add_name_to_list (gpointer key,
-			       gpointer val,
-			       gpointer user_data);
+static void       set_mime_data    (cairo_surface_t *surface,
+				    GBytes      *data,
+				    const gchar *format);
+
+static void       add_name_to_list (gpointer     key,
+				    gpointer     val,
+				    gpointer     user_data);
 
 
 /*---------------------------------------------------------------------------*/
@@ -63,11 +86,104 @@ record_destroy (gpointer val)
 	g_return_if_fail (record);
 
 	g_free (record->key);
-	g_object_unref (record->pixbuf);
+	if ( record->pixbuf ) {
+		g_object_unref (record->pixbuf);
+	}
+	if ( record->data ) {
+		g_bytes_unref (record->data);
+	}
+	g_free (record->format);
+	if ( record->surface ) {
+		cairo_surface_destroy (record->surface);
+	}
 	g_free (record);
 }
 
 
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Decode encoded image data, optionally returning its format.     */
+/*---------------------------------------------------------------------------*/
+static GdkPixbuf *
+decode_data (GBytes  *data,
+	     gchar  **format)
+{
+	GdkPixbufLoader *loader;
+	GdkPixbuf       *pixbuf = NULL;
+	gconstpointer    buffer;
+	gsize            size;
+	gboolean         ok;
+
+	GL_TRACE_BEGIN ("pixbuf decode");
+
+	loader = gdk_pixbuf_loader_new ();
+
+	buffer = g_bytes_get_data (data, &size);
+	ok = gdk_pixbuf_loader_write (loader, buffer, size, NULL);
+	ok = gdk_pixbuf_loader_close (loader, NULL) && ok;
+
+	GL_TRACE_END ("pixbuf decode");
+	GL_TRACE_HISTOGRAM ("pixbuf decode bytes", size);
+
+	if ( ok && (gdk_pixbuf_loader_get_pixbuf (loader) != NULL) ) {
+		pixbuf = g_object_ref (gdk_pixbuf_loader_get_pixbuf (loader));
+
+		if ( format != NULL ) {
+			*format = gdk_pixbuf_format_get_name (gdk_pixbuf_loader_get_format (loader));
+		}
+	}
+
+	g_object_unref (loader);
+
+	return pixbuf;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Is original data of this format worth keeping?                  */
+/*---------------------------------------------------------------------------*/
+static gboolean
+is_embed_format (const gchar *format)
+{
+	gint i;
+
+	for ( i = 0; (format != NULL) && (embed_formats[i] != NULL); i++ ) {
+		if ( strcmp (format, embed_formats[i]) == 0 ) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Attach original JPEG or PNG data to surface, so that backends   */
+/* that can (e.g. PDF for JPEG) embed the compressed image as is.            */
+/*---------------------------------------------------------------------------*/
+static void
+set_mime_data (cairo_surface_t *surface,
+	       GBytes          *data,
+	       const gchar     *format)
+{
+	const gchar   *mime_type;
+	gconstpointer  buffer;
+	gsize          size;
+
+	if ( g_strcmp0 (format, "jpeg") == 0 ) {
+		mime_type = CAIRO_MIME_TYPE_JPEG;
+	} else if ( g_strcmp0 (format, "png") == 0 ) {
+		mime_type = CAIRO_MIME_TYPE_PNG;
+	} else {
+		return;
+	}
+
+	buffer = g_bytes_get_data (data, &size);
+	cairo_surface_set_mime_data (surface, mime_type, buffer, size,
+				     (cairo_destroy_func_t)g_bytes_unref,
+				     g_bytes_ref (data));
+}
+
+
 /*****************************************************************************/
 /* Create a new hash table to keep track of cached pixbufs.                  */
 /*****************************************************************************/
@@ -133,6 +249,47 @@ gl_pixbuf_cache_add_pixbuf (GHashTable *pixbuf_cache,
 }
 
 
+/*****************************************************************************/
+/* Add encoded image data to cache explicitly (not a reference).  Data is    */
+/* only decoded when the pixbuf is first needed.  If the image is already    */
+/* cached without encoded data, the data is attached to it.                  */
+/*****************************************************************************/
+void
+gl_pixbuf_cache_add_data (GHashTable  *pixbuf_cache,
+			  gchar       *name,
+			  GBytes      *data,
+			  const gchar *format)
+{
+	CacheRecord *test_record, *record;
+
+	gl_debug (DEBUG_PIXBUF_CACHE, "START");
+
+	test_record = g_hash_table_lookup (pixbuf_cache, name);
+	if (test_record != NULL) {
+		/* image is already in the cache. */
+		if ( test_record->data == NULL ) {
+			test_record->data   = g_bytes_ref (data);
+			test_record->format = g_strdup (format);
+			if ( test_record->surface != NULL ) {
+				set_mime_data (test_record->surface, data, format);
+			}
+		}
+		gl_debug (DEBUG_PIXBUF_CACHE, "END already in cache");
+		return;
+	}
+
+	record = g_new0 (CacheRecord, 1);
+	record->key        = g_strdup (name);
+	record->references = 0; /* Nobody has referenced it yet. */
+	record->data       = g_bytes_ref (data);
+	record->format     = g_strdup (format);
+
+	g_hash_table_insert (pixbuf_cache, record->key, record);
+
+	gl_debug (DEBUG_PIXBUF_CACHE, "END");
+}
+
+
 /*****************************************************************************/
 /* Get pixbuf.  If not in cache, read it and add to cache.                   */
 /*****************************************************************************/
@@ -141,13 +298,25 @@ gl_pixbuf_cache_get_pixbuf (GHashTable *pixbuf_cache,
 			    gchar      *name)
 {
 	CacheRecord *record;
-	GdkPixbuf   *pixbuf;
+	GdkPixbuf   *pixbuf = NULL;
+	gchar       *contents;
+	gsize        length;
+	GBytes      *data;
+	gchar       *format = NULL;
 
 	gl_debug (DEBUG_PIXBUF_CACHE, "START pixbuf_cache=%p", pixbuf_cache);
 
 	record = g_hash_table_lookup (pixbuf_cache, name);
 
 	if (record != NULL) {
+		GL_TRACE_COUNT ("pixbuf cache hits", 1);
+		if ( record->pixbuf == NULL ) {
+			record->pixbuf = decode_data (record->data, NULL);
+			if ( record->pixbuf == NULL ) {
+				gl_debug (DEBUG_PIXBUF_CACHE, "END cannot decode");
+				return NULL;
+			}
+		}
 		record->references++;
 		gl_debug (DEBUG_PIXBUF_CACHE, "references=%d", record->references);
 		gl_debug (DEBUG_PIXBUF_CACHE, "END cached");
@@ -155,14 +324,29 @@ gl_pixbuf_cache_get_pixbuf (GHashTable *pixbuf_cache,
 	}
 
 
-	pixbuf = gdk_pixbuf_new_from_file (name, NULL);
-	if ( pixbuf != NULL) {
-		record = g_new0 (CacheRecord, 1);
-		record->key        = g_strdup (name);
-		record->references = 1;
-		record->pixbuf     = pixbuf;
+	GL_TRACE_COUNT ("pixbuf cache misses", 1);
+
+	if ( g_file_get_contents (name, &contents, &length, NULL) ) {
+		data   = g_bytes_new_take (contents, length);
+		pixbuf = decode_data (data, &format);
 
-		g_hash_table_insert (pixbuf_cache, record->key, record);
+		if ( pixbuf != NULL) {
+			record = g_new0 (CacheRecord, 1);
+			record->key        = g_strdup (name);
+			record->references = 1;
+			record->pixbuf     = pixbuf;
+
+			/* Keep original file, so it can be embedded as-is. */
+			if ( is_embed_format (format) ) {
+				record->data   = g_bytes_ref (data);
+				record->format = g_strdup (format);
+			}
+
+			g_hash_table_insert (pixbuf_cache, record->key, record);
+		}
+
+		g_bytes_unref (data);
+		g_free (format);
 	}
 
 	gl_debug (DEBUG_PIXBUF_CACHE, "END");
@@ -171,6 +355,83 @@ gl_pixbuf_cache_get_pixbuf (GHashTable *pixbuf_cache,
 }
 
 
+/*****************************************************************************/
+/* Get image as a premultiplied cairo surface (not a reference), for         */
+/* drawing.  The surface is converted from the pixbuf once, and shared by    */
+/* all draws of the image.  It carries the original JPEG or PNG data, if     */
+/* any.                                                                      */
+/*****************************************************************************/
+cairo_surface_t *
+gl_pixbuf_cache_get_surface (GHashTable *pixbuf_cache,
+			     gchar      *name)
+{
+	CacheRecord *record;
+
+	gl_debug (DEBUG_PIXBUF_CACHE, "START");
+
+	record = g_hash_table_lookup (pixbuf_cache, name);
+	if (record == NULL) {
+		gl_debug (DEBUG_PIXBUF_CACHE, "END not in cache");
+		return NULL;
+	}
+
+	if ( record->surface == NULL ) {
+		if ( record->pixbuf == NULL ) {
+			record->pixbuf = decode_data (record->data, NULL);
+			if ( record->pixbuf == NULL ) {
+				gl_debug (DEBUG_PIXBUF_CACHE, "END cannot decode");
+				return NULL;
+			}
+		}
+
+		record->surface = gdk_cairo_surface_create_from_pixbuf (record->pixbuf, 1, NULL);
+		if ( record->data != NULL ) {
+			set_mime_data (record->surface, record->data, record->format);
+		}
+	}
+
+	gl_debug (DEBUG_PIXBUF_CACHE, "END");
+
+	return record->surface;
+}
+
+
+/*****************************************************************************/
+/* Get encoded image data (not a reference), for embedding in documents.     */
+/* Images that were not read from a file in a suitable format are encoded    */
+/* as PNG, once.                                                             */
+/*****************************************************************************/
+GBytes *
+gl_pixbuf_cache_get_data (GHashTable   *pixbuf_cache,
+			  gchar        *name,
+			  const gchar **format)
+{
+	CacheRecord *record;
+	gchar       *buffer;
+	gsize        buffer_size;
+
+	gl_debug (DEBUG_PIXBUF_CACHE, "START");
+
+	record = g_hash_table_lookup (pixbuf_cache, name);
+	if (record == NULL) {
+		gl_debug (DEBUG_PIXBUF_CACHE, "END not in cache");
+		return NULL;
+	}
+
+	if ( (record->data == NULL) &&
+	     gdk_pixbuf_save_to_buffer (record->pixbuf, &buffer, &buffer_size, "png", NULL, NULL) ) {
+		record->data   = g_bytes_new_take (buffer, buffer_size);
+		record->format = g_strdup ("png");
+	}
+
+	*format = record->format;
+
+	gl_debug (DEBUG_PIXBUF_CACHE, "END");
+
+	return record->data;
+}
+
+
 /*****************************************************************************/
 /* Remove pixbuf, but only if no references left.                            */
 /*****************************************************************************/
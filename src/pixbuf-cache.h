@@ -23,6 +23,7 @@
 
 #include <glib.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
+#include <cairo.h>
 
 G_BEGIN_DECLS
 
@@ -34,9 +35,21 @@ void        gl_pixbuf_cache_add_pixbuf     (GHashTable *pixbuf_cache,
 					    gchar      *name,
 					    GdkPixbuf  *pixbuf);
 
+void        gl_pixbuf_cache_add_data       (GHashTable  *pixbuf_cache,
+					    gchar       *name,
+					    GBytes      *data,
+					    const gchar *format);
+
 GdkPixbuf  *gl_pixbuf_cache_get_pixbuf     (GHashTable *pixbuf_cache,
 					    gchar      *name);
 
+cairo_surface_t *gl_pixbuf_cache_get_surface (GHashTable *pixbuf_cache,
+					    gchar      *name);
+
+GBytes     *gl_pixbuf_cache_get_data       (GHashTable   *pixbuf_cache,
+					    gchar        *name,
+					    const gchar **format);
+
 void        gl_pixbuf_cache_remove_pixbuf  (GHashTable *pixbuf_cache,
 					    gchar      *name);
 
@@ -22,8 +22,6 @@
 
 #include "pixbuf-util.h"
 
-#include "color.h"
-
 #include "debug.h"
 
 
@@ -31,6 +29,8 @@
 /* Private macros and constants.                          */
 /*========================================================*/
 
+#define ALPHA_MASK_KEY "gl-alpha-mask"
+
 
 /*========================================================*/
 /* Private types.                                         */
@@ -48,91 +48,85 @@
 
 
 /****************************************************************************/
-/* Create shadow version of given pixbuf.                                   */
+/* Get alpha channel of given pixbuf as an A8 cairo surface, to mask shadow */
+/* color through.  The mask is created once and is owned by the pixbuf, so  */
+/* it remains valid for the life of the pixbuf.  Returns NULL if the pixbuf */
+/* is opaque, i.e. its shadow is a plain rectangle.                         */
 /****************************************************************************/
-GdkPixbuf *
-gl_pixbuf_util_create_shadow_pixbuf (const GdkPixbuf *pixbuf,
-                                     guint            shadow_color,
-                                     gdouble          shadow_opacity)
+cairo_surface_t *
+gl_pixbuf_util_get_alpha_mask (GdkPixbuf *pixbuf)
 {
-        gint             bits_per_sample, channels;
-        gboolean         src_has_alpha;
+        cairo_surface_t *mask;
         gint             width, height, src_rowstride, dest_rowstride;
-        GdkPixbuf       *dest_pixbuf;
         guchar          *buf_src, *buf_dest;
         guchar          *p_src, *p_dest;
         gint             ix, iy;
-        guchar           shadow_r, shadow_g, shadow_b;
 
         g_return_val_if_fail (pixbuf && GDK_IS_PIXBUF (pixbuf), NULL);
 
-        shadow_r = GL_COLOR_F_RED   (shadow_color) * 255.0;
-        shadow_g = GL_COLOR_F_GREEN (shadow_color) * 255.0;
-        shadow_b = GL_COLOR_F_BLUE  (shadow_color) * 255.0;
+        if ( !gdk_pixbuf_get_has_alpha (pixbuf) )
+        {
+                return NULL;
+        }
 
-        /* extract pixels and parameters from source pixbuf. */
-        buf_src         = gdk_pixbuf_get_pixels (pixbuf);
-        bits_per_sample = gdk_pixbuf_get_bits_per_sample (pixbuf);
-        channels        = gdk_pixbuf_get_n_channels (pixbuf);
-        src_has_alpha   = gdk_pixbuf_get_has_alpha (pixbuf);
-        width           = gdk_pixbuf_get_width (pixbuf);
-        height          = gdk_pixbuf_get_height (pixbuf);
-        src_rowstride   = gdk_pixbuf_get_rowstride (pixbuf);
+        mask = g_object_get_data (G_OBJECT (pixbuf), ALPHA_MASK_KEY);
+        if ( mask )
+        {
+                return mask;
+        }
 
         /* validate assumptions about source pixbuf. */
-        g_return_val_if_fail (buf_src, NULL);
-        g_return_val_if_fail (bits_per_sample == 8, NULL);
-        g_return_val_if_fail ((channels >= 3) && (channels <= 4), NULL);
-        g_return_val_if_fail (width > 0, NULL);
-        g_return_val_if_fail (height > 0, NULL);
-        g_return_val_if_fail (src_rowstride > 0, NULL);
-
-        /* Allocate a destination pixbuf */
-        dest_pixbuf    = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, bits_per_sample, width, height);
-        dest_rowstride = gdk_pixbuf_get_rowstride (dest_pixbuf);
-        buf_dest       = gdk_pixbuf_get_pixels (dest_pixbuf);
-        if (!buf_dest) {
+        g_return_val_if_fail (gdk_pixbuf_get_bits_per_sample (pixbuf) == 8, NULL);
+        g_return_val_if_fail (gdk_pixbuf_get_n_channels (pixbuf) == 4, NULL);
+
+        GL_TRACE_BEGIN ("shadow mask");
+
+        buf_src       = gdk_pixbuf_get_pixels (pixbuf);
+        width         = gdk_pixbuf_get_width (pixbuf);
+        height        = gdk_pixbuf_get_height (pixbuf);
+        src_rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+
+        mask = cairo_image_surface_create (CAIRO_FORMAT_A8, width, height);
+        if ( cairo_surface_status (mask) != CAIRO_STATUS_SUCCESS )
+        {
+                cairo_surface_destroy (mask);
+                GL_TRACE_END ("shadow mask");
                 return NULL;
         }
+        cairo_surface_flush (mask);
+        buf_dest       = cairo_image_surface_get_data (mask);
+        dest_rowstride = cairo_image_surface_get_stride (mask);
 
-        /* Process pixels: set rgb components and composite alpha with shadow_opacity. */
-        p_src  = buf_src;
-        p_dest = buf_dest;
+        /* Extract alpha.  Simple enough for the compiler to vectorize. */
         for ( iy=0; iy < height; iy++ )
         {
-        
-                p_src  = buf_src + iy*src_rowstride;
+                p_src  = buf_src + iy*src_rowstride + 3;
                 p_dest = buf_dest + iy*dest_rowstride;
 
                 for ( ix=0; ix < width; ix++ )
                 {
+                        p_dest[ix] = p_src[4*ix];
+                }
+        }
 
-                        p_src += 3; /* skip RGB */
-
-                        *p_dest++ = shadow_r;
-                        *p_dest++ = shadow_g;
-                        *p_dest++ = shadow_b;
-
-                        if ( src_has_alpha )
-                        {
-                                *p_dest++ = *p_src++ * shadow_opacity;
-                        }
-                        else
-                        {
-                                *p_dest++ = shadow_opacity * 255.0;
-                        }
-
+        cairo_surface_mark_dirty (mask);
 
-                }
+        GL_TRACE_END ("shadow mask");
 
+        /* Pixbufs are shared between threads: first mask attached wins. */
+        if ( !g_object_replace_data (G_OBJECT (pixbuf), ALPHA_MASK_KEY,
+                                     NULL, mask,
+                                     (GDestroyNotify)cairo_surface_destroy, NULL) )
+        {
+                cairo_surface_destroy (mask);
+                mask = g_object_get_data (G_OBJECT (pixbuf), ALPHA_MASK_KEY);
         }
 
-        return dest_pixbuf;
+        return mask;
 }
 
 
 
-
 /*
  * Local Variables:       -- emacs
  * mode: C                -- emacs
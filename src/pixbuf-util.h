@@ -23,13 +23,12 @@
 
 #include <glib.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
+#include <cairo.h>
 
 G_BEGIN_DECLS
 
 
-GdkPixbuf *gl_pixbuf_util_create_shadow_pixbuf (const GdkPixbuf *pixbuf,
-                                                guint            shadow_color,
-                                                gdouble          shadow_opacity);
+cairo_surface_t *gl_pixbuf_util_get_alpha_mask (GdkPixbuf *pixbuf);
 
 
 G_END_DECLS
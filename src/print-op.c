@@ -102,6 +102,10 @@ static void     draw_page_cb                  (GtkPrintOperation *operation,
                                                int                page_nr,
                                                gpointer           user_data);
 
+static void     end_print_cb                  (GtkPrintOperation *operation,
+                                               GtkPrintContext   *context,
+                                               gpointer           user_data);
+
 
 /*****************************************************************************/
 /* Boilerplate object stuff.                                                 */
@@ -209,6 +213,9 @@ gl_print_op_construct (glPrintOp      *op,
 
 	g_signal_connect (G_OBJECT (op), "draw-page",
 			  G_CALLBACK (draw_page_cb), label);
+
+	g_signal_connect (G_OBJECT (op), "end-print",
+			  G_CALLBACK (end_print_cb), label);
 }
 
 
@@ -541,6 +548,8 @@ draw_page_cb (GtkPrintOperation *operation,
 
         cr = gtk_print_context_get_cairo_context (context);
 
+        GL_TRACE_BEGIN ("print page");
+
         if (!op->priv->merge_flag)
         {
                 gl_print_simple_sheet (op->priv->label,
@@ -580,6 +589,20 @@ draw_page_cb (GtkPrintOperation *operation,
                                                          &op->priv->state);
                 }
         }
+
+        GL_TRACE_END ("print page");
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  "End print" callback.                                          */
+/*--------------------------------------------------------------------------*/
+static void
+end_print_cb (GtkPrintOperation *operation,
+	      GtkPrintContext   *context,
+	      gpointer           user_data)
+{
+        GL_TRACE_SUMMARY ("print");
 }
 
 
@@ -30,6 +30,7 @@
 #include <libglabels.h>
 #include "label.h"
 #include "cairo-label-path.h"
+#include "display-list.h"
 
 #include "debug.h"
 
@@ -45,6 +46,8 @@
 #define TICK_OFFSET  2.25
 #define TICK_LENGTH 18.0
 
+static const cairo_user_data_key_t cancellable_key;
+
 
 /*=========================================================================*/
 /* Private types.                                                          */
@@ -61,6 +64,12 @@ typedef struct _PrintInfo {
 	gdouble page_width;
 	gdouble page_height;
 
+	/* Compiled label objects, shared by all labels on the sheet */
+	const glDisplayList *display_list;
+
+	/* Remaining labels are skipped once cancelled, may be NULL */
+	GCancellable        *cancellable;
+
 } PrintInfo;
 
 
@@ -90,6 +99,19 @@ static void       clip_to_outline             (PrintInfo        *pi,
 					       glLabel          *label);
 
 
+/*****************************************************************************/
+/* Set cancellable of rendering to cr.  Once it is cancelled, print commands */
+/* skip the remaining labels of a sheet.  The cancellable is not referenced, */
+/* it must outlive cr.                                                       */
+/*****************************************************************************/
+void
+gl_print_set_cancellable (cairo_t          *cr,
+                          GCancellable     *cancellable)
+{
+	cairo_set_user_data (cr, &cancellable_key, cancellable, NULL);
+}
+
+
 /*****************************************************************************/
 /* Print simple sheet (no merge data) command.                               */
 /*****************************************************************************/
@@ -190,7 +212,7 @@ gl_print_collated_merge_sheet   (glLabel          *label,
 	for ( p=(GList *)state->p_record; p!=NULL; p=p->next ) {
 		record = (glMergeRecord *)p->data;
 			
-		if ( record->select_flag ) {
+		if ( gl_merge_is_record_selected (merge, record) ) {
 			for (i_copy = state->i_copy; i_copy < n_copies; i_copy++) {
 
 				print_label (pi, label,
@@ -204,6 +226,7 @@ gl_print_collated_merge_sheet   (glLabel          *label,
                                 {
                                         g_free (origins);
                                         print_info_free (&pi);
+                                        g_object_unref (merge);
 
                                         state->i_copy = (i_copy+1) % n_copies;
                                         if (state->i_copy == 0)
@@ -223,6 +246,7 @@ gl_print_collated_merge_sheet   (glLabel          *label,
 
         g_free (origins);
         print_info_free (&pi);
+        g_object_unref (merge);
 
 	gl_debug (DEBUG_PRINT, "END");
 }
@@ -283,7 +307,7 @@ gl_print_uncollated_merge_sheet (glLabel          *label,
 		for ( p=state->p_record; p!=NULL; p=p->next ) {
 			record = (glMergeRecord *)p->data;
 			
-			if ( record->select_flag ) {
+			if ( gl_merge_is_record_selected (merge, record) ) {
 
                                 print_label (pi, label,
 					     origins[i_label].x,
@@ -296,6 +320,7 @@ gl_print_uncollated_merge_sheet (glLabel          *label,
                                 {
                                         g_free (origins);
                                         print_info_free (&pi);
+                                        g_object_unref (merge);
 
                                         state->p_record = p->next;
                                         if (state->p_record == NULL)
@@ -317,6 +342,7 @@ gl_print_uncollated_merge_sheet (glLabel          *label,
 
 	g_free (origins);
 	print_info_free (&pi);
+	g_object_unref (merge);
 
 	gl_debug (DEBUG_PRINT, "END");
 }
@@ -356,6 +382,9 @@ print_info_new (cairo_t          *cr,
 	pi->template = template;
 	pi->rotate_flag = rotate_flag;
 
+	pi->display_list = gl_display_list_get (label);
+	pi->cancellable  = cairo_get_user_data (cr, &cancellable_key);
+
 	gl_debug (DEBUG_PRINT, "END");
 
 	return pi;
@@ -503,6 +532,13 @@ print_label (PrintInfo     *pi,
 
 	gl_debug (DEBUG_PRINT, "START");
 
+	if ( pi->cancellable && g_cancellable_is_cancelled (pi->cancellable) ) {
+		gl_debug (DEBUG_PRINT, "END (cancelled)");
+		return;
+	}
+
+	GL_TRACE_BEGIN ("print_label");
+
 	gl_label_get_size (label, &width, &height);
 
 	cairo_save (pi->cr);
@@ -528,7 +564,7 @@ print_label (PrintInfo     *pi,
 		cairo_scale (pi->cr, -1.0, 1.0);
 	}
 
-        gl_label_draw (label, pi->cr, FALSE, record);
+        gl_display_list_draw (pi->display_list, pi->cr, record);
 
 	cairo_restore (pi->cr); /* From special transformations. */
 
@@ -540,6 +576,8 @@ print_label (PrintInfo     *pi,
 
 	cairo_restore (pi->cr); /* From translation. */
 
+	GL_TRACE_END ("print_label");
+
 	gl_debug (DEBUG_PRINT, "END");
 }
 
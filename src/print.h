@@ -22,6 +22,7 @@
 #define __PRINT_H__
 
 #include <cairo/cairo.h>
+#include <gio/gio.h>
 
 #include "label.h"
 
@@ -32,6 +33,9 @@ typedef struct {
 	GList *p_record;
 } glPrintState;
 
+void gl_print_set_cancellable        (cairo_t          *cr,
+				      GCancellable     *cancellable);
+
 void gl_print_simple_sheet           (glLabel          *label,
 				      cairo_t          *cr,
 				      gint              page,
@@ -158,16 +158,20 @@ gl_svg_cache_get_handle (GHashTable *svg_cache,
         if (record != NULL)
         {
                 record->references++;
+                GL_TRACE_COUNT ("svg cache hits", 1);
                 gl_debug (DEBUG_SVG_CACHE, "references=%d", record->references);
                 gl_debug (DEBUG_SVG_CACHE, "END cached");
                 return record->svg_handle;
         }
 
+        GL_TRACE_COUNT ("svg cache misses", 1);
 
         file = g_file_new_for_path (name);
         if ( g_file_load_contents (file, NULL, &buffer, &length, NULL, NULL) )
         {
+                GL_TRACE_BEGIN ("svg parse");
                 svg_handle = rsvg_handle_new_from_data ((guchar *)buffer, length, NULL);
+                GL_TRACE_END ("svg parse");
                 if ( svg_handle != NULL) {
                         record = g_new0 (CacheRecord, 1);
                         record->key        = g_strdup (name);
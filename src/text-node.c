@@ -29,6 +29,31 @@
 #include "debug.h"
 
 
+/*===========================================*/
+/* Private types                             */
+/*===========================================*/
+
+typedef enum {
+        OP_LINE,      /* Start of line; arg = index of next OP_LINE or n_ops. */
+        OP_LITERAL,   /* Literal span in string pool. */
+        OP_FIELD      /* Field key in string pool (nul terminated). */
+} OpType;
+
+typedef struct {
+        OpType   type;
+        guint    offset;     /* Offset into pool (OP_LITERAL, OP_FIELD, conditional OP_LINE) */
+        guint    length;     /* Length of literal or key */
+        guint    next_line;  /* OP_LINE only */
+        gboolean cond_flag;  /* OP_LINE only: line is a lone field, drop it if empty */
+} Op;
+
+struct _glTextTemplate {
+        Op      *ops;
+        guint    n_ops;
+        gchar   *pool;
+};
+
+
 /*===========================================*/
 /* Local function prototypes                 */
 /*===========================================*/
@@ -39,6 +64,10 @@ static glTextNode *extract_text_node  (const gchar         *text,
 static gboolean    is_empty_field     (const glTextNode    *text_node,
 				       const glMergeRecord *record);
 
+static void        append_node        (GString             *string,
+                                       const glTextNode    *text_node,
+                                       const glMergeRecord *record);
+
 
 /****************************************************************************/
 /* Expand single node into representative string.                           */
@@ -47,21 +76,38 @@ gchar *
 gl_text_node_expand (const glTextNode    *text_node,
 		     const glMergeRecord *record)
 {
-	gchar *text;
+	GString *string;
+
+	string = g_string_new (NULL);
+	append_node (string, text_node, record);
+
+	return g_string_free (string, FALSE);
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  Append expanded node to string.                                */
+/*--------------------------------------------------------------------------*/
+static void
+append_node (GString             *string,
+             const glTextNode    *text_node,
+             const glMergeRecord *record)
+{
+	const gchar *value;
 
 	if (text_node->field_flag) {
 		if (record == NULL) {
-			return g_strdup_printf ("${%s}", text_node->data);
+			g_string_append (string, "${");
+			g_string_append (string, text_node->data);
+			g_string_append_c (string, '}');
 		} else {
-			text = gl_merge_eval_key (record, text_node->data);
-			if (text != NULL) {
-				return text;
-			} else {
-				return g_strdup_printf ("%s", "");
+			value = gl_merge_lookup_key (record, text_node->data);
+			if (value != NULL) {
+				g_string_append (string, value);
 			}
 		}
 	} else {
-		return g_strdup (text_node->data);
+		g_string_append (string, text_node->data);
 	}
 }
 
@@ -73,18 +119,14 @@ static gboolean
 is_empty_field (const glTextNode    *text_node,
 		const glMergeRecord *record)
 {
-	gchar    *text;
-	gboolean  ret = FALSE;
+	const gchar *value;
 
 	if ( (record != NULL) && text_node->field_flag) {
-		text = gl_merge_eval_key (record, text_node->data);
-		if ( (text == NULL) || (text[0] == 0) ) {
-			ret = TRUE;
-		}
-		g_free (text);
+		value = gl_merge_lookup_key (record, text_node->data);
+		return ( (value == NULL) || (value[0] == 0) );
 	}
 
-	return ret;
+	return FALSE;
 }
 
 
@@ -219,10 +261,10 @@ gl_text_node_lines_expand (GList               *lines,
 {
 	GList      *p_line, *p_node;
 	glTextNode *text_node;
-	gchar       *text, *old_text, *expanded_node;
-        gboolean   first_line = TRUE;
+	GString    *string;
+        gboolean    first_line = TRUE;
 
-	text = g_strdup ("");	/* prime pointer for concatenation */
+	string = g_string_new (NULL);
 	for (p_line = lines; p_line != NULL; p_line = p_line->next) {
 
 		/* special case: something like ${ADDRESS2} = "" on line by itself. */ 
@@ -237,9 +279,7 @@ gl_text_node_lines_expand (GList               *lines,
 
 		/* prepend newline if it's not the first line */
                 if (!first_line) {
-			old_text = text;
-			text = g_strconcat (text, "\n", NULL);
-			g_free (old_text);
+			g_string_append_c (string, '\n');
 		} else {
 			first_line = FALSE;
                 }
@@ -247,16 +287,152 @@ gl_text_node_lines_expand (GList               *lines,
 		/* expand each node */
 		for (p_node = (GList *) p_line->data; p_node != NULL;
 		     p_node = p_node->next) {
+			append_node (string, (glTextNode *) p_node->data, record);
+		}
+	}
+
+	return g_string_free (string, FALSE);
+}
+
+
+/****************************************************************************/
+/* Compile text lines into a flat template for repeated expansion.          */
+/****************************************************************************/
+glTextTemplate *
+gl_text_template_new (GList *lines)
+{
+	glTextTemplate *tt;
+	GList          *p_line, *p_node;
+	glTextNode     *text_node;
+	GArray         *ops;
+	GString        *pool;
+	Op              op;
+	guint           i_line;
+
+	ops  = g_array_new (FALSE, TRUE, sizeof (Op));
+	pool = g_string_new (NULL);
+
+	for (p_line = lines; p_line != NULL; p_line = p_line->next) {
+
+		i_line = ops->len;
+
+		memset (&op, 0, sizeof (Op));
+		op.type = OP_LINE;
+		p_node = (GList *)p_line->data;
+		if (p_node && p_node->next == NULL) {
 			text_node = (glTextNode *) p_node->data;
-			old_text = text;
-			expanded_node = gl_text_node_expand (text_node, record);
-			text = g_strconcat (text, expanded_node, NULL);
-			g_free (old_text);
-			g_free (expanded_node);
+			op.cond_flag = text_node->field_flag;
 		}
+		g_array_append_val (ops, op);
+
+		for (; p_node != NULL; p_node = p_node->next) {
+			text_node = (glTextNode *) p_node->data;
+
+			memset (&op, 0, sizeof (Op));
+			op.type   = text_node->field_flag ? OP_FIELD : OP_LITERAL;
+			op.offset = pool->len;
+			op.length = strlen (text_node->data);
+			g_string_append_len (pool, text_node->data, op.length);
+			if (text_node->field_flag) {
+				/* Keys are looked up as C strings. */
+				g_string_append_c (pool, 0);
+			}
+			g_array_append_val (ops, op);
+		}
+
+		/* A conditional line shares the key of its lone field. */
+		if (g_array_index (ops, Op, i_line).cond_flag) {
+			g_array_index (ops, Op, i_line).offset = g_array_index (ops, Op, i_line+1).offset;
+		}
+		g_array_index (ops, Op, i_line).next_line = ops->len;
+	}
+
+	tt = g_new0 (glTextTemplate, 1);
+	tt->n_ops = ops->len;
+	tt->ops   = (Op *)g_array_free (ops, FALSE);
+	tt->pool  = g_string_free (pool, FALSE);
+
+	return tt;
+}
+
+
+/****************************************************************************/
+/* Free compiled text template.                                             */
+/****************************************************************************/
+void
+gl_text_template_free (glTextTemplate **tt)
+{
+	if ( *tt == NULL ) return;
+
+	g_free ((*tt)->ops);
+	g_free ((*tt)->pool);
+	g_free (*tt);
+	*tt = NULL;
+}
+
+
+/****************************************************************************/
+/* Expand compiled text template into buffer.                               */
+/*                                                                          */
+/* Buffer is overwritten and may be reused across calls, so that once it    */
+/* has grown to the size of a typical label no allocation takes place.     */
+/* Returns buffer contents, valid until the buffer is next modified.        */
+/****************************************************************************/
+const gchar *
+gl_text_template_expand (const glTextTemplate *tt,
+                         const glMergeRecord  *record,
+                         GString              *buffer)
+{
+	const Op    *op;
+	const gchar *value;
+	guint        i;
+	gboolean     first_line = TRUE;
+
+	g_string_truncate (buffer, 0);
+
+	for (i = 0; i < tt->n_ops; ) {
+		op = &tt->ops[i];
+
+		switch (op->type) {
+
+		case OP_LINE:
+			/* special case: something like ${ADDRESS2} = "" on line by itself. */ 
+			if (op->cond_flag && (record != NULL)) {
+				value = gl_merge_lookup_key (record, tt->pool + op->offset);
+				if ( (value == NULL) || (value[0] == 0) ) {
+					i = op->next_line;
+					continue;
+				}
+			}
+			if (!first_line) {
+				g_string_append_c (buffer, '\n');
+			} else {
+				first_line = FALSE;
+			}
+			break;
+
+		case OP_LITERAL:
+			g_string_append_len (buffer, tt->pool + op->offset, op->length);
+			break;
+
+		case OP_FIELD:
+			if (record == NULL) {
+				g_string_append_len (buffer, "${", 2);
+				g_string_append_len (buffer, tt->pool + op->offset, op->length);
+				g_string_append_c (buffer, '}');
+			} else {
+				value = gl_merge_lookup_key (record, tt->pool + op->offset);
+				if (value != NULL) {
+					g_string_append (buffer, value);
+				}
+			}
+			break;
+		}
+
+		i++;
 	}
 
-	return text;
+	return buffer->str;
 }
 
 
@@ -31,6 +31,8 @@ typedef struct {
 	gchar *data;
 } glTextNode;
 
+typedef struct _glTextTemplate glTextTemplate;
+
 gchar      *gl_text_node_expand              (const glTextNode    *text_node,
 					      const glMergeRecord *record);
 glTextNode *gl_text_node_new_from_text       (const gchar         *text);
@@ -46,6 +48,12 @@ GList      *gl_text_node_lines_new_from_text (const gchar         *text);
 GList      *gl_text_node_lines_dup           (GList               *lines);
 void        gl_text_node_lines_free          (GList              **lines);
 
+glTextTemplate *gl_text_template_new         (GList                *lines);
+void            gl_text_template_free        (glTextTemplate      **tt);
+const gchar    *gl_text_template_expand      (const glTextTemplate *tt,
+                                              const glMergeRecord  *record,
+                                              GString              *buffer);
+
 /* debug function */
 void        gl_text_node_lines_print         (GList               *lines);
 
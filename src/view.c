@@ -65,10 +65,23 @@
 #define OUTLINE_WIDTH_PIXELS      1.0
 #define SELECT_LINE_WIDTH_PIXELS  3.0
 
+/* Covers selection handles and outlines drawn outside of an object's extent. */
+#define DAMAGE_PAD_PIXELS         8
+
 #define ZOOMTOFIT_PAD   16
 
 #define SHADOW_OFFSET_PIXELS (ZOOMTOFIT_PAD/4)
 
+/* Margin around cached static layers, enough for the label shadow. */
+#define STATIC_LAYERS_PAD_PIXELS   (SHADOW_OFFSET_PIXELS + 1)
+
+/* Above this size, static layers are drawn directly instead of cached. */
+#define STATIC_LAYERS_MAX_PIXELS   (2048*2048)
+
+/* Objects layer tiles (device pixels), and how many to keep (256 KB each). */
+#define TILE_SIZE_PIXELS           256
+#define TILE_CACHE_MAX             192
+
 #define POINTS_PER_MM    2.83464566929
 
 
@@ -76,6 +89,18 @@
 /* Private types.                                                           */
 /*==========================================================================*/
 
+/*
+ * Cached tile of the objects layer.  Tile (i,j) at a given scale covers the
+ * device pixels starting at (i,j)*TILE_SIZE_PIXELS from the label origin.
+ */
+typedef struct {
+        gdouble          scale;
+        gint             i, j;
+        glLabelRegion    region;     /* Area covered, label coordinates. */
+        cairo_surface_t *surface;
+        GList           *lru_link;   /* Link in view->tiles_lru. */
+} Tile;
+
 enum {
 	CONTEXT_MENU_ACTIVATE,
 	ZOOM_CHANGED,
@@ -137,11 +162,19 @@ static void       screen_changed_cb               (glView         *view);
 
 static void       label_changed_cb                (glView         *view);
 
+static void       update_damage                   (glView         *view,
+                                                   glLabelRegion  *region);
+
 static void       label_resized_cb                (glView         *view);
 
 static void       draw_layers                     (glView         *view,
                                                    cairo_t        *cr);
 
+static void       draw_static_layers              (glView         *view,
+                                                   cairo_t        *cr);
+
+static void       invalidate_static_layers        (glView         *view);
+
 static void       draw_bg_layer                   (glView         *view,
                                                    cairo_t        *cr);
 static void       draw_grid_layer                 (glView         *view,
@@ -150,6 +183,19 @@ static void       draw_markup_layer               (glView         *view,
                                                    cairo_t        *cr);
 static void       draw_objects_layer              (glView         *view,
                                                    cairo_t        *cr);
+
+static Tile      *get_tile                        (glView         *view,
+                                                   cairo_t        *cr,
+                                                   gdouble         scale,
+                                                   gint            i,
+                                                   gint            j,
+                                                   gint64         *render_time);
+static void       invalidate_tiles                (glView         *view,
+                                                   glLabelRegion  *region);
+static guint      tile_hash                       (gconstpointer   key);
+static gboolean   tile_equal                      (gconstpointer   a,
+                                                   gconstpointer   b);
+static void       tile_free                       (Tile           *tile);
 static void       draw_fg_layer                   (glView         *view,
                                                    cairo_t        *cr);
 static void       draw_highlight_layer            (glView         *view,
@@ -283,6 +329,10 @@ gl_view_init (glView *view)
 	view->grid_visible         = TRUE;
 	view->grid_spacing         = gl_units_util_get_grid_size (units);
 	view->markup_visible       = TRUE;
+	view->static_layers        = NULL;
+	view->tiles                = g_hash_table_new_full (tile_hash, tile_equal,
+                                                            NULL, (GDestroyNotify)tile_free);
+	view->tiles_lru            = g_queue_new ();
 	view->mode                 = GL_VIEW_MODE_ARROW;
 	view->zoom                 = 1.0;
 	view->home_scale           = get_home_scale (view);
@@ -357,6 +407,12 @@ gl_view_finalize (GObject *object)
         g_signal_handlers_disconnect_by_func (G_OBJECT (gl_prefs),
                                               G_CALLBACK (prefs_changed_cb), view);
 
+        invalidate_static_layers (view);
+        invalidate_tiles (view, NULL);
+
+        g_hash_table_destroy (view->tiles);
+        g_queue_free (view->tiles_lru);
+
 	G_OBJECT_CLASS (gl_view_parent_class)->finalize (object);
 
 	gl_debug (DEBUG_VIEW, "END");
@@ -472,6 +528,7 @@ prefs_changed_cb (glView         *view)
         units = gl_prefs_model_get_units (gl_prefs);
 	view->grid_spacing = gl_units_util_get_grid_size (units);
 
+        invalidate_static_layers (view);
         gl_view_update (view);
 }
 
@@ -664,11 +721,71 @@ screen_changed_cb (glView *view)
 static void
 label_changed_cb (glView  *view)
 {
+        glLabelRegion region;
+
 	g_return_if_fail (view && GL_IS_VIEW (view));
 
 	gl_debug (DEBUG_VIEW, "START");
 
-        gl_view_update (view);
+        if ( gl_label_take_damage (view->label, &region) )
+        {
+                if ( region.x2 >= region.x1 )
+                {
+                        invalidate_tiles (view, &region);
+                        update_damage (view, &region);
+                }
+        }
+        else
+        {
+                invalidate_tiles (view, NULL);
+                gl_view_update (view);
+        }
+
+	gl_debug (DEBUG_VIEW, "END");
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Invalidate damaged region of label (label coordinates).        */
+/*---------------------------------------------------------------------------*/
+static void
+update_damage (glView        *view,
+               glLabelRegion *region)
+{
+        GdkWindow    *bin_window;
+        gdouble       scale;
+        gdouble       x1, y1, x2, y2;
+	GdkRectangle  rect;
+
+	gl_debug (DEBUG_VIEW, "START");
+
+        /* Nothing to add if the whole canvas is already pending. */
+        if ( view->update_scheduled_flag )
+        {
+                return;
+        }
+
+        bin_window = gtk_layout_get_bin_window (GTK_LAYOUT (view->canvas));
+        if ( !bin_window )
+        {
+                return;
+        }
+
+        scale = view->zoom * view->home_scale;
+
+        x1 = (region->x1 + view->x0) * scale;
+        y1 = (region->y1 + view->y0) * scale;
+        x2 = (region->x2 + view->x0) * scale;
+        y2 = (region->y2 + view->y0) * scale;
+
+        rect.x      = floor (x1) - DAMAGE_PAD_PIXELS;
+        rect.y      = floor (y1) - DAMAGE_PAD_PIXELS;
+        rect.width  = ceil (x2) - floor (x1) + 2*DAMAGE_PAD_PIXELS;
+        rect.height = ceil (y2) - floor (y1) + 2*DAMAGE_PAD_PIXELS;
+
+        /* GDK accumulates invalidated rectangles into a single paint region,
+         * and the cairo context created in draw_cb() is clipped to it. */
+        gdk_window_invalidate_rect (bin_window, &rect, TRUE);
 
 	gl_debug (DEBUG_VIEW, "END");
 }
@@ -693,6 +810,8 @@ label_resized_cb (glView  *view)
         g_signal_emit_by_name (hadjustment, "changed");
         g_signal_emit_by_name (vadjustment, "changed");
 
+        invalidate_static_layers (view);
+        invalidate_tiles (view, NULL);
         gl_view_update (view);
 
 	gl_debug (DEBUG_VIEW, "END");
@@ -733,15 +852,14 @@ draw_layers (glView  *view,
         view->w  = w;
         view->h  = h;
 
+	draw_static_layers (view, cr);
+	draw_objects_layer (view, cr);
+
         cairo_save (cr);
 
         cairo_scale (cr, scale, scale);
         cairo_translate (cr, view->x0, view->y0);
 
-	draw_bg_layer (view, cr);
-	draw_grid_layer (view, cr);
-	draw_markup_layer (view, cr);
-	draw_objects_layer (view, cr);
 	draw_fg_layer (view, cr);
 	draw_highlight_layer (view, cr);
         draw_select_region_layer (view, cr);
@@ -753,6 +871,100 @@ draw_layers (glView  *view,
 }
 
 
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Draw background, grid and markup layers.  These only depend on  */
+/* zoom, template, rotation and preferences, so they are rendered once into  */
+/* a device resolution surface which is then composited with a single paint. */
+/*---------------------------------------------------------------------------*/
+static void
+draw_static_layers (glView  *view,
+                    cairo_t *cr)
+{
+	gdouble                    scale;
+        gdouble                    x0_pixels, y0_pixels;
+        gint                       w_pixels, h_pixels;
+        cairo_t                   *layers_cr;
+
+	gl_debug (DEBUG_VIEW, "START");
+
+        scale     = view->home_scale * view->zoom;
+        x0_pixels = view->x0 * scale;
+        y0_pixels = view->y0 * scale;
+
+        if ( (view->static_layers_scale != scale) ||
+             (view->static_layers_x0 != x0_pixels) ||
+             (view->static_layers_y0 != y0_pixels) )
+        {
+                invalidate_static_layers (view);
+        }
+
+        w_pixels = ceil (view->w * scale) + 2*STATIC_LAYERS_PAD_PIXELS + 1;
+        h_pixels = ceil (view->h * scale) + 2*STATIC_LAYERS_PAD_PIXELS + 1;
+
+        if ( (gdouble)w_pixels * h_pixels > STATIC_LAYERS_MAX_PIXELS )
+        {
+                /* Too big to keep around, draw directly. */
+                cairo_save (cr);
+                cairo_scale (cr, scale, scale);
+                cairo_translate (cr, view->x0, view->y0);
+                draw_bg_layer (view, cr);
+                draw_grid_layer (view, cr);
+                draw_markup_layer (view, cr);
+                cairo_restore (cr);
+
+                gl_debug (DEBUG_VIEW, "END");
+                return;
+        }
+
+        if ( view->static_layers == NULL )
+        {
+                view->static_layers = cairo_surface_create_similar (cairo_get_target (cr),
+                                                                    CAIRO_CONTENT_COLOR_ALPHA,
+                                                                    w_pixels, h_pixels);
+                view->static_layers_scale = scale;
+                view->static_layers_x0    = x0_pixels;
+                view->static_layers_y0    = y0_pixels;
+
+                /* Keep the sub-pixel offset of the canvas, so that the cached
+                 * layers are pixel-identical to drawing them directly. */
+                layers_cr = cairo_create (view->static_layers);
+                cairo_translate (layers_cr,
+                                 x0_pixels - floor (x0_pixels) + STATIC_LAYERS_PAD_PIXELS,
+                                 y0_pixels - floor (y0_pixels) + STATIC_LAYERS_PAD_PIXELS);
+                cairo_scale (layers_cr, scale, scale);
+
+                draw_bg_layer (view, layers_cr);
+                draw_grid_layer (view, layers_cr);
+                draw_markup_layer (view, layers_cr);
+
+                cairo_destroy (layers_cr);
+        }
+
+        cairo_save (cr);
+        cairo_set_source_surface (cr, view->static_layers,
+                                  floor (x0_pixels) - STATIC_LAYERS_PAD_PIXELS,
+                                  floor (y0_pixels) - STATIC_LAYERS_PAD_PIXELS);
+        cairo_paint (cr);
+        cairo_restore (cr);
+
+	gl_debug (DEBUG_VIEW, "END");
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Discard cached static layers.                                   */
+/*---------------------------------------------------------------------------*/
+static void
+invalidate_static_layers (glView  *view)
+{
+        if ( view->static_layers )
+        {
+                cairo_surface_destroy (view->static_layers);
+                view->static_layers = NULL;
+        }
+}
+
+
 /*---------------------------------------------------------------------------*/
 /* PRIVATE.  Draw background                                                 */
 /*---------------------------------------------------------------------------*/
@@ -838,16 +1050,16 @@ draw_grid_layer (glView  *view,
                 {
                         cairo_move_to (cr, x, 0);
                         cairo_line_to (cr, x, h);
-                        cairo_stroke (cr);
                 }
 
                 for ( y=y0; y < h; y += view->grid_spacing )
                 {
                         cairo_move_to (cr, 0, y);
                         cairo_line_to (cr, w, y);
-                        cairo_stroke (cr);
                 }
 
+                cairo_stroke (cr);
+
                 cairo_restore (cr);
 
         }
@@ -908,13 +1120,212 @@ draw_markup_layer (glView  *view,
 
 
 /*---------------------------------------------------------------------------*/
-/* PRIVATE.  Draw objects layer.                                             */
+/* PRIVATE.  Draw objects layer.  Objects are rendered into fixed size       */
+/* device tiles, which are kept until damaged, so that scrolling and        */
+/* exposes at high zoom only composite already rendered tiles.              */
 /*---------------------------------------------------------------------------*/
 static void
 draw_objects_layer (glView  *view,
                     cairo_t *cr)
 {
-        gl_label_draw (view->label, cr, TRUE, NULL);
+	gdouble                    scale;
+        gdouble                    x0_pixels, y0_pixels;
+        gdouble                    ox, oy;
+        gdouble                    cx1, cy1, cx2, cy2;
+        gint                       i, i1, i2, j, j1, j2;
+        Tile                      *tile;
+        gint64                     render_time = 0;
+        gint                       n_tiles = 0;
+
+	gl_debug (DEBUG_VIEW, "START");
+
+        scale     = view->home_scale * view->zoom;
+        x0_pixels = view->x0 * scale;
+        y0_pixels = view->y0 * scale;
+        ox        = floor (x0_pixels);
+        oy        = floor (y0_pixels);
+
+        /* Tile contents keep the sub-pixel offset of the label origin. */
+        if ( (view->tiles_x_frac != x0_pixels - ox) ||
+             (view->tiles_y_frac != y0_pixels - oy) )
+        {
+                invalidate_tiles (view, NULL);
+                view->tiles_x_frac = x0_pixels - ox;
+                view->tiles_y_frac = y0_pixels - oy;
+        }
+
+        cairo_clip_extents (cr, &cx1, &cy1, &cx2, &cy2);
+
+        i1 = floor ((cx1 - ox) / TILE_SIZE_PIXELS);
+        j1 = floor ((cy1 - oy) / TILE_SIZE_PIXELS);
+        i2 = ceil ((cx2 - ox) / TILE_SIZE_PIXELS) - 1;
+        j2 = ceil ((cy2 - oy) / TILE_SIZE_PIXELS) - 1;
+
+        for ( j = j1; j <= j2; j++ )
+        {
+                for ( i = i1; i <= i2; i++ )
+                {
+                        tile = get_tile (view, cr, scale, i, j, &render_time);
+
+                        cairo_set_source_surface (cr, tile->surface,
+                                                  ox + i*TILE_SIZE_PIXELS,
+                                                  oy + j*TILE_SIZE_PIXELS);
+                        cairo_rectangle (cr,
+                                         ox + i*TILE_SIZE_PIXELS,
+                                         oy + j*TILE_SIZE_PIXELS,
+                                         TILE_SIZE_PIXELS, TILE_SIZE_PIXELS);
+                        cairo_fill (cr);
+
+                        n_tiles++;
+                }
+        }
+
+	gl_debug (DEBUG_VIEW, "END %d tiles, %.3f ms rendering, %d cached",
+                  n_tiles, render_time / 1000.0, g_hash_table_size (view->tiles));
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Get tile of objects layer, rendering it if not cached.  Adds    */
+/* time spent rendering to render_time (microseconds).                       */
+/*---------------------------------------------------------------------------*/
+static Tile *
+get_tile (glView  *view,
+          cairo_t *cr,
+          gdouble  scale,
+          gint     i,
+          gint     j,
+          gint64  *render_time)
+{
+        Tile     key;
+        Tile    *tile;
+        cairo_t *tile_cr;
+        gint64   t0;
+
+        key.scale = scale;
+        key.i     = i;
+        key.j     = j;
+
+        tile = g_hash_table_lookup (view->tiles, &key);
+        if ( tile )
+        {
+                /* Most recently used tiles are kept at the head. */
+                g_queue_unlink (view->tiles_lru, tile->lru_link);
+                g_queue_push_head_link (view->tiles_lru, tile->lru_link);
+                return tile;
+        }
+
+        t0 = g_get_monotonic_time ();
+
+        while ( g_queue_get_length (view->tiles_lru) >= TILE_CACHE_MAX )
+        {
+                tile = g_queue_pop_tail (view->tiles_lru);
+                g_hash_table_remove (view->tiles, tile);
+        }
+
+        tile = g_new0 (Tile, 1);
+        tile->scale = scale;
+        tile->i     = i;
+        tile->j     = j;
+
+        tile->region.x1 = (i*TILE_SIZE_PIXELS - view->tiles_x_frac) / scale;
+        tile->region.y1 = (j*TILE_SIZE_PIXELS - view->tiles_y_frac) / scale;
+        tile->region.x2 = ((i+1)*TILE_SIZE_PIXELS - view->tiles_x_frac) / scale;
+        tile->region.y2 = ((j+1)*TILE_SIZE_PIXELS - view->tiles_y_frac) / scale;
+
+        tile->surface = cairo_surface_create_similar (cairo_get_target (cr),
+                                                      CAIRO_CONTENT_COLOR_ALPHA,
+                                                      TILE_SIZE_PIXELS, TILE_SIZE_PIXELS);
+
+        tile_cr = cairo_create (tile->surface);
+        cairo_scale (tile_cr, scale, scale);
+        cairo_translate (tile_cr, -tile->region.x1, -tile->region.y1);
+
+        gl_label_draw_region (view->label, tile_cr, TRUE, NULL, &tile->region);
+
+        cairo_destroy (tile_cr);
+
+        g_queue_push_head (view->tiles_lru, tile);
+        tile->lru_link = g_queue_peek_head_link (view->tiles_lru);
+        g_hash_table_add (view->tiles, tile);
+
+        *render_time += g_get_monotonic_time () - t0;
+
+        return tile;
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Discard cached tiles touching region (label coordinates), at    */
+/* any zoom level, or all tiles if region is NULL.                           */
+/*---------------------------------------------------------------------------*/
+static void
+invalidate_tiles (glView        *view,
+                  glLabelRegion *region)
+{
+        GList *p, *p_next;
+        Tile  *tile;
+        gdouble pad;
+
+        if ( region == NULL )
+        {
+                g_queue_clear (view->tiles_lru);
+                g_hash_table_remove_all (view->tiles);
+                return;
+        }
+
+        for ( p = view->tiles_lru->head; p != NULL; p = p_next )
+        {
+                p_next = p->next;
+                tile   = (Tile *)p->data;
+
+                /* Antialiasing may touch pixels just outside of the extent. */
+                pad = DAMAGE_PAD_PIXELS / tile->scale;
+
+                if ( (region->x2 + pad >= tile->region.x1) &&
+                     (region->x1 - pad <= tile->region.x2) &&
+                     (region->y2 + pad >= tile->region.y1) &&
+                     (region->y1 - pad <= tile->region.y2) )
+                {
+                        g_queue_delete_link (view->tiles_lru, p);
+                        g_hash_table_remove (view->tiles, tile);
+                }
+        }
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Tile hash and equality, keyed by scale and tile coordinates.    */
+/*---------------------------------------------------------------------------*/
+static guint
+tile_hash (gconstpointer   key)
+{
+        const Tile *tile = key;
+
+        return g_double_hash (&tile->scale) ^ (tile->i * 7919) ^ (tile->j * 104729);
+}
+
+
+static gboolean
+tile_equal (gconstpointer   a,
+            gconstpointer   b)
+{
+        const Tile *tile_a = a;
+        const Tile *tile_b = b;
+
+        return (tile_a->scale == tile_b->scale) &&
+                (tile_a->i == tile_b->i) && (tile_a->j == tile_b->j);
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* PRIVATE.  Free tile (hash table value destroy function).                  */
+/*---------------------------------------------------------------------------*/
+static void
+tile_free (Tile *tile)
+{
+        cairo_surface_destroy (tile->surface);
+        g_free (tile);
 }
 
 
@@ -1020,6 +1431,7 @@ gl_view_show_grid (glView *view)
 	g_return_if_fail (view && GL_IS_VIEW (view));
 
         view->grid_visible = TRUE;
+        invalidate_static_layers (view);
         gl_view_update (view);
 }
 
@@ -1033,6 +1445,7 @@ gl_view_hide_grid (glView *view)
 	g_return_if_fail (view && GL_IS_VIEW (view));
 
         view->grid_visible = FALSE;
+        invalidate_static_layers (view);
         gl_view_update (view);
 }
 
@@ -1046,6 +1459,7 @@ gl_view_show_markup (glView *view)
 	g_return_if_fail (view && GL_IS_VIEW (view));
 
         view->markup_visible = TRUE;
+        invalidate_static_layers (view);
         gl_view_update (view);
 }
 
@@ -1059,6 +1473,7 @@ gl_view_hide_markup (glView *view)
 	g_return_if_fail (view && GL_IS_VIEW (view));
 
         view->markup_visible = FALSE;
+        invalidate_static_layers (view);
         gl_view_update (view);
 }
 
@@ -71,6 +71,16 @@ struct _glView {
 
 	gboolean            markup_visible;
 
+	/* Background, grid and markup layers, cached at device resolution */
+	cairo_surface_t    *static_layers;
+	gdouble             static_layers_scale;
+	gdouble             static_layers_x0, static_layers_y0;
+
+	/* Objects layer, cached as device tiles per zoom level (LRU) */
+	GHashTable         *tiles;
+	GQueue             *tiles_lru;
+	gdouble             tiles_x_frac, tiles_y_frac;
+
 	glViewMode          mode;
 	glLabelObjectType   create_type;
 	glViewState         state;
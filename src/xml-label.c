@@ -26,6 +26,7 @@
 #include <glib.h>
 #include <libxml/tree.h>
 #include <libxml/parser.h>
+#include <libxml/SAX2.h>
 #include <libxml/xinclude.h>
 #include <gdk-pixbuf/gdk-pixdata.h>
 
@@ -59,6 +60,24 @@
 /* Private types.                                         */
 /*========================================================*/
 
+/* Embedded file of Data node, decoded while parsing. */
+typedef struct {
+	gchar      *name;
+	gchar      *format;       /* NULL for (obsolete) Pixdata. */
+	gboolean    base64_flag;
+	gint        base64_state;
+	guint       base64_save;
+	GByteArray *bytes;
+} DataFile;
+
+/* SAX parse state, so that embedded files never become DOM text nodes. */
+typedef struct {
+	gint        depth;
+	gboolean    data_flag;    /* Inside top-level Data node. */
+	DataFile   *file;         /* Embedded file being decoded. */
+	GList      *file_list;
+} ParseState;
+
 
 /*========================================================*/
 /* Private globals.                                       */
@@ -69,10 +88,39 @@
 /* Private function prototypes.                           */
 /*========================================================*/
 
+static xmlParserCtxtPtr xml_parser_ctxt_new    (ParseState       *state);
+
+static void           xml_parse_state_clear    (ParseState       *state);
+
+static void           xml_sax_start_element    (void             *ctx,
+						const xmlChar    *localname,
+						const xmlChar    *prefix,
+						const xmlChar    *URI,
+						int               nb_namespaces,
+						const xmlChar   **namespaces,
+						int               nb_attributes,
+						int               nb_defaulted,
+						const xmlChar   **attributes);
+
+static void           xml_sax_end_element      (void             *ctx,
+						const xmlChar    *localname,
+						const xmlChar    *prefix,
+						const xmlChar    *URI);
+
+static void           xml_sax_characters       (void             *ctx,
+						const xmlChar    *ch,
+						int               len);
+
+static void           xml_sax_cdata_block      (void             *ctx,
+						const xmlChar    *value,
+						int               len);
+
 static glLabel       *xml_doc_to_label         (xmlDocPtr         doc,
+						GList            *file_list,
 						glXMLLabelStatus *status);
 
 static glLabel       *xml_parse_label          (xmlNodePtr        root,
+						GList            *file_list,
 						glXMLLabelStatus *status);
 
 static void           xml_parse_objects        (xmlNodePtr        node,
@@ -102,12 +150,22 @@ static void           xml_parse_merge_fields   (xmlNodePtr        node,
 static void           xml_parse_data           (xmlNodePtr        node,
 						glLabel          *label);
 
-static void           xml_parse_pixdata        (xmlNodePtr        node,
+static void           xml_parse_data_file      (xmlNodePtr        node,
 						glLabel          *label);
 
-static void           xml_parse_file_node      (xmlNodePtr        node,
+static DataFile      *data_file_new            (const gchar      *name,
+						const gchar      *format,
+						gboolean          pixdata_flag);
+
+static void           data_file_append         (DataFile         *file,
+						const xmlChar    *ch,
+						gint              len);
+
+static void           data_file_add_to_label   (DataFile         *file,
 						glLabel          *label);
 
+static void           data_file_free           (DataFile         *file);
+
 static void           xml_parse_toplevel_span  (xmlNodePtr        node,
 						glLabelObject    *object);
 
@@ -157,7 +215,7 @@ static void           xml_create_data          (xmlDocPtr         doc,
 						xmlNsPtr          ns,
 						glLabel          *label);
 
-static void           xml_create_pixdata       (xmlNodePtr        parent,
+static void           xml_create_file_image    (xmlNodePtr        parent,
 						xmlNsPtr          ns,
 						glLabel          *label,
 						gchar            *name);
@@ -186,18 +244,26 @@ glLabel *
 gl_xml_label_open (const gchar      *utf8_filename,
 		   glXMLLabelStatus *status)
 {
-	xmlDocPtr  doc;
-	glLabel   *label;
-	gchar 	  *filename;
+	xmlParserCtxtPtr  ctxt;
+	ParseState        state = { 0 };
+	xmlDocPtr         doc;
+	glLabel          *label;
+	gchar 	         *filename;
+	gint64            t0;
 
 	gl_debug (DEBUG_XML, "START");
 
 	filename = g_filename_from_utf8 (utf8_filename, -1, NULL, NULL, NULL);
 	g_return_val_if_fail (filename, NULL);
 
-        doc = xmlReadFile (filename, NULL, XML_PARSE_HUGE);
+	t0 = g_get_monotonic_time ();
+
+	ctxt = xml_parser_ctxt_new (&state);
+        doc = xmlCtxtReadFile (ctxt, filename, NULL, XML_PARSE_HUGE);
+	xmlFreeParserCtxt (ctxt);
 	if (!doc) {
 		g_message ("xmlParseFile error");
+		xml_parse_state_clear (&state);
 		*status = XML_LABEL_ERROR_OPEN_PARSE;
 		return NULL;
 	}
@@ -205,9 +271,10 @@ gl_xml_label_open (const gchar      *utf8_filename,
 	xmlXIncludeProcess (doc);
 	xmlReconciliateNs (doc, xmlDocGetRootElement (doc));
 
-	label = xml_doc_to_label (doc, status);
+	label = xml_doc_to_label (doc, state.file_list, status);
 
 	xmlFreeDoc (doc);
+	xml_parse_state_clear (&state);
 
 	if (label) {
 		gl_label_set_filename (label, utf8_filename);
@@ -215,7 +282,7 @@ gl_xml_label_open (const gchar      *utf8_filename,
 	}
 
 	g_free (filename);
-	gl_debug (DEBUG_XML, "END");
+	gl_debug (DEBUG_XML, "END %.1f ms", (g_get_monotonic_time () - t0) / 1000.0);
 
 	return label;
 }
@@ -228,21 +295,27 @@ glLabel *
 gl_xml_label_open_buffer (const gchar      *buffer,
 			  glXMLLabelStatus *status)
 {
-	xmlDocPtr  doc;
-	glLabel   *label;
+	xmlParserCtxtPtr  ctxt;
+	ParseState        state = { 0 };
+	xmlDocPtr         doc;
+	glLabel          *label;
 
 	gl_debug (DEBUG_XML, "START");
 
-        doc = xmlReadDoc ((xmlChar *) buffer, NULL, NULL, XML_PARSE_HUGE);
+	ctxt = xml_parser_ctxt_new (&state);
+        doc = xmlCtxtReadDoc (ctxt, (xmlChar *) buffer, NULL, NULL, XML_PARSE_HUGE);
+	xmlFreeParserCtxt (ctxt);
 	if (!doc) {
 		g_message ("xmlParseFile error");
+		xml_parse_state_clear (&state);
 		*status = XML_LABEL_ERROR_OPEN_PARSE;
 		return NULL;
 	}
 
-	label = xml_doc_to_label (doc, status);
+	label = xml_doc_to_label (doc, state.file_list, status);
 
 	xmlFreeDoc (doc);
+	xml_parse_state_clear (&state);
 
 	if (label) {
 		gl_label_clear_modified (label);
@@ -254,11 +327,173 @@ gl_xml_label_open_buffer (const gchar      *buffer,
 }
 
 
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  Create parser context.  Embedded files of the Data node are    */
+/* decoded chunk by chunk while parsing, into state's file list, instead of */
+/* being kept as (huge) DOM text nodes.  Everything else becomes the DOM.   */
+/*--------------------------------------------------------------------------*/
+static xmlParserCtxtPtr
+xml_parser_ctxt_new (ParseState *state)
+{
+	xmlParserCtxtPtr ctxt;
+
+	ctxt = xmlNewParserCtxt ();
+
+	ctxt->_private            = state;
+	ctxt->sax->startElementNs = xml_sax_start_element;
+	ctxt->sax->endElementNs   = xml_sax_end_element;
+	ctxt->sax->characters     = xml_sax_characters;
+	ctxt->sax->cdataBlock     = xml_sax_cdata_block;
+
+	return ctxt;
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  Free embedded files collected by parser.                       */
+/*--------------------------------------------------------------------------*/
+static void
+xml_parse_state_clear (ParseState *state)
+{
+	if (state->file) {
+		/* Parse error in the middle of a file. */
+		data_file_free (state->file);
+		state->file = NULL;
+	}
+
+	g_list_free_full (state->file_list, (GDestroyNotify)data_file_free);
+	state->file_list = NULL;
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  SAX start element handler.                                     */
+/*--------------------------------------------------------------------------*/
+static void
+xml_sax_start_element (void            *ctx,
+		       const xmlChar   *localname,
+		       const xmlChar   *prefix,
+		       const xmlChar   *URI,
+		       int              nb_namespaces,
+		       const xmlChar  **namespaces,
+		       int              nb_attributes,
+		       int              nb_defaulted,
+		       const xmlChar  **attributes)
+{
+	ParseState *state = ((xmlParserCtxtPtr)ctx)->_private;
+	gchar      *name = NULL, *format = NULL;
+	gint        i;
+
+	state->depth++;
+
+	if (state->file) {
+		/* Not expected inside embedded file, ignore. */
+		return;
+	}
+
+	if ( (state->depth == 2) && xmlStrEqual (localname, (xmlChar *)"Data") ) {
+		state->data_flag = TRUE;
+	}
+	else if ( state->data_flag && (state->depth == 3) &&
+		  ( xmlStrEqual (localname, (xmlChar *)"File") ||
+		    xmlStrEqual (localname, (xmlChar *)"Pixdata") ) )
+	{
+		/* Attributes are (localname, prefix, URI, value, end) tuples. */
+		for (i = 0; i < nb_attributes; i++) {
+			if (xmlStrEqual (attributes[5*i], (xmlChar *)"name")) {
+				name = g_strndup ((gchar *)attributes[5*i+3],
+						  attributes[5*i+4] - attributes[5*i+3]);
+			} else if (xmlStrEqual (attributes[5*i], (xmlChar *)"format")) {
+				format = g_strndup ((gchar *)attributes[5*i+3],
+						    attributes[5*i+4] - attributes[5*i+3]);
+			}
+		}
+
+		state->file = data_file_new (name, format,
+					     xmlStrEqual (localname, (xmlChar *)"Pixdata"));
+
+		g_free (name);
+		g_free (format);
+		return;
+	}
+
+	xmlSAX2StartElementNs (ctx, localname, prefix, URI,
+			       nb_namespaces, namespaces,
+			       nb_attributes, nb_defaulted, attributes);
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  SAX end element handler.                                       */
+/*--------------------------------------------------------------------------*/
+static void
+xml_sax_end_element (void            *ctx,
+		     const xmlChar   *localname,
+		     const xmlChar   *prefix,
+		     const xmlChar   *URI)
+{
+	ParseState *state = ((xmlParserCtxtPtr)ctx)->_private;
+
+	state->depth--;
+
+	if (state->file) {
+		if (state->depth == 2) {
+			state->file_list = g_list_append (state->file_list, state->file);
+			state->file = NULL;
+		}
+		return;
+	}
+
+	if (state->depth == 1) {
+		state->data_flag = FALSE;
+	}
+
+	xmlSAX2EndElementNs (ctx, localname, prefix, URI);
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  SAX characters handler.                                        */
+/*--------------------------------------------------------------------------*/
+static void
+xml_sax_characters (void            *ctx,
+		    const xmlChar   *ch,
+		    int              len)
+{
+	ParseState *state = ((xmlParserCtxtPtr)ctx)->_private;
+
+	if (state->file) {
+		data_file_append (state->file, ch, len);
+	} else {
+		xmlSAX2Characters (ctx, ch, len);
+	}
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  SAX CDATA block handler.                                       */
+/*--------------------------------------------------------------------------*/
+static void
+xml_sax_cdata_block (void            *ctx,
+		     const xmlChar   *value,
+		     int              len)
+{
+	ParseState *state = ((xmlParserCtxtPtr)ctx)->_private;
+
+	if (state->file) {
+		data_file_append (state->file, value, len);
+	} else {
+		xmlSAX2CDataBlock (ctx, value, len);
+	}
+}
+
+
 /*--------------------------------------------------------------------------*/
 /* PRIVATE.  Parse xml doc structure and create label.                      */
 /*--------------------------------------------------------------------------*/
 static glLabel *
 xml_doc_to_label (xmlDocPtr         doc,
+		  GList            *file_list,
 		  glXMLLabelStatus *status)
 {
 	xmlNodePtr  root;
@@ -303,7 +538,7 @@ xml_doc_to_label (xmlDocPtr         doc,
                            LGL_XML_NAME_SPACE);
         }
 
-        label = xml_parse_label (root, status);
+        label = xml_parse_label (root, file_list, status);
         if (label)
         {
                 gl_label_set_compression (label, xmlGetDocCompressMode (doc));
@@ -320,8 +555,10 @@ xml_doc_to_label (xmlDocPtr         doc,
 /*--------------------------------------------------------------------------*/
 static glLabel *
 xml_parse_label (xmlNodePtr        root,
+		 GList            *file_list,
 		 glXMLLabelStatus *status)
 {
+	GList       *p;
 	xmlNodePtr   child_node;
 	glLabel     *label;
 	lglTemplate *template;
@@ -338,7 +575,10 @@ xml_parse_label (xmlNodePtr        root,
 
 	label = GL_LABEL(gl_label_new ());
 
-	/* Pass 1, extract data nodes to pre-load cache. */
+	/* Pass 1, pre-load cache with data decoded while parsing, and data nodes. */
+	for (p = file_list; p != NULL; p = p->next) {
+		data_file_add_to_label (p->data, label);
+	}
 	for (child_node = root->xmlChildrenNode; child_node != NULL; child_node = child_node->next) {
 		if (lgl_xml_is_node (child_node, "Data")) {
 			xml_parse_data (child_node, label);
@@ -883,10 +1123,8 @@ xml_parse_data (xmlNodePtr  node,
 
 	for (child = node->xmlChildrenNode; child != NULL; child = child->next) {
 
-		if (lgl_xml_is_node (child, "Pixdata")) {
-			xml_parse_pixdata (child, label);
-		} else if (lgl_xml_is_node (child, "File")) {
-			xml_parse_file_node (child, label);
+		if (lgl_xml_is_node (child, "Pixdata") || lgl_xml_is_node (child, "File")) {
+			xml_parse_data_file (child, label);
 		} else {
 			if (!xmlNodeIsText (child)) {
 				g_message ("bad node in Data node =  \"%s\"",
@@ -900,77 +1138,148 @@ xml_parse_data (xmlNodePtr  node,
 
 
 /*--------------------------------------------------------------------------*/
-/* PRIVATE.  Parse XML embedded Pixdata node.                               */
+/* PRIVATE.  Parse XML embedded File or (obsolete) Pixdata node.            */
 /*--------------------------------------------------------------------------*/
 static void
-xml_parse_pixdata (xmlNodePtr  node,
-		   glLabel    *label)
+xml_parse_data_file (xmlNodePtr  node,
+		     glLabel    *label)
 {
-	gchar      *name, *base64;
-	guchar     *stream;
-	gsize       stream_length;
-	gboolean    ret;
-	GdkPixdata *pixdata;
-	GdkPixbuf  *pixbuf;
-	GHashTable *pixbuf_cache;
+	gchar      *name, *format;
+	gchar      *content;
+	DataFile   *file;
 
 	gl_debug (DEBUG_XML, "START");
 
-	name = lgl_xml_get_prop_string (node, "name", NULL);
-	base64 = lgl_xml_get_node_content (node);
+	name    = lgl_xml_get_prop_string (node, "name", NULL);
+	format  = lgl_xml_get_prop_string (node, "format", NULL);
+	content = lgl_xml_get_node_content (node);
 
-	stream = g_base64_decode ((gchar *)base64, &stream_length);
-	pixdata = g_new0 (GdkPixdata, 1);
-	ret = gdk_pixdata_deserialize (pixdata, stream_length, stream, NULL);
+	file = data_file_new (name, format, lgl_xml_is_node (node, "Pixdata"));
+	if (content) {
+		data_file_append (file, (xmlChar *)content, strlen (content));
+	}
+	data_file_add_to_label (file, label);
+	data_file_free (file);
+
+	g_free (name);
+	g_free (format);
+	g_free (content);
+
+	gl_debug (DEBUG_XML, "END");
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  Create embedded file.  SVG files are inline text, all others   */
+/* (including Pixdata) are Base64 encoded.                                  */
+/*--------------------------------------------------------------------------*/
+static DataFile *
+data_file_new (const gchar *name,
+	       const gchar *format,
+	       gboolean     pixdata_flag)
+{
+	DataFile *file;
+
+	file = g_new0 (DataFile, 1);
 
-	if (ret) {
-		pixbuf = gdk_pixbuf_from_pixdata (pixdata, TRUE, NULL);
+	file->name  = g_strdup (name);
+	file->bytes = g_byte_array_new ();
 
-		pixbuf_cache = gl_label_get_pixbuf_cache (label);
-		gl_pixbuf_cache_add_pixbuf (pixbuf_cache, (gchar *)name, pixbuf);
+	if (pixdata_flag) {
+		file->base64_flag = TRUE;
+	} else {
+		file->format      = g_strdup (format ? format : "");
+		file->base64_flag = (lgl_str_utf8_casecmp (file->format, "SVG") != 0);
 	}
 
-	g_free (name);
-	g_free (base64);
+	return file;
+}
 
-	g_free (stream);
-	g_free (pixdata);
 
-	gl_debug (DEBUG_XML, "END");
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  Append (and decode) chunk of embedded file content.            */
+/*--------------------------------------------------------------------------*/
+static void
+data_file_append (DataFile      *file,
+		  const xmlChar *ch,
+		  gint           len)
+{
+	guint n;
+
+	if (file->base64_flag) {
+		n = file->bytes->len;
+		g_byte_array_set_size (file->bytes, n + (len / 4) * 3 + 3);
+		n += g_base64_decode_step ((gchar *)ch, len, file->bytes->data + n,
+					   &file->base64_state, &file->base64_save);
+		g_byte_array_set_size (file->bytes, n);
+	} else {
+		g_byte_array_append (file->bytes, ch, len);
+	}
 }
 
 
 /*--------------------------------------------------------------------------*/
-/* PRIVATE.  Parse XML embedded File node.                                  */
+/* PRIVATE.  Add decoded embedded file to pixbuf or svg cache of label.     */
 /*--------------------------------------------------------------------------*/
 static void
-xml_parse_file_node (xmlNodePtr  node,
-                     glLabel    *label)
+data_file_add_to_label (DataFile *file,
+			glLabel  *label)
 {
-	gchar      *name, *format;
-        gchar      *content;
-	GHashTable *svg_cache;
+	GdkPixdata *pixdata;
+	GdkPixbuf  *pixbuf;
+	GBytes     *data;
+	gchar      *pixbuf_format;
 
-	name    = lgl_xml_get_prop_string (node, "name", NULL);
-	format  = lgl_xml_get_prop_string (node, "format", NULL);
+	if (file->name == NULL) {
+		g_message ("Embedded file without name");
+		return;
+	}
 
-        if ( format && (lgl_str_utf8_casecmp (format, "SVG") == 0) )
-        {
-                content = lgl_xml_get_node_content (node);
+	if (file->format == NULL) {
 
-		svg_cache = gl_label_get_svg_cache (label);
-                gl_svg_cache_add_svg (svg_cache, name, content);
+		/* Obsolete raw Pixdata. */
+		pixdata = g_new0 (GdkPixdata, 1);
+		if (gdk_pixdata_deserialize (pixdata, file->bytes->len, file->bytes->data, NULL)) {
+			pixbuf = gdk_pixbuf_from_pixdata (pixdata, TRUE, NULL);
+			gl_pixbuf_cache_add_pixbuf (gl_label_get_pixbuf_cache (label),
+						    file->name, pixbuf);
+			g_object_unref (pixbuf);
+		}
+		g_free (pixdata);
 
-                g_free (content);
-        }
-        else
-        {
-                g_message ("Unknown embedded file format: \"%s\"", format);
-                
-        }
+	} else if (!file->base64_flag) {
 
-        g_free (name);
-        g_free (format);
+		/* SVG */
+		g_byte_array_append (file->bytes, (guint8 *)"", 1);
+		gl_svg_cache_add_svg (gl_label_get_svg_cache (label),
+				      file->name, (gchar *)file->bytes->data);
+
+	} else if (*file->format != '\0') {
+
+		/* Raster image file, kept encoded until an image object needs it. */
+		data = g_bytes_new (file->bytes->data, file->bytes->len);
+		pixbuf_format = g_ascii_strdown (file->format, -1);
+		gl_pixbuf_cache_add_data (gl_label_get_pixbuf_cache (label),
+					  file->name, data, pixbuf_format);
+		g_free (pixbuf_format);
+		g_bytes_unref (data);
+
+	} else {
+		g_message ("Unknown embedded file format: \"%s\"", file->format);
+	}
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* PRIVATE.  Free embedded file.                                            */
+/*--------------------------------------------------------------------------*/
+static void
+data_file_free (DataFile *file)
+{
+	g_free (file->name);
+	g_free (file->format);
+	g_byte_array_unref (file->bytes);
+	g_free (file);
 }
 
 
@@ -1726,7 +2035,7 @@ xml_create_data (xmlDocPtr   doc,
 	name_list = gl_pixbuf_cache_get_name_list (cache);
 
 	for (p = name_list; p != NULL; p=p->next) {
-		xml_create_pixdata (node, ns, label, p->data);
+		xml_create_file_image (node, ns, label, p->data);
 	}
 
 	gl_pixbuf_cache_free_name_list (name_list);
@@ -1747,42 +2056,43 @@ xml_create_data (xmlDocPtr   doc,
 
 
 /*--------------------------------------------------------------------------*/
-/* PRIVATE.  Add XML Label Data embedded Pixdata Node                       */
+/* PRIVATE.  Add XML Label Data embedded image file Node.  The original     */
+/* compressed file (e.g. PNG or JPEG) is embedded, not raw pixels.          */
 /*--------------------------------------------------------------------------*/
 static void
-xml_create_pixdata (xmlNodePtr  parent,
-		    xmlNsPtr    ns,
-		    glLabel    *label,
-		    gchar      *name)
+xml_create_file_image (xmlNodePtr  parent,
+		       xmlNsPtr    ns,
+		       glLabel    *label,
+		       gchar      *name)
 {
-	xmlNodePtr  node;
-	GHashTable *pixbuf_cache;
-	GdkPixbuf  *pixbuf;
-	GdkPixdata *pixdata;
-	guchar     *stream;
-	guint       stream_length;
-	gchar      *base64;
+	xmlNodePtr   node;
+	GHashTable  *pixbuf_cache;
+	GBytes      *data;
+	const gchar *pixbuf_format;
+	gchar       *format;
+	gconstpointer stream;
+	gsize        stream_length;
+	gchar       *base64;
 
 	gl_debug (DEBUG_XML, "START");
 
 	pixbuf_cache = gl_label_get_pixbuf_cache (label);
 
-	pixbuf = gl_pixbuf_cache_get_pixbuf (pixbuf_cache, name);
-	if ( pixbuf != NULL ) {
+	data = gl_pixbuf_cache_get_data (pixbuf_cache, name, &pixbuf_format);
+	if ( data != NULL ) {
 
-		pixdata = g_new0 (GdkPixdata, 1);
-		gdk_pixdata_from_pixbuf (pixdata, pixbuf, FALSE);
-		stream = gdk_pixdata_serialize (pixdata, &stream_length);
+		stream = g_bytes_get_data (data, &stream_length);
 		base64 = g_base64_encode (stream, stream_length);
+		format = g_ascii_strup (pixbuf_format, -1);
 
-		node = xmlNewChild (parent, ns, (xmlChar *)"Pixdata", (xmlChar *)base64);
+		node = xmlNewChild (parent, ns, (xmlChar *)"File", (xmlChar *)base64);
 		lgl_xml_set_prop_string (node, "name", name);
+		lgl_xml_set_prop_string (node, "format", format);
 		lgl_xml_set_prop_string (node, "encoding", "Base64");
 
-		gl_pixbuf_cache_remove_pixbuf (pixbuf_cache, name);
+		gl_debug (DEBUG_XML, "%s: %" G_GSIZE_FORMAT " bytes %s", name, stream_length, format);
 
-		g_free (pixdata);
-		g_free (stream);
+		g_free (format);
 		g_free (base64);
 	}
 